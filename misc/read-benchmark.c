@@ -1,13 +1,21 @@
 /* Read slide level 0 in 1000 x 1000 regions and report time in pixels
-   per second. */
+   per second.  Then repeatedly read one region from a warm cache, which
+   measures compositing alone.  Each benchmark is run with and without
+   direct tile copies into the destination buffer, by rerunning ourselves
+   with OPENSLIDE_DEBUG=no-direct-blit. */
 /* gcc -O2 -g -std=gnu99 -o read-benchmark read-benchmark.c \
    $(pkg-config --cflags --libs openslide) */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include <openslide.h>
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
@@ -15,22 +23,24 @@
 #define REGION_WIDTH 1000
 #define REGION_HEIGHT 1000
 #define RUNS 5
+#define CACHED_RUNS 500
 
-int main(int argc, char **argv) {
-  if (argc != 2) {
-    printf("Arguments: slide\n");
-    return 1;
-  }
-  const char *slide = argv[1];
+#define CHILD_ENV_VAR "READ_BENCHMARK_CHILD"
 
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void benchmark(const char *slide) {
   uint32_t *buf = malloc(REGION_WIDTH * REGION_HEIGHT * 4);
   openslide_t *osr = openslide_open(slide);
   assert(osr != NULL && openslide_get_error(osr) == NULL);
   int64_t w, h;
   openslide_get_level0_dimensions(osr, &w, &h);
 
-  struct timespec start, end;
-  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+  double start = now();
   for (int64_t i = 0; i < RUNS; i++) {
     for (int64_t y = 0; y < h; y += REGION_HEIGHT) {
       for (int64_t x = 0; x < w; x += REGION_WIDTH) {
@@ -40,14 +50,65 @@ int main(int argc, char **argv) {
       }
     }
   }
-  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
-  double elapsed = (end.tv_sec + end.tv_nsec / 1e9) -
-                   (start.tv_sec + start.tv_nsec / 1e9);
+  double elapsed = now() - start;
   assert(openslide_get_error(osr) == NULL);
-  printf("%.1f million pixels per CPU-second\n",
+  printf("  whole slide: %8.1f million pixels per CPU-second\n",
          w * h * RUNS / (elapsed * 1e6));
 
+  // one region from the center of the slide, in the cache after the
+  // first read
+  int64_t rw = MIN(w, REGION_WIDTH);
+  int64_t rh = MIN(h, REGION_HEIGHT);
+  int64_t rx = (w - rw) / 2;
+  int64_t ry = (h - rh) / 2;
+  openslide_read_region(osr, buf, rx, ry, 0, rw, rh);
+  start = now();
+  for (int64_t i = 0; i < CACHED_RUNS; i++) {
+    openslide_read_region(osr, buf, rx, ry, 0, rw, rh);
+  }
+  elapsed = now() - start;
+  assert(openslide_get_error(osr) == NULL);
+  printf("  cached:      %8.1f million pixels per CPU-second\n",
+         rw * rh * CACHED_RUNS / (elapsed * 1e6));
+
   openslide_close(osr);
   free(buf);
+}
+
+static void run_child(char **argv, const char *label, const char *debug) {
+  printf("%s:\n", label);
+  fflush(stdout);
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0) {
+    setenv(CHILD_ENV_VAR, "1", 1);
+    if (debug) {
+      setenv("OPENSLIDE_DEBUG", debug, 1);
+    } else {
+      unsetenv("OPENSLIDE_DEBUG");
+    }
+    execvp(argv[0], argv);
+    perror("exec");
+    _exit(1);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    printf("Arguments: slide\n");
+    return 1;
+  }
+
+  // OpenSlide reads debug flags when loaded, so each mode needs its own
+  // process
+  if (getenv(CHILD_ENV_VAR)) {
+    benchmark(argv[1]);
+    return 0;
+  }
+  run_child(argv, "Direct tile copies", NULL);
+  run_child(argv, "Cairo compositing", "no-direct-blit");
   return 0;
 }
@@ -0,0 +1,147 @@
+/* Decode every tile of one slide level with an empty cache, and report
+   the elapsed time per tile.  Small tiles make per-tile setup costs
+   visible.  Then read small patches straddling the corners of four
+   tiles, which only need part of each tile decoded.  An optional thread
+   count lets JPEG 2000 tile reads use OpenJPEG's intra-tile threads.
+   The benchmark is run with and without reuse of JPEG decompressors and
+   cropped decoding, by rerunning ourselves with OPENSLIDE_DEBUG set. */
+/* gcc -O2 -g -std=gnu99 -o tile-decode-benchmark tile-decode-benchmark.c \
+   $(pkg-config --cflags --libs openslide) */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <openslide.h>
+
+#define RUNS 5
+#define PATCH_SIZE 64
+
+#define CHILD_ENV_VAR "TILE_DECODE_BENCHMARK_CHILD"
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int64_t get_int_property(openslide_t *osr, const char *fmt,
+                                int32_t level) {
+  char name[64];
+  snprintf(name, sizeof(name), fmt, level);
+  const char *value = openslide_get_property_value(osr, name);
+  return value ? strtoll(value, NULL, 10) : 0;
+}
+
+static void benchmark(const char *slide, int32_t level, int32_t threads) {
+  openslide_t *osr = openslide_open(slide);
+  assert(osr != NULL && openslide_get_error(osr) == NULL);
+  assert(level >= 0 && level < openslide_get_level_count(osr));
+  openslide_set_decode_threads(osr, threads);
+
+  // nothing stays in the cache, so every read decodes
+  openslide_cache_t *cache = openslide_cache_create(0);
+  openslide_set_cache(osr, cache);
+  openslide_cache_release(cache);
+
+  int64_t tw = get_int_property(osr, "openslide.level[%d].tile-width",
+                                level);
+  int64_t th = get_int_property(osr, "openslide.level[%d].tile-height",
+                                level);
+  assert(tw > 0 && th > 0);
+  int64_t w, h;
+  openslide_get_level_dimensions(osr, level, &w, &h);
+  int64_t across = (w + tw - 1) / tw;
+  int64_t down = (h + th - 1) / th;
+
+  int64_t tiles = 0;
+  double start = now();
+  for (int i = 0; i < RUNS; i++) {
+    for (int64_t row = 0; row < down; row++) {
+      for (int64_t col = 0; col < across; col++) {
+        openslide_tile_t *tile = openslide_read_tile(osr, level, col, row);
+        if (tile) {
+          openslide_tile_release(tile);
+          tiles++;
+        }
+      }
+    }
+  }
+  double elapsed = now() - start;
+  assert(openslide_get_error(osr) == NULL);
+  assert(tiles > 0);
+  printf("  %"PRId64"x%"PRId64" tiles: %8.2f us per tile "
+         "(%"PRId64" decoded)\n",
+         tw, th, elapsed * 1e6 / tiles, tiles);
+
+  // patches centered on interior tile corners
+  double downsample = openslide_get_level_downsample(osr, level);
+  uint32_t *buf = malloc(PATCH_SIZE * PATCH_SIZE * 4);
+  int64_t patches = 0;
+  start = now();
+  for (int i = 0; i < RUNS; i++) {
+    for (int64_t row = 1; row < down; row++) {
+      for (int64_t col = 1; col < across; col++) {
+        int64_t x = (col * tw - PATCH_SIZE / 2) * downsample;
+        int64_t y = (row * th - PATCH_SIZE / 2) * downsample;
+        openslide_read_region(osr, buf, x, y, level, PATCH_SIZE, PATCH_SIZE);
+        patches++;
+      }
+    }
+  }
+  elapsed = now() - start;
+  free(buf);
+  assert(openslide_get_error(osr) == NULL);
+  if (patches) {
+    printf("  %dx%d patches: %8.2f us per patch (%"PRId64" read)\n",
+           PATCH_SIZE, PATCH_SIZE, elapsed * 1e6 / patches, patches);
+  }
+
+  openslide_close(osr);
+}
+
+static void run_child(char **argv, const char *label, const char *debug) {
+  printf("%s:\n", label);
+  fflush(stdout);
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0) {
+    setenv(CHILD_ENV_VAR, "1", 1);
+    if (debug) {
+      setenv("OPENSLIDE_DEBUG", debug, 1);
+    } else {
+      unsetenv("OPENSLIDE_DEBUG");
+    }
+    execvp(argv[0], argv);
+    perror("exec");
+    _exit(1);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 4) {
+    printf("Arguments: slide [level [threads]]\n");
+    return 1;
+  }
+
+  // OpenSlide reads debug flags when loaded, so each mode needs its own
+  // process
+  if (getenv(CHILD_ENV_VAR)) {
+    benchmark(argv[1], argc > 2 ? atoi(argv[2]) : 0,
+              argc > 3 ? atoi(argv[3]) : 1);
+    return 0;
+  }
+  run_child(argv, "Reused JPEG decompressors, cropped decoding", NULL);
+  run_child(argv, "New JPEG decompressor per tile", "no-jpeg-reuse");
+  run_child(argv, "Whole tiles decoded", "no-jpeg-crop");
+  return 0;
+}
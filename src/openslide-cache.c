@@ -23,9 +23,17 @@
 #include "openslide-private.h"
 
 #include <glib.h>
+#include <string.h>
 
 #define DEFAULT_CACHE_SIZE (1024*1024*32)
 
+// the cache is split into independently-locked shards so that threads
+// reading different tiles don't serialize on one mutex.  each shard has
+// its own eviction state and an equal share of the byte budget.  small caches
+// get fewer shards, so an individual shard can still hold large tiles.
+#define MAX_SHARDS 32
+#define MIN_SHARD_CAPACITY (1024*1024*16)
+
 // hash table key
 struct _openslide_cache_key {
   uint64_t binding_id;  // distinguishes values from different slide handles
@@ -34,13 +42,22 @@ struct _openslide_cache_key {
   int64_t y;
 };
 
+// S3-FIFO tuning
+#define S3FIFO_SMALL_FRACTION 10  // percent of capacity for the small queue
+#define S3FIFO_MAX_FREQ 3
+
 // hash table value
 struct _openslide_cache_value {
-  GList *link;            // direct pointer to the node in the list
+  GList *link;            // direct pointer to the node in the policy's list
   struct _openslide_cache_key *key; // for removing keys when aged out
-  openslide_cache_t *cache; // sadly, for total_bytes and the list
+  struct cache_shard *shard; // sadly, for total_bytes and the policy
 
   struct _openslide_cache_entry *entry;  // may outlive the value
+  struct binding_stats *stats;  // binding that inserted the value
+
+  // S3-FIFO state
+  uint8_t freq;
+  bool small;
 };
 
 // datum
@@ -48,65 +65,180 @@ struct _openslide_cache_entry {
   gint refcount;  // atomic ops only
   void *data;
   uint64_t size;
+
+  // non-NULL if this is a claim on an in-flight decode, handed out by
+  // _openslide_cache_get() on a miss.  the claim is completed by
+  // _openslide_cache_put() or abandoned when it is unreffed.
+  struct cache_flight *flight;
 };
 
-struct _openslide_cache {
+// a decode in progress.  other threads missing on the same key wait for
+// the owner to finish rather than decoding the tile again.
+struct cache_flight {
+  struct _openslide_cache_key key;
+  openslide_cache_t *cache;  // holds a reference
+  struct cache_shard *shard;
+  GThread *owner;
+  GCond cond;
+  bool done;
+  uint32_t waiters;
+
+  // on success, holds one entry reference per waiter
+  struct _openslide_cache_entry *result;
+};
+
+// eviction policy.  all callbacks are called with the shard mutex held.
+struct cache_policy {
+  void *(*create)(uint64_t capacity);
+  void (*destroy)(void *data);
+  // a value was added to the shard
+  void (*insert)(void *data, struct _openslide_cache_value *value);
+  // a lookup found the value
+  void (*hit)(void *data, struct _openslide_cache_value *value);
+  // choose the next value to evict; return NULL if the shard is empty
+  struct _openslide_cache_value *(*victim)(void *data);
+  // the value is being removed from the shard
+  void (*remove)(void *data, struct _openslide_cache_value *value);
+};
+
+// statistics for one binding of a slide handle to a cache.  values inserted
+// through the binding hold a reference, since they can outlive it.
+// atomic ops only.
+struct binding_stats {
+  gint refcount;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t coalesced;
+  uint64_t insertions;
+  uint64_t evictions;
+  uint64_t bytes;
+  uint64_t entries;
+  uint64_t peak_bytes;
+};
+
+struct cache_shard {
+  openslide_cache_t *cache;
   GMutex mutex;
-  GQueue *list;
+  const struct cache_policy *policy;
+  void *policy_data;
   GHashTable *hashtable;
+  GHashTable *inflight;  // key -> struct cache_flight
 
+  uint64_t capacity;
+  uint64_t total_size;
+
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t coalesced;
+  uint64_t insertions;
+  uint64_t evictions;
+};
+
+struct _openslide_cache {
+  struct cache_shard **shards;
+  uint32_t shard_count;
+  uint64_t capacity;
+
+  // cache-wide, since per-shard peaks wouldn't add up; atomic ops only
+  uint64_t bytes;
+  uint64_t peak_bytes;
+
+  GMutex mutex;  // protects the fields below
   int refcount;
   bool released;
   uint64_t next_binding_id;
 
-  uint64_t capacity;
-  uint64_t total_size;
-
   gint warned_overlarge_entry;
 };
 
 // connection between a cache (possibly shared between multiple slide handles)
 // and a specific slide handle
 struct _openslide_cache_binding {
-  GMutex mutex;
+  GRWLock lock;  // write-locked only when changing the cache
   openslide_cache_t *cache;
   uint64_t id;  // unique id assigned by cache upon bind
+  struct binding_stats *stats;  // reset upon bind
 };
 
+// 64-bit counters; glib doesn't have 64-bit atomics
+static void counter_add(uint64_t *counter, int64_t val) {
+  __atomic_add_fetch(counter, (uint64_t) val, __ATOMIC_RELAXED);
+}
+
+static uint64_t counter_get(uint64_t *counter) {
+  return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+// add to a byte count, updating its peak
+static void counter_add_bytes(uint64_t *counter, uint64_t *peak,
+                              int64_t val) {
+  uint64_t bytes = __atomic_add_fetch(counter, (uint64_t) val,
+                                      __ATOMIC_RELAXED);
+  uint64_t old_peak = counter_get(peak);
+  while (bytes > old_peak &&
+         !__atomic_compare_exchange_n(peak, &old_peak, bytes, true,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+static struct binding_stats *binding_stats_new(void) {
+  struct binding_stats *stats = g_new0(struct binding_stats, 1);
+  g_atomic_int_set(&stats->refcount, 1);
+  return stats;
+}
+
+static struct binding_stats *binding_stats_ref(struct binding_stats *stats) {
+  g_atomic_int_inc(&stats->refcount);
+  return stats;
+}
+
+static void binding_stats_unref(struct binding_stats *stats) {
+  if (g_atomic_int_dec_and_test(&stats->refcount)) {
+    g_free(stats);
+  }
+}
+
 // eviction
-// mutex must be held
-static void possibly_evict(openslide_cache_t *cache, uint64_t incoming_size) {
-  uint64_t size = cache->total_size + incoming_size;
-  uint64_t target = cache->capacity;
-  g_assert(size > cache->total_size);
+// shard mutex must be held
+static void possibly_evict(struct cache_shard *shard, uint64_t incoming_size) {
+  uint64_t size = shard->total_size + incoming_size;
+  uint64_t target = shard->capacity;
+  g_assert(size > shard->total_size);
 
   while(size > target) {
-    // get key of last element
-    struct _openslide_cache_value *value = g_queue_peek_tail(cache->list);
+    // get key of next victim
+    struct _openslide_cache_value *value =
+      shard->policy->victim(shard->policy_data);
     if (value == NULL) {
-      return; // cache is empty
+      return; // shard is empty
     }
     struct _openslide_cache_key *key = value->key;
 
     //g_debug("EVICT: size: %d", value->entry->size);
 
     size -= value->entry->size;
+    shard->evictions++;
+    counter_add(&value->stats->evictions, 1);
 
     // remove from hashtable, this will trigger removal from everything
-    bool result = g_hash_table_remove(cache->hashtable, key);
+    bool result = g_hash_table_remove(shard->hashtable, key);
     g_assert(result);
   }
 }
 
 
 // hash function helpers
-static guint hash_func(gconstpointer key) {
-  const struct _openslide_cache_key *c_key = key;
+static uint64_t key_hash(const struct _openslide_cache_key *key) {
+  // mix all fields so both the high bits (used for shard selection) and
+  // the low bits (used by the hash table) are well distributed
+  uint64_t h = key->binding_id;
+  h = (h ^ (guintptr) key->plane) * UINT64_C(0x9e3779b97f4a7c15);
+  h = (h ^ (uint64_t) key->x) * UINT64_C(0xbf58476d1ce4e5b9);
+  h = (h ^ (uint64_t) key->y) * UINT64_C(0x94d049bb133111eb);
+  return h ^ (h >> 31);
+}
 
-  // assume 32-bit hash
-  return (guint) ((c_key->binding_id << 16) ^
-                  ((guintptr) c_key->plane) ^
-                  ((34369 * (uint64_t) c_key->y) + ((uint64_t) c_key->x)));
+static guint hash_func(gconstpointer key) {
+  return (guint) key_hash(key);
 }
 
 static gboolean key_equal_func(gconstpointer a,
@@ -120,15 +252,31 @@ static gboolean key_equal_func(gconstpointer a,
     (c_a->y == c_b->y);
 }
 
+static uint32_t get_shard_index(openslide_cache_t *cache,
+                                const struct _openslide_cache_key *key) {
+  return (key_hash(key) >> 32) % cache->shard_count;
+}
+
+static struct cache_shard *get_shard(openslide_cache_t *cache,
+                                     const struct _openslide_cache_key *key) {
+  return cache->shards[get_shard_index(cache, key)];
+}
+
 static void hash_destroy_value(gpointer data) {
   struct _openslide_cache_value *value = data;
+  struct cache_shard *shard = value->shard;
 
-  // remove the item from the list
-  g_queue_delete_link(value->cache->list, value->link);
+  // remove the item from the policy's lists
+  shard->policy->remove(shard->policy_data, value);
 
   // decrement the total size
-  g_assert(value->entry->size <= value->cache->total_size);
-  value->cache->total_size -= value->entry->size;
+  uint64_t size = value->entry->size;
+  g_assert(size <= shard->total_size);
+  shard->total_size -= size;
+  counter_add(&shard->cache->bytes, -(int64_t) size);
+  counter_add(&value->stats->bytes, -(int64_t) size);
+  counter_add(&value->stats->entries, -1);
+  binding_stats_unref(value->stats);
 
   // unref the entry
   _openslide_cache_entry_unref(value->entry);
@@ -137,27 +285,252 @@ static void hash_destroy_value(gpointer data) {
   g_free(value);
 }
 
-openslide_cache_t *_openslide_cache_create(uint64_t capacity_in_bytes) {
+// LRU policy: evict the least recently used value
+
+static void *lru_create(uint64_t capacity G_GNUC_UNUSED) {
+  return g_queue_new();
+}
+
+static void lru_destroy(void *data) {
+  GQueue *list = data;
+  g_assert(g_queue_is_empty(list));
+  g_queue_free(list);
+}
+
+static void lru_insert(void *data, struct _openslide_cache_value *value) {
+  GQueue *list = data;
+  // insert at head of queue
+  g_queue_push_head(list, value);
+  value->link = g_queue_peek_head_link(list);
+}
+
+static void lru_hit(void *data, struct _openslide_cache_value *value) {
+  GQueue *list = data;
+  // move to front of list
+  g_queue_unlink(list, value->link);
+  g_queue_push_head_link(list, value->link);
+}
+
+static struct _openslide_cache_value *lru_victim(void *data) {
+  GQueue *list = data;
+  return g_queue_peek_tail(list);
+}
+
+static void lru_remove(void *data, struct _openslide_cache_value *value) {
+  GQueue *list = data;
+  g_queue_delete_link(list, value->link);
+}
+
+static const struct cache_policy lru_policy = {
+  .create = lru_create,
+  .destroy = lru_destroy,
+  .insert = lru_insert,
+  .hit = lru_hit,
+  .victim = lru_victim,
+  .remove = lru_remove,
+};
+
+// S3-FIFO policy: new values enter a small FIFO queue and are promoted to
+// the main FIFO queue only if they are hit before reaching its tail.
+// values evicted from the small queue are remembered in a ghost queue,
+// and enter the main queue directly if they return.  values in the main
+// queue are reinserted rather than evicted if they have been hit.  so a
+// scan over many tiles, each read once, only churns the small queue.
+// Yang et al., "FIFO queues are all you need for cache eviction", SOSP '23
+
+struct s3fifo {
+  uint64_t small_capacity;
+  GQueue small;
+  uint64_t small_size;
+  GQueue main;
+  // hashes of recently-evicted keys
+  GQueue ghost;
+  GHashTable *ghost_table;  // uint64_t hash -> link in ghost
+};
+
+static void *s3fifo_create(uint64_t capacity) {
+  struct s3fifo *s3 = g_new0(struct s3fifo, 1);
+  s3->small_capacity = capacity * S3FIFO_SMALL_FRACTION / 100;
+  g_queue_init(&s3->small);
+  g_queue_init(&s3->main);
+  g_queue_init(&s3->ghost);
+  s3->ghost_table = g_hash_table_new(g_int64_hash, g_int64_equal);
+  return s3;
+}
+
+static void s3fifo_destroy(void *data) {
+  struct s3fifo *s3 = data;
+  g_assert(g_queue_is_empty(&s3->small));
+  g_assert(g_queue_is_empty(&s3->main));
+  g_hash_table_destroy(s3->ghost_table);
+  uint64_t *hash;
+  while ((hash = g_queue_pop_head(&s3->ghost)) != NULL) {
+    g_free(hash);
+  }
+  g_free(s3);
+}
+
+static void s3fifo_push(struct s3fifo *s3,
+                        struct _openslide_cache_value *value,
+                        bool small) {
+  GQueue *queue = small ? &s3->small : &s3->main;
+  value->small = small;
+  g_queue_push_head(queue, value);
+  value->link = g_queue_peek_head_link(queue);
+  if (small) {
+    s3->small_size += value->entry->size;
+  }
+}
+
+static void s3fifo_unlink(struct s3fifo *s3,
+                          struct _openslide_cache_value *value) {
+  if (value->small) {
+    g_queue_delete_link(&s3->small, value->link);
+    s3->small_size -= value->entry->size;
+  } else {
+    g_queue_delete_link(&s3->main, value->link);
+  }
+  value->link = NULL;
+}
+
+static void s3fifo_insert(void *data, struct _openslide_cache_value *value) {
+  struct s3fifo *s3 = data;
+  uint64_t hash = key_hash(value->key);
+  GList *ghost_link = g_hash_table_lookup(s3->ghost_table, &hash);
+  value->freq = 0;
+  if (ghost_link) {
+    // recently evicted; evidently more than a one-hit wonder
+    g_hash_table_remove(s3->ghost_table, &hash);
+    g_free(ghost_link->data);
+    g_queue_delete_link(&s3->ghost, ghost_link);
+    s3fifo_push(s3, value, false);
+  } else {
+    s3fifo_push(s3, value, true);
+  }
+}
+
+static void s3fifo_hit(void *data G_GNUC_UNUSED,
+                       struct _openslide_cache_value *value) {
+  // no reordering, just note the hit
+  value->freq = MIN(value->freq + 1, S3FIFO_MAX_FREQ);
+}
+
+static void s3fifo_remember(struct s3fifo *s3,
+                            struct _openslide_cache_value *value) {
+  uint64_t *hash = g_new(uint64_t, 1);
+  *hash = key_hash(value->key);
+  if (g_hash_table_contains(s3->ghost_table, hash)) {
+    g_free(hash);
+    return;
+  }
+  g_queue_push_head(&s3->ghost, hash);
+  g_hash_table_insert(s3->ghost_table, hash, g_queue_peek_head_link(&s3->ghost));
+
+  // bound the ghost queue by the number of resident values
+  guint limit = MAX(s3->small.length + s3->main.length, 1);
+  while (s3->ghost.length > limit) {
+    uint64_t *old = g_queue_pop_tail(&s3->ghost);
+    g_hash_table_remove(s3->ghost_table, old);
+    g_free(old);
+  }
+}
+
+static struct _openslide_cache_value *s3fifo_victim(void *data) {
+  struct s3fifo *s3 = data;
+  while (true) {
+    if (!g_queue_is_empty(&s3->small) &&
+        (s3->small_size > s3->small_capacity ||
+         g_queue_is_empty(&s3->main))) {
+      struct _openslide_cache_value *value = g_queue_peek_tail(&s3->small);
+      if (value->freq == 0) {
+        s3fifo_remember(s3, value);
+        return value;
+      }
+      // promote to main queue
+      s3fifo_unlink(s3, value);
+      value->freq = 0;
+      s3fifo_push(s3, value, false);
+    } else {
+      struct _openslide_cache_value *value = g_queue_peek_tail(&s3->main);
+      if (value == NULL) {
+        return NULL;  // shard is empty
+      }
+      if (value->freq == 0) {
+        return value;
+      }
+      // give it another trip through the queue
+      value->freq--;
+      g_queue_unlink(&s3->main, value->link);
+      g_queue_push_head_link(&s3->main, value->link);
+    }
+  }
+}
+
+static void s3fifo_remove(void *data, struct _openslide_cache_value *value) {
+  s3fifo_unlink(data, value);
+}
+
+static const struct cache_policy s3fifo_policy = {
+  .create = s3fifo_create,
+  .destroy = s3fifo_destroy,
+  .insert = s3fifo_insert,
+  .hit = s3fifo_hit,
+  .victim = s3fifo_victim,
+  .remove = s3fifo_remove,
+};
+
+static const struct cache_policy *get_policy(enum openslide_cache_policy policy) {
+  switch (policy) {
+  case OPENSLIDE_CACHE_POLICY_LRU:
+    return &lru_policy;
+  case OPENSLIDE_CACHE_POLICY_S3FIFO:
+    return &s3fifo_policy;
+  default:
+    return NULL;
+  }
+}
+
+openslide_cache_t *_openslide_cache_create(uint64_t capacity_in_bytes,
+                                           enum openslide_cache_policy policy_type) {
+  const struct cache_policy *policy = get_policy(policy_type);
+  if (policy == NULL) {
+    return NULL;
+  }
+
   openslide_cache_t *cache = g_new0(openslide_cache_t, 1);
 
   // init mutex
   g_mutex_init(&cache->mutex);
 
-  // init queue
-  cache->list = g_queue_new();
+  // choose shard count
+  uint64_t shard_count = capacity_in_bytes / MIN_SHARD_CAPACITY;
+  cache->shard_count = CLAMP(shard_count, 1, MAX_SHARDS);
+  cache->capacity = capacity_in_bytes;
 
-  // init hashtable
-  cache->hashtable = g_hash_table_new_full(hash_func,
-					   key_equal_func,
-					   g_free,
-					   hash_destroy_value);
+  // init shards, dividing the capacity between them
+  cache->shards = g_new(struct cache_shard *, cache->shard_count);
+  for (uint32_t i = 0; i < cache->shard_count; i++) {
+    // allocate separately to avoid false sharing between shard mutexes
+    struct cache_shard *shard = g_new0(struct cache_shard, 1);
+    shard->cache = cache;
+    g_mutex_init(&shard->mutex);
+    shard->hashtable = g_hash_table_new_full(hash_func,
+                                             key_equal_func,
+                                             g_free,
+                                             hash_destroy_value);
+    shard->inflight = g_hash_table_new(hash_func, key_equal_func);
+    shard->capacity = capacity_in_bytes / cache->shard_count;
+    if (i < capacity_in_bytes % cache->shard_count) {
+      shard->capacity++;
+    }
+    shard->policy = policy;
+    shard->policy_data = policy->create(shard->capacity);
+    cache->shards[i] = shard;
+  }
 
   // init refcount
   cache->refcount = 1;
 
-  // init byte_capacity
-  cache->capacity = capacity_in_bytes;
-
   return cache;
 }
 
@@ -174,12 +547,22 @@ static void cache_unref(openslide_cache_t *cache) {
     g_mutex_unlock(&cache->mutex);
     return;
   }
-  // clear hashtable (auto-deletes all data)
-  g_hash_table_unref(cache->hashtable);
   g_mutex_unlock(&cache->mutex);
 
-  // clear list
-  g_queue_free(cache->list);
+  for (uint32_t i = 0; i < cache->shard_count; i++) {
+    struct cache_shard *shard = cache->shards[i];
+    // clear hashtable (auto-deletes all data)
+    g_hash_table_unref(shard->hashtable);
+    // in-flight decodes hold a cache reference, so there can be none
+    g_assert(g_hash_table_size(shard->inflight) == 0);
+    g_hash_table_unref(shard->inflight);
+    // clear policy
+    shard->policy->destroy(shard->policy_data);
+    // free mutex
+    g_mutex_clear(&shard->mutex);
+    g_free(shard);
+  }
+  g_free(cache->shards);
 
   // free mutex
   g_mutex_clear(&cache->mutex);
@@ -198,41 +581,142 @@ void _openslide_cache_release(openslide_cache_t *cache) {
   cache_unref(cache);
 }
 
+static uint64_t cache_next_binding_id(openslide_cache_t *cache) {
+  g_mutex_lock(&cache->mutex);
+  uint64_t id = cache->next_binding_id++;
+  g_mutex_unlock(&cache->mutex);
+  return id;
+}
+
 struct _openslide_cache_binding *_openslide_cache_binding_create(void) {
   struct _openslide_cache_binding *cb =
     g_new0(struct _openslide_cache_binding, 1);
-  g_mutex_init(&cb->mutex);
-  cb->cache = _openslide_cache_create(DEFAULT_CACHE_SIZE);
-  cb->id = cb->cache->next_binding_id++;
+  g_rw_lock_init(&cb->lock);
+  cb->cache = _openslide_cache_create(DEFAULT_CACHE_SIZE,
+                                      OPENSLIDE_CACHE_POLICY_LRU);
+  cb->id = cache_next_binding_id(cb->cache);
+  cb->stats = binding_stats_new();
   return cb;
 }
 
 void _openslide_cache_binding_set(struct _openslide_cache_binding *cb,
                                   openslide_cache_t *cache) {
   cache_ref(cache);
+  uint64_t id = cache_next_binding_id(cache);
+  struct binding_stats *stats = binding_stats_new();
 
-  g_mutex_lock(&cache->mutex);
-  uint64_t id = cache->next_binding_id++;
-  g_mutex_unlock(&cache->mutex);
-
-  g_mutex_lock(&cb->mutex);
+  g_rw_lock_writer_lock(&cb->lock);
   openslide_cache_t *old = cb->cache;
+  struct binding_stats *old_stats = cb->stats;
   cb->cache = cache;
   cb->id = id;
-  g_mutex_unlock(&cb->mutex);
+  cb->stats = stats;
+  g_rw_lock_writer_unlock(&cb->lock);
 
   cache_unref(old);
+  binding_stats_unref(old_stats);
 }
 
 void _openslide_cache_binding_destroy(struct _openslide_cache_binding *cb) {
-  g_mutex_lock(&cb->mutex);
+  g_rw_lock_writer_lock(&cb->lock);
   cache_unref(cb->cache);
-  g_mutex_unlock(&cb->mutex);
+  binding_stats_unref(cb->stats);
+  g_rw_lock_writer_unlock(&cb->lock);
 
-  g_mutex_clear(&cb->mutex);
+  g_rw_lock_clear(&cb->lock);
   g_free(cb);
 }
 
+// in-flight decodes
+
+// shard mutex must not be held, since this may free the cache
+static void flight_free(struct cache_flight *flight) {
+  cache_unref(flight->cache);
+  g_cond_clear(&flight->cond);
+  g_free(flight);
+}
+
+// shard mutex must be held
+static struct _openslide_cache_entry *flight_start(openslide_cache_t *cache,
+                                                   struct cache_shard *shard,
+                                                   const struct _openslide_cache_key *key) {
+  struct cache_flight *flight = g_new0(struct cache_flight, 1);
+  flight->key = *key;
+  cache_ref(cache);
+  flight->cache = cache;
+  flight->shard = shard;
+  flight->owner = g_thread_self();
+  g_cond_init(&flight->cond);
+  g_hash_table_insert(shard->inflight, &flight->key, flight);
+
+  struct _openslide_cache_entry *claim =
+    g_new0(struct _openslide_cache_entry, 1);
+  g_atomic_int_set(&claim->refcount, 1);
+  claim->flight = flight;
+  return claim;
+}
+
+// complete or abandon an in-flight decode, and free the claim.
+// result may be NULL.
+static void flight_finish(struct _openslide_cache_entry *claim,
+                          struct _openslide_cache_entry *result) {
+  struct cache_flight *flight = claim->flight;
+  struct cache_shard *shard = flight->shard;
+
+  g_mutex_lock(&shard->mutex);
+  bool removed = g_hash_table_remove(shard->inflight, &flight->key);
+  g_assert(removed);
+  flight->done = true;
+  // the last waiter frees the flight
+  bool unwatched = flight->waiters == 0;
+  if (result && !unwatched) {
+    g_atomic_int_add(&result->refcount, flight->waiters);
+    flight->result = result;
+  }
+  g_cond_broadcast(&flight->cond);
+  g_mutex_unlock(&shard->mutex);
+
+  if (unwatched) {
+    flight_free(flight);
+  }
+  g_free(claim);
+}
+
+void _openslide_cache_get_stats(openslide_cache_t *cache,
+                                openslide_cache_stats_t *stats) {
+  memset(stats, 0, sizeof(*stats));
+  for (uint32_t i = 0; i < cache->shard_count; i++) {
+    struct cache_shard *shard = cache->shards[i];
+    g_mutex_lock(&shard->mutex);
+    stats->hits += shard->hits;
+    stats->misses += shard->misses;
+    stats->coalesced += shard->coalesced;
+    stats->insertions += shard->insertions;
+    stats->evictions += shard->evictions;
+    stats->entries += g_hash_table_size(shard->hashtable);
+    g_mutex_unlock(&shard->mutex);
+  }
+  stats->bytes = counter_get(&cache->bytes);
+  stats->peak_bytes = counter_get(&cache->peak_bytes);
+  stats->capacity = cache->capacity;
+}
+
+void _openslide_cache_binding_get_stats(struct _openslide_cache_binding *cb,
+                                        openslide_cache_stats_t *stats) {
+  g_rw_lock_reader_lock(&cb->lock);
+  struct binding_stats *bs = cb->stats;
+  stats->hits = counter_get(&bs->hits);
+  stats->misses = counter_get(&bs->misses);
+  stats->coalesced = counter_get(&bs->coalesced);
+  stats->insertions = counter_get(&bs->insertions);
+  stats->evictions = counter_get(&bs->evictions);
+  stats->bytes = counter_get(&bs->bytes);
+  stats->entries = counter_get(&bs->entries);
+  stats->peak_bytes = counter_get(&bs->peak_bytes);
+  stats->capacity = cb->cache->capacity;
+  g_rw_lock_reader_unlock(&cb->lock);
+}
+
 // put and get
 
 // the cache retains one reference, and the caller gets another one.  the
@@ -246,61 +730,76 @@ void _openslide_cache_put(struct _openslide_cache_binding *cb,
 			  struct _openslide_cache_entry **_entry) {
   // always create cache entry for caller's reference
   struct _openslide_cache_entry *entry =
-      g_new(struct _openslide_cache_entry, 1);
+      g_new0(struct _openslide_cache_entry, 1);
   // one ref for the caller
   g_atomic_int_set(&entry->refcount, 1);
   entry->data = data;
   entry->size = size_in_bytes;
+
+  // if the caller claimed this decode, hand the result to any waiters
+  struct _openslide_cache_entry *claim = *_entry;
+  if (claim) {
+    g_assert(claim->flight);
+    flight_finish(claim, entry);
+  }
   *_entry = entry;
 
+  // create key
+  struct _openslide_cache_key *key = g_new(struct _openslide_cache_key, 1);
+  key->plane = plane;
+  key->x = x;
+  key->y = y;
+
   // get cache and lock
-  g_mutex_lock(&cb->mutex);
+  g_rw_lock_reader_lock(&cb->lock);
   openslide_cache_t *cache = cb->cache;
-  g_mutex_lock(&cache->mutex);
+  key->binding_id = cb->id;
+  struct cache_shard *shard = get_shard(cache, key);
+  g_mutex_lock(&shard->mutex);
 
   // don't try to put anything in the cache that cannot possibly fit
-  if (size_in_bytes > cache->capacity) {
+  if (size_in_bytes > shard->capacity) {
     //g_debug("refused %p", entry);
-    g_mutex_unlock(&cache->mutex);
+    g_mutex_unlock(&shard->mutex);
     _openslide_performance_warn_once(&cache->warned_overlarge_entry,
                                      "Rejecting overlarge cache entry of "
                                      "size %"PRIu64" bytes", size_in_bytes);
-    g_mutex_unlock(&cb->mutex);
+    g_rw_lock_reader_unlock(&cb->lock);
+    g_free(key);
     return;
   }
 
-  possibly_evict(cache, size_in_bytes); // already checks for wraparound
-
-  // create key
-  struct _openslide_cache_key *key = g_new(struct _openslide_cache_key, 1);
-  key->binding_id = cb->id;
-  key->plane = plane;
-  key->x = x;
-  key->y = y;
+  possibly_evict(shard, size_in_bytes); // already checks for wraparound
 
   // create value
   struct _openslide_cache_value *value =
     g_new(struct _openslide_cache_value, 1);
   value->key = key;
-  value->cache = cache;
+  value->shard = shard;
   value->entry = entry;
+  value->stats = binding_stats_ref(cb->stats);
 
-  // insert at head of queue
-  g_queue_push_head(cache->list, value);
-  value->link = g_queue_peek_head_link(cache->list);
-
-  // insert into hash table
-  g_hash_table_replace(cache->hashtable, key, value);
+  // insert into hash table, replacing any existing value
+  g_hash_table_replace(shard->hashtable, key, value);
 
   // increase size
-  cache->total_size += size_in_bytes;
+  shard->total_size += size_in_bytes;
+  shard->insertions++;
+  counter_add_bytes(&cache->bytes, &cache->peak_bytes, size_in_bytes);
+  counter_add(&value->stats->insertions, 1);
+  counter_add(&value->stats->entries, 1);
+  counter_add_bytes(&value->stats->bytes, &value->stats->peak_bytes,
+                    size_in_bytes);
+
+  // tell the policy
+  shard->policy->insert(shard->policy_data, value);
 
   // another ref for the cache
   g_atomic_int_inc(&entry->refcount);
 
   // unlock
-  g_mutex_unlock(&cache->mutex);
-  g_mutex_unlock(&cb->mutex);
+  g_mutex_unlock(&shard->mutex);
+  g_rw_lock_reader_unlock(&cb->lock);
 
   //g_debug("insert %p", entry);
 }
@@ -311,10 +810,9 @@ void *_openslide_cache_get(struct _openslide_cache_binding *cb,
 			   int64_t x,
 			   int64_t y,
 			   struct _openslide_cache_entry **_entry) {
-  // get cache and lock
-  g_mutex_lock(&cb->mutex);
+  // get cache
+  g_rw_lock_reader_lock(&cb->lock);
   openslide_cache_t *cache = cb->cache;
-  g_mutex_lock(&cache->mutex);
 
   // create key
   struct _openslide_cache_key key = {
@@ -324,20 +822,61 @@ void *_openslide_cache_get(struct _openslide_cache_binding *cb,
     .y = y
   };
 
-  // lookup key, maybe return NULL
-  struct _openslide_cache_value *value = g_hash_table_lookup(cache->hashtable,
+  // lock
+  struct cache_shard *shard = get_shard(cache, &key);
+  g_mutex_lock(&shard->mutex);
+
+  // lookup key
+  struct _openslide_cache_value *value = g_hash_table_lookup(shard->hashtable,
 							     &key);
   if (value == NULL) {
-    g_mutex_unlock(&cache->mutex);
-    g_mutex_unlock(&cb->mutex);
-    *_entry = NULL;
-    return NULL;
+    // missed; is another thread already decoding this tile?
+    struct cache_flight *flight = g_hash_table_lookup(shard->inflight, &key);
+    if (flight == NULL || flight->owner == g_thread_self()) {
+      // no, so the caller must decode it.  give the caller a claim so
+      // later callers wait for the result, unless we're already decoding
+      // this tile further up the stack.
+      shard->misses++;
+      counter_add(&cb->stats->misses, 1);
+      *_entry = flight ? NULL : flight_start(cache, shard, &key);
+      g_mutex_unlock(&shard->mutex);
+      g_rw_lock_reader_unlock(&cb->lock);
+      return NULL;
+    }
+
+    // wait for the owner.  the flight holds a cache reference, so we
+    // needn't block changes to the binding in the meantime.
+    flight->waiters++;
+    struct binding_stats *stats = binding_stats_ref(cb->stats);
+    g_rw_lock_reader_unlock(&cb->lock);
+    while (!flight->done) {
+      g_cond_wait(&flight->cond, &shard->mutex);
+    }
+    struct _openslide_cache_entry *entry = flight->result;
+    if (entry) {
+      shard->coalesced++;
+      counter_add(&stats->coalesced, 1);
+    }
+    bool last = --flight->waiters == 0;
+    g_mutex_unlock(&shard->mutex);
+    if (last) {
+      flight_free(flight);
+    }
+    binding_stats_unref(stats);
+
+    if (entry == NULL) {
+      // the owner failed; try again, perhaps decoding the tile ourselves
+      return _openslide_cache_get(cb, plane, x, y, _entry);
+    }
+    // the owner gave us a reference
+    *_entry = entry;
+    return entry->data;
   }
+  shard->hits++;
+  counter_add(&cb->stats->hits, 1);
 
-  // if found, move to front of list
-  GList *link = value->link;
-  g_queue_unlink(cache->list, link);
-  g_queue_push_head_link(cache->list, link);
+  // if found, tell the policy
+  shard->policy->hit(shard->policy_data, value);
 
   // acquire entry reference for the caller
   struct _openslide_cache_entry *entry = value->entry;
@@ -346,18 +885,98 @@ void *_openslide_cache_get(struct _openslide_cache_binding *cb,
   //g_debug("cache hit! %p %"PRIu64" %p %"PRId64" %"PRId64, (void *) entry, cb->id, (void *) plane, x, y);
 
   // unlock
-  g_mutex_unlock(&cache->mutex);
-  g_mutex_unlock(&cb->mutex);
+  g_mutex_unlock(&shard->mutex);
+  g_rw_lock_reader_unlock(&cb->lock);
 
   // return data
   *_entry = entry;
   return entry->data;
 }
 
+bool _openslide_cache_contains(struct _openslide_cache_binding *cb,
+                               void *plane,
+                               int64_t x,
+                               int64_t y) {
+  g_rw_lock_reader_lock(&cb->lock);
+  struct _openslide_cache_key key = {
+    .binding_id = cb->id,
+    .plane = plane,
+    .x = x,
+    .y = y
+  };
+  struct cache_shard *shard = get_shard(cb->cache, &key);
+  g_mutex_lock(&shard->mutex);
+  bool found = g_hash_table_contains(shard->hashtable, &key) ||
+               g_hash_table_contains(shard->inflight, &key);
+  g_mutex_unlock(&shard->mutex);
+  g_rw_lock_reader_unlock(&cb->lock);
+  return found;
+}
+
+bool _openslide_cache_can_keep(struct _openslide_cache_binding *cb,
+                               void *plane,
+                               int64_t x,
+                               int64_t y,
+                               uint64_t size_in_bytes) {
+  g_rw_lock_reader_lock(&cb->lock);
+  struct _openslide_cache_key key = {
+    .binding_id = cb->id,
+    .plane = plane,
+    .x = x,
+    .y = y
+  };
+  // shard capacity never changes
+  struct cache_shard *shard = get_shard(cb->cache, &key);
+  bool fits = size_in_bytes <= shard->capacity;
+  g_rw_lock_reader_unlock(&cb->lock);
+  return fits;
+}
+
+bool _openslide_cache_can_keep_all(struct _openslide_cache_binding *cb,
+                                   void *plane,
+                                   const int64_t *x,
+                                   const int64_t *y,
+                                   const uint64_t *sizes_in_bytes,
+                                   uint32_t count) {
+  g_rw_lock_reader_lock(&cb->lock);
+  openslide_cache_t *cache = cb->cache;
+  g_autofree uint64_t *totals = g_new0(uint64_t, cache->shard_count);
+  bool fits = true;
+  for (uint32_t i = 0; i < count && fits; i++) {
+    struct _openslide_cache_key key = {
+      .binding_id = cb->id,
+      .plane = plane,
+      .x = x[i],
+      .y = y[i]
+    };
+    uint32_t idx = get_shard_index(cache, &key);
+    totals[idx] += sizes_in_bytes[i];
+    // shard capacity never changes
+    fits = totals[idx] <= cache->shards[idx]->capacity;
+  }
+  g_rw_lock_reader_unlock(&cb->lock);
+  return fits;
+}
+
+uint64_t _openslide_cache_get_min_shard_capacity(struct _openslide_cache_binding *cb) {
+  g_rw_lock_reader_lock(&cb->lock);
+  // earlier shards get the remainder
+  openslide_cache_t *cache = cb->cache;
+  uint64_t capacity = cache->shards[cache->shard_count - 1]->capacity;
+  g_rw_lock_reader_unlock(&cb->lock);
+  return capacity;
+}
+
 // value unref
 void _openslide_cache_entry_unref(struct _openslide_cache_entry *entry) {
   //g_debug("unref %p, refs %d", entry, g_atomic_int_get(&entry->refcount));
 
+  if (entry->flight) {
+    // decode failed or was skipped; wake the waiters so they can retry
+    flight_finish(entry, NULL);
+    return;
+  }
+
   if (g_atomic_int_dec_and_test(&entry->refcount)) {
     // free the data
     g_free(entry->data);
@@ -183,26 +183,30 @@ static bool gdkpixbuf_read(const char *format,
   return true;
 }
 
+struct file {
+  struct _openslide_file *f;
+  int64_t offset;
+};
+
 static size_t file_read_callback(void *out, void *in, size_t size) {
-  return _openslide_fread(in, out, size);
+  struct file *file = in;
+  size_t count = _openslide_fread_at(file->f, file->offset, out, size);
+  file->offset += count;
+  return count;
 }
 
-bool _openslide_gdkpixbuf_read(const char *format,
-                               const char *filename,
-                               int64_t offset,
-                               int64_t length,
-                               uint32_t *dest,
-                               int32_t w, int32_t h,
-                               GError **err) {
-  g_autoptr(_openslide_file) f = _openslide_fopen(filename, err);
-  if (!f) {
-    return false;
-  }
-  if (!_openslide_fseek(f, offset, SEEK_SET, err)) {
-    g_prefix_error(err, "Couldn't fseek %s: ", filename);
-    return false;
-  }
-  return gdkpixbuf_read(format, file_read_callback, f, length,
+bool _openslide_gdkpixbuf_read_file(const char *format,
+                                    struct _openslide_file *f,
+                                    int64_t offset,
+                                    int64_t length,
+                                    uint32_t *dest,
+                                    int32_t w, int32_t h,
+                                    GError **err) {
+  struct file file = {
+    .f = f,
+    .offset = offset,
+  };
+  return gdkpixbuf_read(format, file_read_callback, &file, length,
                         dest, w, h, err);
 }
 
@@ -21,6 +21,8 @@
  *
  */
 
+#include <config.h>
+
 #include <string.h>
 
 #include "openslide-private.h"
@@ -28,9 +30,9 @@
 
 #include <openjpeg.h>
 
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(opj_codec_t, opj_destroy_codec)
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(opj_image_t, opj_image_destroy)
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(opj_stream_t, opj_stream_destroy)
+// decode areas start and end on multiples of this, in scaled pixels,
+// except at the right and bottom edges
+#define AREA_ALIGN 8
 
 struct buffer_state {
   const uint8_t *data;
@@ -57,10 +59,11 @@ static inline void write_pixel_rgb(uint32_t *dest,
   *dest = 0xff000000 | R << 16 | G << 8 | B;
 }
 
+// stride is in pixels
 static void unpack_argb(enum _openslide_jp2k_colorspace space,
                         opj_image_comp_t *comps,
                         uint32_t *dest,
-                        int32_t w, int32_t h) {
+                        int32_t w, int32_t h, int32_t stride) {
   int c0_sub_x = w / comps[0].w;
   int c1_sub_x = w / comps[1].w;
   int c2_sub_x = w / comps[2].w;
@@ -99,6 +102,7 @@ static void unpack_argb(enum _openslide_jp2k_colorspace space,
         int16_t B_chroma = _openslide_B_Cb[c1];
         write_pixel_ycbcr(dest++, c0, R_chroma, G_chroma, B_chroma);
       }
+      dest += stride - w;
     }
 
   } else if (space == OPENSLIDE_JP2K_YCBCR) {
@@ -124,6 +128,7 @@ static void unpack_argb(enum _openslide_jp2k_colorspace space,
         int16_t B_chroma = _openslide_B_Cb[c1];
         write_pixel_ycbcr(dest++, c0, R_chroma, G_chroma, B_chroma);
       }
+      dest += stride - w;
     }
 
   } else if (space == OPENSLIDE_JP2K_RGB &&
@@ -140,6 +145,7 @@ static void unpack_argb(enum _openslide_jp2k_colorspace space,
         uint8_t c2 = comps[2].data[c2_row_base + x];
         write_pixel_rgb(dest++, c0, c1, c2);
       }
+      dest += stride - w;
     }
 
   } else if (space == OPENSLIDE_JP2K_RGB) {
@@ -162,6 +168,7 @@ static void unpack_argb(enum _openslide_jp2k_colorspace space,
         uint8_t c2 = comps[2].data[c2_row_base + (x / c2_sub_x)];
         write_pixel_rgb(dest++, c0, c1, c2);
       }
+      dest += stride - w;
     }
   }
 }
@@ -216,59 +223,140 @@ static OPJ_BOOL seek_callback(OPJ_OFF_T offset, void *data) {
   return OPJ_TRUE;
 }
 
-bool _openslide_jp2k_decode_buffer(uint32_t *dest,
-                                   int32_t w, int32_t h,
-                                   const void *data, int32_t datalen,
-                                   enum _openslide_jp2k_colorspace space,
-                                   GError **err) {
+// OpenJPEG state for reading one codestream from a buffer
+struct decoder {
+  struct buffer_state state;
+  opj_stream_t *stream;
+  opj_codec_t *codec;
+  opj_image_t *image;
+  GError *tmp_err;  // OpenJPEG's messages
+};
+
+static void decoder_free(struct decoder *dec) {
+  if (dec->image) {
+    opj_image_destroy(dec->image);
+  }
+  if (dec->codec) {
+    opj_destroy_codec(dec->codec);
+  }
+  if (dec->stream) {
+    opj_stream_destroy(dec->stream);
+  }
+  g_clear_error(&dec->tmp_err);
+  g_free(dec);
+}
+
+typedef struct decoder decoder;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(decoder, decoder_free)
+
+static void propagate_error(struct decoder *dec, GError **err,
+                            const char *function) {
+  if (dec->tmp_err) {
+    g_propagate_error(err, dec->tmp_err);
+    dec->tmp_err = NULL;
+  } else {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "%s() failed", function);
+  }
+}
+
+// set up the stream and codec and read the codestream header.  threads
+// > 1 enables OpenJPEG's intra-tile threading, where available.
+static struct decoder *decoder_open(const void *data, int32_t datalen,
+                                    int32_t threads G_GNUC_UNUSED,
+                                    GError **err) {
   g_assert(data != NULL);
   g_assert(datalen >= 0);
 
+  g_autoptr(decoder) dec = g_new0(struct decoder, 1);
+
   // init stream
   // avoid tracking stream offset (and implementing skip callback) by having
   // OpenJPEG read the whole buffer at once
-  g_autoptr(opj_stream_t) stream = opj_stream_create(datalen, true);
-  struct buffer_state state = {
-    .data = data,
-    .length = datalen,
-  };
-  opj_stream_set_user_data(stream, &state, NULL);
-  opj_stream_set_user_data_length(stream, datalen);
-  opj_stream_set_read_function(stream, read_callback);
-  opj_stream_set_skip_function(stream, skip_callback);
-  opj_stream_set_seek_function(stream, seek_callback);
+  dec->stream = opj_stream_create(datalen, true);
+  dec->state.data = data;
+  dec->state.length = datalen;
+  opj_stream_set_user_data(dec->stream, &dec->state, NULL);
+  opj_stream_set_user_data_length(dec->stream, datalen);
+  opj_stream_set_read_function(dec->stream, read_callback);
+  opj_stream_set_skip_function(dec->stream, skip_callback);
+  opj_stream_set_seek_function(dec->stream, seek_callback);
 
   // init codec
-  g_autoptr(opj_codec_t) codec = opj_create_decompress(OPJ_CODEC_J2K);
+  dec->codec = opj_create_decompress(OPJ_CODEC_J2K);
   opj_dparameters_t parameters;
   opj_set_default_decoder_parameters(&parameters);
-  opj_setup_decoder(codec, &parameters);
+  opj_setup_decoder(dec->codec, &parameters);
+#ifdef HAVE_OPJ_CODEC_SET_THREADS
+  // the codec spawns its own threads, so only worthwhile if we aren't
+  // already decoding several tiles in parallel
+  if (threads > 1 && !_openslide_in_parallel_for() &&
+      opj_has_thread_support()) {
+    opj_codec_set_threads(dec->codec, threads);
+  }
+#endif
 
   // enable error handlers
   // note: don't use info_handler, it outputs lots of junk
-  GError *tmp_err = NULL;
-  opj_set_warning_handler(codec, warning_callback, &tmp_err);
-  opj_set_error_handler(codec, error_callback, &tmp_err);
+  opj_set_warning_handler(dec->codec, warning_callback, &dec->tmp_err);
+  opj_set_error_handler(dec->codec, error_callback, &dec->tmp_err);
 
   // read header
-  g_autoptr(opj_image_t) image = NULL;
-  if (!opj_read_header(stream, codec, &image)) {
-    if (tmp_err) {
-      g_propagate_error(err, tmp_err);
-    } else {
-      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                  "opj_read_header() failed");
-    }
+  if (!opj_read_header(dec->stream, dec->codec, &dec->image)) {
+    propagate_error(dec, err, "opj_read_header");
+    return NULL;
+  }
+  g_clear_error(&dec->tmp_err);  // clear any spurious message
+  return g_steal_pointer(&dec);
+}
+
+bool _openslide_jp2k_get_resolutions(const void *data, int32_t datalen,
+                                     int32_t *resolutions,
+                                     GError **err) {
+  g_autoptr(decoder) dec = decoder_open(data, datalen, 1, err);
+  if (!dec) {
     return false;
   }
-  g_clear_error(&tmp_err);  // clear any spurious message
+  opj_codestream_info_v2_t *info = opj_get_cstr_info(dec->codec);
+  if (!info || !info->m_default_tile_info.tccp_info) {
+    opj_destroy_cstr_info(&info);
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Couldn't read JP2K coding parameters");
+    return false;
+  }
+  // the smallest count among the components
+  uint32_t count = UINT32_MAX;
+  for (uint32_t i = 0; i < info->nbcomps; i++) {
+    count = MIN(count, info->m_default_tile_info.tccp_info[i].numresolutions);
+  }
+  opj_destroy_cstr_info(&info);
+  *resolutions = count;
+  return true;
+}
+
+bool _openslide_jp2k_decode_buffer(uint32_t *dest,
+                                   int32_t w, int32_t h,
+                                   const void *data, int32_t datalen,
+                                   enum _openslide_jp2k_colorspace space,
+                                   int32_t scale_denom,
+                                   int32_t threads,
+                                   const struct _openslide_tile_crop *crop,
+                                   GError **err) {
+  g_assert(scale_denom > 0 && (scale_denom & (scale_denom - 1)) == 0);
+
+  g_autoptr(decoder) dec = decoder_open(data, datalen, threads, err);
+  if (!dec) {
+    return false;
+  }
+  opj_image_t *image = dec->image;
 
   // sanity checks
-  if (image->x1 != (OPJ_UINT32) w || image->y1 != (OPJ_UINT32) h) {
+  if (image->x1 != (OPJ_UINT32) w * scale_denom ||
+      image->y1 != (OPJ_UINT32) h * scale_denom) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                 "Dimensional mismatch reading JP2K, "
                 "expected %dx%d, got %ux%u",
-                w, h, image->x1, image->y1);
+                w * scale_denom, h * scale_denom, image->x1, image->y1);
     return false;
   }
   if (image->numcomps != 3) {
@@ -278,20 +366,63 @@ bool _openslide_jp2k_decode_buffer(uint32_t *dest,
   }
   // TODO more checks?
 
-  // decode
-  if (!opj_decode(codec, stream, image)) {
-    if (tmp_err) {
-      g_propagate_error(err, tmp_err);
-    } else {
-      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                  "opj_decode() failed");
+  // discard the highest resolutions, so each halves the decoded size
+  if (scale_denom > 1 &&
+      !opj_set_decoded_resolution_factor(dec->codec,
+                                         g_bit_nth_lsf(scale_denom, -1))) {
+    propagate_error(dec, err, "opj_set_decoded_resolution_factor");
+    return false;
+  }
+
+  // Decode only the area covering crop, if any, in scaled pixels.  Align
+  // it so chroma subsampling doesn't straddle its edges.
+  int32_t area_x = 0;
+  int32_t area_y = 0;
+  int32_t area_w = w;
+  int32_t area_h = h;
+  if (crop && !_openslide_debug(OPENSLIDE_DEBUG_NO_JPEG_CROP)) {
+    int32_t x0 = crop->x & ~(AREA_ALIGN - 1);
+    int32_t y0 = crop->y & ~(AREA_ALIGN - 1);
+    int32_t x1 = MIN((crop->x + crop->w + AREA_ALIGN - 1) &
+                     ~(AREA_ALIGN - 1), w);
+    int32_t y1 = MIN((crop->y + crop->h + AREA_ALIGN - 1) &
+                     ~(AREA_ALIGN - 1), h);
+    if (x0 < x1 && y0 < y1 && (x1 - x0) % 2 == 0 && (y1 - y0) % 2 == 0 &&
+        (x1 - x0 < w || y1 - y0 < h)) {
+      // in full-resolution reference grid coordinates
+      if (!opj_set_decode_area(dec->codec, image,
+                               image->x0 + x0 * scale_denom,
+                               image->y0 + y0 * scale_denom,
+                               image->x0 + x1 * scale_denom,
+                               image->y0 + y1 * scale_denom)) {
+        propagate_error(dec, err, "opj_set_decode_area");
+        return false;
+      }
+      area_x = x0;
+      area_y = y0;
+      area_w = x1 - x0;
+      area_h = y1 - y0;
     }
+  }
+
+  // decode
+  if (!opj_decode(dec->codec, dec->stream, image)) {
+    propagate_error(dec, err, "opj_decode");
+    return false;
+  }
+  g_clear_error(&dec->tmp_err);  // clear any spurious message
+  if (image->comps[0].w != (OPJ_UINT32) area_w ||
+      image->comps[0].h != (OPJ_UINT32) area_h) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Dimensional mismatch decoding JP2K, "
+                "expected %dx%d, got %ux%u",
+                area_w, area_h, image->comps[0].w, image->comps[0].h);
     return false;
   }
-  g_clear_error(&tmp_err);  // clear any spurious message
 
   // copy pixels
-  unpack_argb(space, image->comps, dest, w, h);
+  unpack_argb(space, image->comps, dest + (gsize) area_y * w + area_x,
+              area_w, area_h, w);
 
   return true;
 }
@@ -32,10 +32,24 @@ enum _openslide_jp2k_colorspace {
   OPENSLIDE_JP2K_YCBCR,
 };
 
+// decode at 1/scale_denom size by discarding resolution levels; w and h
+// are the scaled dimensions and scale_denom must be a power of two.
+// threads is the slide's decode thread count.  If crop is non-NULL,
+// decode an area covering it, in scaled pixels; other pixels of dest may
+// be left unchanged.
 bool _openslide_jp2k_decode_buffer(uint32_t *dest,
                                    int32_t w, int32_t h,
                                    const void *data, int32_t datalen,
                                    enum _openslide_jp2k_colorspace space,
+                                   int32_t scale_denom,
+                                   int32_t threads,
+                                   const struct _openslide_tile_crop *crop,
                                    GError **err);
 
+// the number of resolution levels in the codestream, so it can be decoded
+// at up to 1/2^(resolutions - 1) size
+bool _openslide_jp2k_get_resolutions(const void *data, int32_t datalen,
+                                     int32_t *resolutions,
+                                     GError **err);
+
 #endif
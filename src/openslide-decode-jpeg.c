@@ -21,12 +21,15 @@
  *
  */
 
+#include <config.h>
+
 #include "openslide-private.h"
 #include "openslide-decode-jpeg.h"
 
 #include <glib.h>
 #include <setjmp.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
 #include <jpeglib.h>
 #include <jerror.h>
@@ -66,6 +69,10 @@ struct _openslide_jpeg_decompress {
   struct openslide_jpeg_error_mgr jerr;
   JSAMPROW rows[MAX_SAMP_FACTOR];
   bool allocated;
+  bool created;  // jpeg_create_decompress() has been called
+  bool reusable;  // may be returned to the thread's cache
+  bool cropped;
+  struct _openslide_tile_crop crop;
 };
 
 struct associated_image {
@@ -131,27 +138,88 @@ static void *detect_jcs_alpha_extensions(void *arg G_GNUC_UNUSED) {
   }
 }
 
-// the caller must assign the struct _openslide_jpeg_decompress * before
-// calling setjmp() so that nothing will be clobbered by a longjmp()
-struct _openslide_jpeg_decompress *_openslide_jpeg_decompress_create(struct jpeg_decompress_struct **out_cinfo) {
-  struct _openslide_jpeg_decompress *dc =
-    g_new0(struct _openslide_jpeg_decompress, 1);
+static void decompress_free(struct _openslide_jpeg_decompress *dc) {
+  if (dc->created) {
+    jpeg_destroy_decompress(&dc->cinfo);
+  }
+  g_free(dc);
+}
+
+// Each thread keeps one idle decompressor, so that decoding a tile doesn't
+// set up and tear down libjpeg's memory pools.  Tables loaded by an earlier
+// image persist, and libjpeg can't forget them without leaking their
+// memory, so only callers that load tables before every image may reuse
+// one.  Otherwise an image missing its tables would silently decode with
+// another image's.
+static GPrivate cached_decompress =
+  G_PRIVATE_INIT((GDestroyNotify) decompress_free);
+
+// memory sources only; the stdio source manager can't reuse a decompressor
+// set up for a memory source
+static struct _openslide_jpeg_decompress *decompress_create(struct jpeg_decompress_struct **out_cinfo,
+                                                            bool reusable) {
+  struct _openslide_jpeg_decompress *dc = NULL;
+  if (reusable && !_openslide_debug(OPENSLIDE_DEBUG_NO_JPEG_REUSE)) {
+    dc = g_private_get(&cached_decompress);
+    g_private_set(&cached_decompress, NULL);
+  }
+  if (!dc) {
+    dc = g_new0(struct _openslide_jpeg_decompress, 1);
+  }
+  dc->reusable = reusable;
   *out_cinfo = &dc->cinfo;
   return dc;
 }
 
+// the caller must assign the struct _openslide_jpeg_decompress * before
+// calling setjmp() so that nothing will be clobbered by a longjmp().
+struct _openslide_jpeg_decompress *_openslide_jpeg_decompress_create(struct jpeg_decompress_struct **out_cinfo) {
+  return decompress_create(out_cinfo, false);
+}
+
+// as above, but may return this thread's previous decompressor, which
+// still holds the previous image's tables.  The caller must read a
+// tables-only stream before each image, and may only give the
+// decompressor memory sources.
+struct _openslide_jpeg_decompress *_openslide_jpeg_decompress_create_with_tables(struct jpeg_decompress_struct **out_cinfo) {
+  return decompress_create(out_cinfo, true);
+}
+
 // after setjmp(), initialize error handler and start decompressing
 void _openslide_jpeg_decompress_init(struct _openslide_jpeg_decompress *dc,
                                      jmp_buf *env) {
+  dc->jerr.env = env;
+  if (dc->created) {
+    // reused
+    return;
+  }
   jpeg_std_error(&dc->jerr.base);
   dc->jerr.base.error_exit = my_error_exit;
   dc->jerr.base.output_message = my_output_message;
   dc->jerr.base.emit_message = my_emit_message;
-  dc->jerr.env = env;
   dc->cinfo.err = (struct jpeg_error_mgr *) &dc->jerr;
+  dc->created = true;
   jpeg_create_decompress(&dc->cinfo);
 }
 
+void _openslide_jpeg_decompress_set_scale(struct _openslide_jpeg_decompress *dc,
+                                          int32_t scale_denom) {
+  g_assert(scale_denom == 1 || scale_denom == 2 ||
+           scale_denom == 4 || scale_denom == 8);
+  dc->cinfo.scale_num = 1;
+  dc->cinfo.scale_denom = scale_denom;
+}
+
+void _openslide_jpeg_decompress_set_crop(struct _openslide_jpeg_decompress *dc,
+                                         const struct _openslide_tile_crop *crop) {
+  g_assert(crop->x >= 0 && crop->y >= 0 && crop->w > 0 && crop->h > 0);
+  if (_openslide_debug(OPENSLIDE_DEBUG_NO_JPEG_CROP)) {
+    return;
+  }
+  dc->cropped = true;
+  dc->crop = *crop;
+}
+
 bool _openslide_jpeg_decompress_run(struct _openslide_jpeg_decompress *dc,
                                     // uint8_t * if grayscale, else uint32_t *
                                     void *_dest,
@@ -185,23 +253,50 @@ bool _openslide_jpeg_decompress_run(struct _openslide_jpeg_decompress *dc,
   // verify we haven't run already
   g_assert(dc->rows[0] == NULL);
 
+  // rows and columns to decode; others are left unchanged
+  JDIMENSION end_row = height;
+  JDIMENSION first_col = 0;
+  if (dc->cropped) {
+    if (dc->crop.x + dc->crop.w > width ||
+        dc->crop.y + dc->crop.h > height) {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "JPEG crop %dx%d+%d+%d outside %dx%d image",
+                  dc->crop.w, dc->crop.h, dc->crop.x, dc->crop.y,
+                  width, height);
+      return false;
+    }
+    end_row = dc->crop.y + dc->crop.h;
+#ifdef HAVE_JPEG_CROP_SCANLINE
+    // Upsampling treats the edges of the cropped columns as image edges,
+    // so decode one more column on each side.  libjpeg widens the columns
+    // to iMCU boundaries and updates output_width.
+    first_col = MAX(dc->crop.x - 1, 0);
+    JDIMENSION crop_w = MIN(dc->crop.x + dc->crop.w + 1, width) - first_col;
+    jpeg_crop_scanline(cinfo, &first_col, &crop_w);
+    if (dc->crop.y) {
+      jpeg_skip_scanlines(cinfo, dc->crop.y);
+    }
+#endif
+  }
+
   if (cinfo->out_color_space != JCS_RGB) {
     // decode directly to output
 
-    uint8_t *dest = _dest;
     int bytes_per_pixel = cinfo->output_components == 1 ? 1 : 4;
-    while (cinfo->output_scanline < cinfo->output_height) {
+    gsize stride = (gsize) width * bytes_per_pixel;
+    while (cinfo->output_scanline < end_row) {
       // set row pointers
+      uint8_t *dest = (uint8_t *) _dest + cinfo->output_scanline * stride +
+                      first_col * bytes_per_pixel;
       for (int32_t i = 0; i < cinfo->rec_outbuf_height; i++) {
-        dc->rows[i] = cinfo->output_scanline + i < cinfo->output_height ?
-                      dest + i * cinfo->output_width * bytes_per_pixel : NULL;
+        dc->rows[i] = cinfo->output_scanline + i < end_row ?
+                      dest + i * stride : NULL;
       }
 
       // decompress
-      JDIMENSION rows_read = jpeg_read_scanlines(cinfo,
-                                                 dc->rows,
-                                                 cinfo->rec_outbuf_height);
-      dest += rows_read * cinfo->output_width * bytes_per_pixel;
+      jpeg_read_scanlines(cinfo, dc->rows,
+                          MIN((JDIMENSION) cinfo->rec_outbuf_height,
+                              end_row - cinfo->output_scanline));
     }
 
   } else {
@@ -216,11 +311,13 @@ bool _openslide_jpeg_decompress_run(struct _openslide_jpeg_decompress *dc,
     }
 
     // decompress
-    uint32_t *dest = _dest;
-    while (cinfo->output_scanline < cinfo->output_height) {
-      JDIMENSION rows_read = jpeg_read_scanlines(cinfo,
-                                                 dc->rows,
-                                                 cinfo->rec_outbuf_height);
+    while (cinfo->output_scanline < end_row) {
+      uint32_t *dest = (uint32_t *) _dest +
+                       (gsize) cinfo->output_scanline * width + first_col;
+      JDIMENSION rows_read =
+        jpeg_read_scanlines(cinfo, dc->rows,
+                            MIN((JDIMENSION) cinfo->rec_outbuf_height,
+                                end_row - cinfo->output_scanline));
       int cur_row = 0;
       while (rows_read > 0) {
         // copy a row
@@ -230,7 +327,7 @@ bool _openslide_jpeg_decompress_run(struct _openslide_jpeg_decompress *dc,
             dc->rows[cur_row][i * 3 + 1] << 8 |  // G
             dc->rows[cur_row][i * 3 + 2];        // B
         }
-        dest += cinfo->output_width;
+        dest += width;
 
         // advance 1 row
         rows_read--;
@@ -248,17 +345,36 @@ void _openslide_jpeg_propagate_error(GError **err,
 }
 
 void _openslide_jpeg_decompress_destroy(struct _openslide_jpeg_decompress *dc) {
-  jpeg_destroy_decompress(&dc->cinfo);
   g_assert(dc->jerr.err == NULL);
   if (dc->allocated) {
     for (uint32_t row = 0; row < G_N_ELEMENTS(dc->rows); row++) {
       g_free(dc->rows[row]);
     }
   }
-  g_free(dc);
+
+  if (dc->created && dc->reusable &&
+      !_openslide_debug(OPENSLIDE_DEBUG_NO_JPEG_REUSE) &&
+      g_private_get(&cached_decompress) == NULL) {
+    // reset for the next image, keeping the memory pools and source
+    // manager.  Restore default marker processing, in case the caller
+    // saved markers.
+    jpeg_abort_decompress(&dc->cinfo);
+    jpeg_save_markers(&dc->cinfo, JPEG_COM, 0);
+    for (int i = 0; i < 16; i++) {
+      jpeg_save_markers(&dc->cinfo, JPEG_APP0 + i, 0);
+    }
+    memset(dc->rows, 0, sizeof(dc->rows));
+    dc->allocated = false;
+    dc->cropped = false;
+    dc->jerr.env = NULL;
+    g_private_set(&cached_decompress, dc);
+    return;
+  }
+  decompress_free(dc);
 }
 
-static bool jpeg_get_dimensions(struct _openslide_file *f,  // or:
+static bool jpeg_get_dimensions(struct _openslide_file *f, int64_t offset,
+                                // or:
                                 const void *buf, uint32_t buflen,
                                 int32_t *w, int32_t *h,
                                 GError **err) {
@@ -272,7 +388,7 @@ static bool jpeg_get_dimensions(struct _openslide_file *f,  // or:
     _openslide_jpeg_decompress_init(dc, &env);
 
     if (f) {
-      _openslide_jpeg_stdio_src(cinfo, f);
+      _openslide_jpeg_stdio_src(cinfo, f, offset);
     } else {
       _openslide_jpeg_mem_src(cinfo, buf, buflen);
     }
@@ -295,32 +411,43 @@ static bool jpeg_get_dimensions(struct _openslide_file *f,  // or:
   }
 }
 
+static bool check_offset(int64_t offset, GError **err) {
+  if (offset < 0) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Invalid JPEG offset %"PRId64, offset);
+    return false;
+  }
+  return true;
+}
+
 bool _openslide_jpeg_read_dimensions(const char *filename,
                                      int64_t offset,
                                      int32_t *w, int32_t *h,
                                      GError **err) {
-  g_autoptr(_openslide_file) f = _openslide_fopen(filename, err);
-  if (f == NULL) {
+  if (!check_offset(offset, err)) {
     return false;
   }
-  if (offset && !_openslide_fseek(f, offset, SEEK_SET, err)) {
-    g_prefix_error(err, "Cannot seek to offset: ");
+  g_autoptr(_openslide_file) f = _openslide_fopen(filename, err);
+  if (f == NULL) {
     return false;
   }
 
-  return jpeg_get_dimensions(f, NULL, 0, w, h, err);
+  return jpeg_get_dimensions(f, offset, NULL, 0, w, h, err);
 }
 
 bool _openslide_jpeg_decode_buffer_dimensions(const void *buf, uint32_t len,
                                               int32_t *w, int32_t *h,
                                               GError **err) {
-  return jpeg_get_dimensions(NULL, buf, len, w, h, err);
+  return jpeg_get_dimensions(NULL, 0, buf, len, w, h, err);
 }
 
-static bool jpeg_decode(struct _openslide_file *f,  // or:
+static bool jpeg_decode(struct _openslide_file *f, int64_t offset,
+                        // or:
                         const void *buf, uint32_t buflen,
                         void *dest, bool grayscale,
+                        int32_t scale_denom,
                         int32_t w, int32_t h,
+                        const struct _openslide_tile_crop *crop,  // optional
                         GError **err) {
   jmp_buf env;
 
@@ -333,7 +460,7 @@ static bool jpeg_decode(struct _openslide_file *f,  // or:
 
     // set up I/O
     if (f) {
-      _openslide_jpeg_stdio_src(cinfo, f);
+      _openslide_jpeg_stdio_src(cinfo, f, offset);
     } else {
       _openslide_jpeg_mem_src(cinfo, buf, buflen);
     }
@@ -344,6 +471,10 @@ static bool jpeg_decode(struct _openslide_file *f,  // or:
                   "Couldn't read JPEG header");
       return false;
     }
+    _openslide_jpeg_decompress_set_scale(dc, scale_denom);
+    if (crop) {
+      _openslide_jpeg_decompress_set_crop(dc, crop);
+    }
 
     // decompress
     if (!_openslide_jpeg_decompress_run(dc, dest, grayscale, w, h, err)) {
@@ -368,12 +499,18 @@ bool _openslide_jpeg_read(const char *filename,
   if (f == NULL) {
     return false;
   }
-  if (offset && !_openslide_fseek(f, offset, SEEK_SET, err)) {
-    g_prefix_error(err, "Cannot seek to offset: ");
+  return _openslide_jpeg_read_file(f, offset, dest, w, h, err);
+}
+
+bool _openslide_jpeg_read_file(struct _openslide_file *f,
+                               int64_t offset,
+                               uint32_t *dest,
+                               int32_t w, int32_t h,
+                               GError **err) {
+  if (!check_offset(offset, err)) {
     return false;
   }
-
-  return jpeg_decode(f, NULL, 0, dest, false, w, h, err);
+  return jpeg_decode(f, offset, NULL, 0, dest, false, 1, w, h, NULL, err);
 }
 
 bool _openslide_jpeg_decode_buffer(const void *buf, uint32_t len,
@@ -382,7 +519,17 @@ bool _openslide_jpeg_decode_buffer(const void *buf, uint32_t len,
                                    GError **err) {
   //g_debug("decode JPEG buffer: %x %u", buf, len);
 
-  return jpeg_decode(NULL, buf, len, dest, false, w, h, err);
+  return jpeg_decode(NULL, 0, buf, len, dest, false, 1, w, h, NULL, err);
+}
+
+bool _openslide_jpeg_decode_buffer_cropped(const void *buf, uint32_t len,
+                                           uint32_t *dest,
+                                           int32_t scale_denom,
+                                           int32_t w, int32_t h,
+                                           const struct _openslide_tile_crop *crop,
+                                           GError **err) {
+  return jpeg_decode(NULL, 0, buf, len, dest, false, scale_denom, w, h,
+                     crop, err);
 }
 
 bool _openslide_jpeg_decode_buffer_gray(const void *buf, uint32_t len,
@@ -391,7 +538,7 @@ bool _openslide_jpeg_decode_buffer_gray(const void *buf, uint32_t len,
                                         GError **err) {
   //g_debug("decode grayscale JPEG buffer: %x %u", buf, len);
 
-  return jpeg_decode(NULL, buf, len, dest, true, w, h, err);
+  return jpeg_decode(NULL, 0, buf, len, dest, true, 1, w, h, NULL, err);
 }
 
 static bool get_associated_image_data(struct _openslide_associated_image *_img,
@@ -439,3 +586,28 @@ bool _openslide_jpeg_add_associated_image(openslide_t *osr,
 
   return true;
 }
+
+void _openslide_jpeg_add_scaled_levels(openslide_t *osr,
+                                       GPtrArray *levels,
+                                       _openslide_jpeg_scaled_level_fn create,
+                                       void *ctx) {
+  for (guint i = 0; i + 1 < levels->len; i++) {
+    struct _openslide_level *l = levels->pdata[i];
+    struct _openslide_level *next = levels->pdata[i + 1];
+    guint insert_pos = i + 1;
+
+    // add each scale while it's at least twice as wide as the next level
+    for (int32_t scale_denom = 2; scale_denom <= 8; scale_denom <<= 1) {
+      if (l->w / scale_denom < 2 * next->w) {
+        break;
+      }
+      struct _openslide_level *sd_l = create(osr, l, scale_denom, ctx);
+      if (sd_l) {
+        g_ptr_array_insert(levels, insert_pos++, sd_l);
+      }
+    }
+
+    // skip past the virtual levels
+    i = insert_pos - 1;
+  }
+}
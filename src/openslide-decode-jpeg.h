@@ -43,11 +43,29 @@ bool _openslide_jpeg_read(const char *filename,
                           int32_t w, int32_t h,
                           GError **err);
 
+// positional reads; f may be shared
+bool _openslide_jpeg_read_file(struct _openslide_file *f,
+                               int64_t offset,
+                               uint32_t *dest,
+                               int32_t w, int32_t h,
+                               GError **err);
+
 bool _openslide_jpeg_decode_buffer(const void *buf, uint32_t len,
                                    uint32_t *dest,
                                    int32_t w, int32_t h,
                                    GError **err);
 
+// decode at 1/scale_denom size, by scaling in the DCT domain.  w and h
+// are the scaled dimensions.  If crop is non-NULL, decode the rows and
+// columns covering it, in scaled pixels; other pixels of dest may be left
+// unchanged.
+bool _openslide_jpeg_decode_buffer_cropped(const void *buf, uint32_t len,
+                                           uint32_t *dest,
+                                           int32_t scale_denom,
+                                           int32_t w, int32_t h,
+                                           const struct _openslide_tile_crop *crop,
+                                           GError **err);
+
 bool _openslide_jpeg_decode_buffer_gray(const void *buf, uint32_t len,
                                         uint8_t *dest,
                                         int32_t w, int32_t h,
@@ -64,7 +82,8 @@ bool _openslide_jpeg_add_associated_image(openslide_t *osr,
  * So we need to compile all our freading into the OpenSlide DLL directly.
  */
 void _openslide_jpeg_stdio_src(j_decompress_ptr cinfo,
-                               struct _openslide_file *infile);
+                               struct _openslide_file *infile,
+                               int64_t offset);
 
 /*
  * Some libjpegs don't provide mem_src, so we have our own copy.
@@ -78,9 +97,24 @@ void _openslide_jpeg_mem_src (j_decompress_ptr cinfo,
  */
 struct _openslide_jpeg_decompress *_openslide_jpeg_decompress_create(struct jpeg_decompress_struct **out_cinfo);
 
+// for callers that read a tables-only stream before every image; reuses
+// this thread's previous decompressor
+struct _openslide_jpeg_decompress *_openslide_jpeg_decompress_create_with_tables(struct jpeg_decompress_struct **out_cinfo);
+
 void _openslide_jpeg_decompress_init(struct _openslide_jpeg_decompress *dc,
                                      jmp_buf *env);
 
+// after jpeg_read_header(), decode at 1/scale_denom size; scale_denom must
+// be 1, 2, 4, or 8
+void _openslide_jpeg_decompress_set_scale(struct _openslide_jpeg_decompress *dc,
+                                          int32_t scale_denom);
+
+// after jpeg_read_header(), have _openslide_jpeg_decompress_run() skip
+// rows and columns not covering crop where libjpeg can, leaving those
+// pixels of the destination unchanged
+void _openslide_jpeg_decompress_set_crop(struct _openslide_jpeg_decompress *dc,
+                                         const struct _openslide_tile_crop *crop);
+
 bool _openslide_jpeg_decompress_run(struct _openslide_jpeg_decompress *dc,
                                     // uint8_t * if grayscale, else uint32_t *
                                     void *dest,
@@ -93,6 +127,24 @@ void _openslide_jpeg_propagate_error(GError **err,
 
 void _openslide_jpeg_decompress_destroy(struct _openslide_jpeg_decompress *dc);
 
+/*
+ * Virtual levels decoded at reduced DCT scale
+ */
+// returns a level reading the parent's tiles at 1/scale_denom size, or
+// NULL if the parent can't be read that way
+typedef struct _openslide_level *(*_openslide_jpeg_scaled_level_fn)(openslide_t *osr,
+                                                                    struct _openslide_level *parent,
+                                                                    int32_t scale_denom,
+                                                                    void *ctx);
+
+// levels must be sorted by decreasing width.  Inserts virtual levels where
+// a level is more than twice as wide as the next one, so sparse pyramids
+// can be read without decoding far more pixels than needed.
+void _openslide_jpeg_add_scaled_levels(openslide_t *osr,
+                                       GPtrArray *levels,
+                                       _openslide_jpeg_scaled_level_fn create,
+                                       void *ctx);
+
 // volatile pointer, to ensure clang doesn't incorrectly optimize field
 // accesses after setjmp() returns again in the function allocating the struct
 // https://github.com/llvm/llvm-project/issues/57110
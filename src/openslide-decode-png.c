@@ -183,27 +183,29 @@ static bool png_read(png_rw_ptr read_callback, void *callback_data,
   return true;
 }
 
+struct file {
+  struct _openslide_file *f;
+  int64_t offset;
+};
+
 static void file_read_callback(png_struct *png, png_byte *buf, png_size_t len) {
-  struct _openslide_file *f = png_get_io_ptr(png);
-  if (_openslide_fread(f, buf, len) != len) {
+  struct file *file = png_get_io_ptr(png);
+  if (_openslide_fread_at(file->f, file->offset, buf, len) != len) {
     png_error(png, "Read failed");
   }
+  file->offset += len;
 }
 
-bool _openslide_png_read(const char *filename,
-                         int64_t offset,
-                         uint32_t *dest,
-                         int64_t w, int64_t h,
-                         GError **err) {
-  g_autoptr(_openslide_file) f = _openslide_fopen(filename, err);
-  if (!f) {
-    return false;
-  }
-  if (!_openslide_fseek(f, offset, SEEK_SET, err)) {
-    g_prefix_error(err, "Couldn't fseek %s: ", filename);
-    return false;
-  }
-  return png_read(file_read_callback, f, dest, w, h, err);
+bool _openslide_png_read_file(struct _openslide_file *f,
+                              int64_t offset,
+                              uint32_t *dest,
+                              int64_t w, int64_t h,
+                              GError **err) {
+  struct file file = {
+    .f = f,
+    .offset = offset,
+  };
+  return png_read(file_read_callback, &file, dest, w, h, err);
 }
 
 struct mem {
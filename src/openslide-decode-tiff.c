@@ -22,6 +22,7 @@
 
 #include "openslide-private.h"
 #include "openslide-decode-tiff.h"
+#include "openslide-decode-tifflike.h"
 #include "openslide-decode-jpeg.h"
 
 #include <glib.h>
@@ -35,21 +36,60 @@
 #include "openslide-hash.h"
 
 #define HANDLE_CACHE_MAX 32
+// most tile data to read ahead for one region
+#define FETCH_MAX_BYTES (64 << 20)
 
 struct _openslide_tiffcache {
   char *filename;
+  struct _openslide_shared_file *file;
   GQueue *cache;
   GMutex lock;
   int outstanding;
+  GPtrArray *tiles;  // struct _openslide_tiff_tiles
+};
+
+// a level's tile locations, read from the file as needed, so tiles can be
+// read from any thread without a TIFF handle
+struct _openslide_tiff_tiles {
+  struct _openslide_tiffcache *tc;
+  struct _openslide_tifflike_array *offsets;
+  struct _openslide_tifflike_array *sizes;
+  uint8_t *jpeg_tables;  // or NULL
+  uint32_t jpeg_tables_len;
 };
 
 // not thread-safe, like libtiff
 struct tiff_file_handle {
   struct _openslide_tiffcache *tc;
+  struct _openslide_shared_file *file;  // owned by tc
   int64_t offset;
   int64_t size;
 };
 
+// tile data read ahead by a batch fetch, waiting for
+// _openslide_tiff_read_tile_data()
+struct _openslide_tiff_fetch {
+  struct _openslide_tiffcache *tc;
+  struct _openslide_tiff_level *tiffl;
+  GMutex lock;
+  GHashTable *staged;  // ttile_t -> struct staged_tile
+};
+
+// concurrent paints of overlapping regions may stage the same tile, so
+// the entry lasts until every batch that staged it is released
+struct staged_tile {
+  ttile_t tile_no;
+  void *buf;  // NULL once consumed
+  int32_t len;
+  uint32_t batches;
+};
+
+struct fetch_batch {
+  struct _openslide_tiff_fetch *tf;
+  GArray *reqs;  // struct _openslide_read_req
+  GArray *tile_nos;  // ttile_t, parallel to reqs
+};
+
 struct associated_image {
   struct _openslide_associated_image base;
   struct _openslide_tiffcache *tc;
@@ -147,11 +187,62 @@ bool _openslide_tiff_level_init(TIFF *tiff,
 
     tiffl->tile_read_direct = read_direct;
     tiffl->photometric = photometric;
+    tiffl->compression = compression;
+    tiffl->scale_denom = 1;
   }
 
   return true;
 }
 
+bool _openslide_tiff_level_init_scaled(const struct _openslide_level *parent,
+                                       const struct _openslide_tiff_level *parent_tiffl,
+                                       int32_t scale_denom,
+                                       bool caller_decodes,
+                                       struct _openslide_level *level,
+                                       struct _openslide_tiff_level *tiffl) {
+  // decoders scale whole tiles, so their sizes must divide evenly
+  if (!(parent_tiffl->tile_read_direct || caller_decodes) ||
+      parent_tiffl->scale_denom > 1 ||
+      parent_tiffl->tile_w % scale_denom ||
+      parent_tiffl->tile_h % scale_denom) {
+    return false;
+  }
+
+  level->w = parent->w / scale_denom;
+  level->h = parent->h / scale_denom;
+  // zero if computed later
+  level->downsample = parent->downsample * scale_denom;
+  // tile size hints
+  level->tile_w = parent->tile_w / scale_denom;
+  level->tile_h = parent->tile_h / scale_denom;
+
+  // same directory and tiles, but not the parent's batch fetch
+  *tiffl = *parent_tiffl;
+  tiffl->image_w = parent_tiffl->image_w / scale_denom;
+  tiffl->image_h = parent_tiffl->image_h / scale_denom;
+  tiffl->tile_w = parent_tiffl->tile_w / scale_denom;
+  tiffl->tile_h = parent_tiffl->tile_h / scale_denom;
+  tiffl->scale_denom = scale_denom;
+  tiffl->warned_read_indirect = 0;
+  tiffl->fetch = NULL;
+  return true;
+}
+
+// TIFFComputeTile() needs the directory's tile size, which virtual levels
+// don't have.  For the contiguous images we read directly, tiles are
+// numbered in row-major order.
+static ttile_t get_tile_no(struct _openslide_tiff_level *tiffl,
+                           TIFF *tiff,
+                           int64_t tile_col, int64_t tile_row) {
+  if (tiffl->tiles || tiffl->scale_denom > 1) {
+    return tile_row * tiffl->tiles_across + tile_col;
+  }
+  return TIFFComputeTile(tiff,
+                         tile_col * tiffl->tile_w,
+                         tile_row * tiffl->tile_h,
+                         0, 0);
+}
+
 // clip right/bottom edges of tile in last row/column
 bool _openslide_tiff_clip_tile(struct _openslide_tiff_level *tiffl,
                                uint32_t *tiledata,
@@ -210,13 +301,18 @@ static bool tiff_read_region(TIFF *tiff,
 static bool decode_jpeg(const void *buf, uint32_t buflen,
                         const void *tables, uint32_t tables_len,  // optional
                         J_COLOR_SPACE space,
+                        int32_t scale_denom,
                         uint32_t *dest,
                         int32_t w, int32_t h,
+                        const struct _openslide_tile_crop *crop,  // optional
                         GError **err) {
   jmp_buf env;
 
+  // a reused decompressor keeps the last image's tables, so only reuse
+  // one if we're about to replace them
   struct jpeg_decompress_struct *cinfo;
-  g_auto(_openslide_jpeg_decompress) dc =
+  g_auto(_openslide_jpeg_decompress) dc = tables ?
+    _openslide_jpeg_decompress_create_with_tables(&cinfo) :
     _openslide_jpeg_decompress_create(&cinfo);
 
   if (setjmp(env) == 0) {
@@ -244,6 +340,10 @@ static bool decode_jpeg(const void *buf, uint32_t buflen,
 
     // set color space from TIFF photometric tag (for Aperio)
     cinfo->jpeg_color_space = space;
+    _openslide_jpeg_decompress_set_scale(dc, scale_denom);
+    if (crop) {
+      _openslide_jpeg_decompress_set_crop(dc, crop);
+    }
 
     // decompress
     if (!_openslide_jpeg_decompress_run(dc, dest, false, w, h, err)) {
@@ -257,14 +357,40 @@ static bool decode_jpeg(const void *buf, uint32_t buflen,
   }
 }
 
+// sets the directory if reading through libtiff
+static bool get_jpeg_tables(struct _openslide_tiff_level *tiffl,
+                            TIFF *tiff,
+                            const void **tables, uint32_t *tables_len,
+                            GError **err) {
+  if (tiffl->tiles) {
+    *tables = tiffl->tiles->jpeg_tables;
+    *tables_len = tiffl->tiles->jpeg_tables_len;
+    return true;
+  }
+  SET_DIR_OR_FAIL(tiff, tiffl->dir);
+  if (!TIFFGetField(tiff, TIFFTAG_JPEGTABLES, tables_len, tables)) {
+    // no separate tables
+    *tables = NULL;
+    *tables_len = 0;
+  }
+  return true;
+}
+
 bool _openslide_tiff_read_tile(struct _openslide_tiff_level *tiffl,
                                TIFF *tiff,
                                uint32_t *dest,
                                int64_t tile_col, int64_t tile_row,
                                GError **err) {
-  // set directory
-  SET_DIR_OR_FAIL(tiff, tiffl->dir);
+  return _openslide_tiff_read_tile_cropped(tiffl, tiff, dest,
+                                           tile_col, tile_row, NULL, err);
+}
 
+bool _openslide_tiff_read_tile_cropped(struct _openslide_tiff_level *tiffl,
+                                       TIFF *tiff,
+                                       uint32_t *dest,
+                                       int64_t tile_col, int64_t tile_row,
+                                       const struct _openslide_tile_crop *crop,
+                                       GError **err) {
   if (tiffl->tile_read_direct) {
     // Fast path: read raw data, decode through libjpeg
     // Reading through tiff_read_region() reformats pixel data in three
@@ -274,57 +400,158 @@ bool _openslide_tiff_read_tile(struct _openslide_tiff_level *tiffl,
     // libjpeg-turbo.
 
     // read tables
-    void *tables;
+    const void *tables;
     uint32_t tables_len;
-    if (!TIFFGetField(tiff, TIFFTAG_JPEGTABLES, &tables_len, &tables)) {
-      // no separate tables
-      tables = NULL;
-      tables_len = 0;
+    if (!get_jpeg_tables(tiffl, tiff, &tables, &tables_len, err)) {
+      return false;
     }
 
     // read data
-    g_autofree void *buf = NULL;
+    const void *buf;
     int32_t buflen;
-    if (!_openslide_tiff_read_tile_data(tiffl, tiff,
-                                        &buf, &buflen,
-                                        tile_col, tile_row,
-                                        err)) {
+    g_autofree void *owned = NULL;
+    if (!_openslide_tiff_read_tile_data_borrowed(tiffl, tiff,
+                                                 &buf, &buflen, &owned,
+                                                 tile_col, tile_row,
+                                                 err)) {
       return false;
     }
 
     // decompress
     return decode_jpeg(buf, buflen, tables, tables_len,
                        tiffl->photometric == PHOTOMETRIC_YCBCR ? JCS_YCbCr : JCS_RGB,
+                       tiffl->scale_denom,
                        dest,
                        tiffl->tile_w, tiffl->tile_h,
+                       crop,
                        err);
   } else {
     // Fallback: read tile through libtiff
+    // virtual levels are only created for directly-read levels
+    g_assert(tiffl->scale_denom <= 1);
     _openslide_performance_warn_once(&tiffl->warned_read_indirect,
                                      "Using slow libtiff read path for "
                                      "directory %d", tiffl->dir);
+    g_auto(_openslide_cached_tiff) ct = {0};
+    if (!tiff) {
+      // level is otherwise read without a handle
+      ct = _openslide_tiffcache_get(tiffl->tiles->tc, err);
+      if (!ct.tiff) {
+        return false;
+      }
+      tiff = ct.tiff;
+    }
+    SET_DIR_OR_FAIL(tiff, tiffl->dir);
     return tiff_read_region(tiff, dest,
                             tile_col * tiffl->tile_w, tile_row * tiffl->tile_h,
                             tiffl->tile_w, tiffl->tile_h, err);
   }
 }
 
+static bool read_tile_data_direct(struct _openslide_tiff_tiles *tiles,
+                                  ttile_t tile_no,
+                                  const void **_buf, int32_t *_len,
+                                  void **_owned,
+                                  GError **err) {
+  g_auto(_openslide_pinned_file) pf =
+    _openslide_shared_file_get(tiles->tc->file, err);
+  if (pf.file == NULL) {
+    return false;
+  }
+
+  uint64_t tile_offset;
+  uint64_t tile_size;
+  if (!_openslide_tifflike_array_get(tiles->offsets, pf.file, tile_no,
+                                     &tile_offset, err) ||
+      !_openslide_tifflike_array_get(tiles->sizes, pf.file, tile_no,
+                                     &tile_size, err)) {
+    return false;
+  }
+  if (tile_size > G_MAXINT32) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Tile size too large: %"PRIu64, tile_size);
+    return false;
+  }
+
+  // a mapping lasts until the slide is closed, so it can be borrowed
+  // after the pin is dropped
+  const void *map = _openslide_fmap(pf.file, tile_offset, tile_size);
+  if (map) {
+    *_buf = map;
+    *_len = tile_size;
+    *_owned = NULL;
+    return true;
+  }
+
+  g_autofree void *buf = g_malloc(tile_size);
+  if (_openslide_fread_at(pf.file, tile_offset,
+                          buf, tile_size) != tile_size) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Cannot read raw tile");
+    return false;
+  }
+
+  *_buf = buf;
+  *_len = tile_size;
+  *_owned = g_steal_pointer(&buf);
+  return true;
+}
+
 bool _openslide_tiff_read_tile_data(struct _openslide_tiff_level *tiffl,
                                     TIFF *tiff,
                                     void **_buf, int32_t *_len,
                                     int64_t tile_col, int64_t tile_row,
                                     GError **err) {
-  // set directory
-  SET_DIR_OR_FAIL(tiff, tiffl->dir);
+  const void *buf;
+  int32_t len;
+  void *owned;
+  if (!_openslide_tiff_read_tile_data_borrowed(tiffl, tiff,
+                                               &buf, &len, &owned,
+                                               tile_col, tile_row, err)) {
+    return false;
+  }
+  *_buf = owned ? owned : g_memdup(buf, len);
+  *_len = len;
+  return true;
+}
 
+bool _openslide_tiff_read_tile_data_borrowed(struct _openslide_tiff_level *tiffl,
+                                             TIFF *tiff,
+                                             const void **_buf, int32_t *_len,
+                                             void **_owned,
+                                             int64_t tile_col, int64_t tile_row,
+                                             GError **err) {
   // get tile number
-  ttile_t tile_no = TIFFComputeTile(tiff,
-                                    tile_col * tiffl->tile_w,
-                                    tile_row * tiffl->tile_h,
-                                    0, 0);
+  if (!tiffl->tiles) {
+    SET_DIR_OR_FAIL(tiff, tiffl->dir);
+  }
+  ttile_t tile_no = get_tile_no(tiffl, tiff, tile_col, tile_row);
 
   //g_debug("_openslide_tiff_read_tile_data reading tile %d", tile_no);
 
+  // already read by a batch fetch?
+  if (tiffl->fetch) {
+    struct _openslide_tiff_fetch *tf = tiffl->fetch;
+    g_mutex_lock(&tf->lock);
+    struct staged_tile *st = g_hash_table_lookup(tf->staged, &tile_no);
+    void *buf = NULL;
+    if (st && st->buf) {
+      buf = g_steal_pointer(&st->buf);
+      *_len = st->len;
+    }
+    g_mutex_unlock(&tf->lock);
+    if (buf) {
+      *_buf = buf;
+      *_owned = buf;
+      return true;
+    }
+  }
+
+  if (tiffl->tiles) {
+    return read_tile_data_direct(tiffl->tiles, tile_no,
+                                 _buf, _len, _owned, err);
+  }
+
   // get tile size
   toff_t *sizes;
   if (TIFFGetField(tiff, TIFFTAG_TILEBYTECOUNTS, &sizes) == 0) {
@@ -344,11 +571,69 @@ bool _openslide_tiff_read_tile_data(struct _openslide_tiff_level *tiffl,
   }
 
   // set outputs
-  *_buf = g_steal_pointer(&buf);
+  *_buf = buf;
   *_len = size;
+  *_owned = g_steal_pointer(&buf);
   return true;
 }
 
+void *_openslide_tiff_read_raw_tile(struct _openslide_tiff_level *tiffl,
+                                    TIFF *tiff,
+                                    int64_t tile_col, int64_t tile_row,
+                                    enum openslide_tile_codec *codec,
+                                    size_t *len,
+                                    GError **err) {
+  // JPEG with RGB photometric has no marker telling a standalone decoder
+  // to skip the YCbCr conversion.  Virtual levels have no stored tiles.
+  if (!tiffl->tile_read_direct ||
+      tiffl->photometric != PHOTOMETRIC_YCBCR ||
+      tiffl->scale_denom > 1) {
+    return NULL;
+  }
+
+  // read data
+  g_autofree uint8_t *buf = NULL;
+  int32_t buflen;
+  if (!_openslide_tiff_read_tile_data(tiffl, tiff,
+                                      (void **) &buf, &buflen,
+                                      tile_col, tile_row,
+                                      err)) {
+    return NULL;
+  }
+  // missing tile, or not a JPEG image
+  if (buflen < 4 || buf[0] != 0xFF || buf[1] != 0xD8) {
+    return NULL;
+  }
+
+  // read tables
+  const uint8_t *tables;
+  uint32_t tables_len;
+  if (!get_jpeg_tables(tiffl, tiff, (const void **) &tables, &tables_len,
+                       err)) {
+    return NULL;
+  }
+
+  *codec = OPENSLIDE_TILE_CODEC_JPEG;
+  if (!tables) {
+    *len = buflen;
+    return g_steal_pointer(&buf);
+  }
+
+  // tables are an abbreviated JPEG stream: SOI, tables, EOI.  splice them
+  // between the tile's SOI and the rest of the tile.
+  if (tables_len < 4 ||
+      tables[0] != 0xFF || tables[1] != 0xD8 ||
+      tables[tables_len - 2] != 0xFF || tables[tables_len - 1] != 0xD9) {
+    return NULL;
+  }
+  size_t merged_len = (tables_len - 2) + (buflen - 2);
+  uint8_t *merged = g_malloc(merged_len);
+  memcpy(merged, tables, tables_len - 2);
+  memcpy(merged + tables_len - 2, buf + 2, buflen - 2);
+  *len = merged_len;
+  return merged;
+}
+
 // sets out-argument to indicate whether the tile data is zero bytes long
 // returns false on error
 bool _openslide_tiff_check_missing_tile(struct _openslide_tiff_level *tiffl,
@@ -356,16 +641,29 @@ bool _openslide_tiff_check_missing_tile(struct _openslide_tiff_level *tiffl,
                                         int64_t tile_col, int64_t tile_row,
                                         bool *is_missing,
                                         GError **err) {
+  if (tiffl->tiles) {
+    g_auto(_openslide_pinned_file) pf =
+      _openslide_shared_file_get(tiffl->tiles->tc->file, err);
+    if (pf.file == NULL) {
+      return false;
+    }
+    int64_t tile_no = tile_row * tiffl->tiles_across + tile_col;
+    uint64_t tile_size;
+    if (!_openslide_tifflike_array_get(tiffl->tiles->sizes, pf.file, tile_no,
+                                       &tile_size, err)) {
+      return false;
+    }
+    *is_missing = tile_size == 0;
+    return true;
+  }
+
   // set directory
   if (!_openslide_tiff_set_dir(tiff, tiffl->dir, err)) {
     return false;
   }
 
   // get tile number
-  ttile_t tile_no = TIFFComputeTile(tiff,
-                                    tile_col * tiffl->tile_w,
-                                    tile_row * tiffl->tile_h,
-                                    0, 0);
+  ttile_t tile_no = get_tile_no(tiffl, tiff, tile_col, tile_row);
 
   //g_debug("_openslide_tiff_check_missing_tile: tile %d", tile_no);
 
@@ -486,16 +784,13 @@ bool _openslide_tiff_add_associated_image(openslide_t *osr,
 static tsize_t tiff_do_read(thandle_t th, tdata_t buf, tsize_t size) {
   struct tiff_file_handle *hdl = th;
 
-  // don't leave the file handle open between calls
-  // also ensures FD_CLOEXEC is set
-  g_autoptr(_openslide_file) f = _openslide_fopen(hdl->tc->filename, NULL);
-  if (f == NULL) {
-    return 0;
-  }
-  if (!_openslide_fseek(f, hdl->offset, SEEK_SET, NULL)) {
+  // pin the file only while reading, so idle handles don't hold it open
+  g_auto(_openslide_pinned_file) pf =
+    _openslide_shared_file_get(hdl->file, NULL);
+  if (pf.file == NULL) {
     return 0;
   }
-  int64_t rsize = _openslide_fread(f, buf, size);
+  int64_t rsize = _openslide_fread_at(pf.file, hdl->offset, buf, size);
   hdl->offset += rsize;
   return rsize;
 }
@@ -539,17 +834,45 @@ static toff_t tiff_do_size(thandle_t th) {
   return hdl->size;
 }
 
+// only if the shared file is already mapped; see OPENSLIDE_MMAP
+static int tiff_do_map(thandle_t th, tdata_t *base, toff_t *size) {
+  struct tiff_file_handle *hdl = th;
+
+  // mapped files are never closed by the pool, so the mapping outlives
+  // the pin
+  g_auto(_openslide_pinned_file) pf =
+    _openslide_shared_file_get(hdl->file, NULL);
+  if (pf.file == NULL) {
+    return 0;
+  }
+  const void *map = _openslide_fmap(pf.file, 0, hdl->size);
+  if (map == NULL) {
+    return 0;
+  }
+  *base = (tdata_t) map;
+  *size = hdl->size;
+  return 1;
+}
+
+static void tiff_do_unmap(thandle_t th G_GNUC_UNUSED,
+                          tdata_t base G_GNUC_UNUSED,
+                          toff_t size G_GNUC_UNUSED) {
+  // the mapping belongs to the shared file
+}
+
 #undef TIFFClientOpen
 static TIFF *tiff_open(struct _openslide_tiffcache *tc, GError **err) {
-  // open
-  g_autoptr(_openslide_file) f = _openslide_fopen(tc->filename, err);
+  // open, or reuse the shared file
+  g_auto(_openslide_pinned_file) pf =
+    _openslide_shared_file_get(tc->file, err);
+  struct _openslide_file *f = pf.file;
   if (f == NULL) {
     return NULL;
   }
 
   // read magic
   uint8_t buf[4];
-  if (_openslide_fread(f, buf, 4) != 4) {
+  if (_openslide_fread_at(f, 0, buf, 4) != 4) {
     // can't read
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                 "Couldn't read TIFF magic number for %s", tc->filename);
@@ -594,13 +917,19 @@ static TIFF *tiff_open(struct _openslide_tiffcache *tc, GError **err) {
   // allocate
   struct tiff_file_handle *hdl = g_new0(struct tiff_file_handle, 1);
   hdl->tc = tc;
+  hdl->file = tc->file;
   hdl->size = size;
 
   // TIFFOpen
-  // mode: m disables mmap to avoid sigbus and other mmap fragility
-  TIFF *tiff = TIFFClientOpen(tc->filename, "rm", hdl,
+  // libtiff only maps the file if the user opted in to mmap and its
+  // fragility, since our map proc fails otherwise.  With "O", libtiff
+  // >= 4.1 reads tile offsets and byte counts on demand rather than
+  // loading whole arrays on every directory change; older versions
+  // ignore it.
+  TIFF *tiff = TIFFClientOpen(tc->filename, "rO", hdl,
                               tiff_do_read, tiff_do_write, tiff_do_seek,
-                              tiff_do_close, tiff_do_size, NULL, NULL);
+                              tiff_do_close, tiff_do_size,
+                              tiff_do_map, tiff_do_unmap);
   if (tiff == NULL) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                 "Invalid TIFF: %s", tc->filename);
@@ -610,11 +939,20 @@ static TIFF *tiff_open(struct _openslide_tiffcache *tc, GError **err) {
 }
 #define TIFFClientOpen _OPENSLIDE_POISON(_openslide_tiffcache_get)
 
+static void tiles_free(struct _openslide_tiff_tiles *tiles) {
+  _openslide_tifflike_array_destroy(tiles->offsets);
+  _openslide_tifflike_array_destroy(tiles->sizes);
+  g_free(tiles->jpeg_tables);
+  g_free(tiles);
+}
+
 struct _openslide_tiffcache *_openslide_tiffcache_create(const char *filename) {
   struct _openslide_tiffcache *tc = g_new0(struct _openslide_tiffcache, 1);
   tc->filename = g_strdup(filename);
+  tc->file = _openslide_shared_file_create(filename);
   tc->cache = g_queue_new();
   g_mutex_init(&tc->lock);
+  tc->tiles = g_ptr_array_new_with_free_func((GDestroyNotify) tiles_free);
   return tc;
 }
 
@@ -628,8 +966,7 @@ struct _openslide_cached_tiff _openslide_tiffcache_get(struct _openslide_tiffcac
 
   if (tiff == NULL) {
     //g_debug("create TIFF");
-    // Does not check that we have the same file.  Then again, neither does
-    // tiff_do_read.
+    // all handles read through the same shared file
     tiff = tiff_open(tc, err);
   }
   if (tiff == NULL) {
@@ -667,6 +1004,17 @@ void _openslide_cached_tiff_put(struct _openslide_cached_tiff *ct) {
   }
 }
 
+bool _openslide_tiffcache_get_for_level(struct _openslide_tiffcache *tc,
+                                        struct _openslide_tiff_level *tiffl,
+                                        struct _openslide_cached_tiff *ct,
+                                        GError **err) {
+  if (tiffl->tiles) {
+    return true;
+  }
+  *ct = _openslide_tiffcache_get(tc, err);
+  return ct->tiff != NULL;
+}
+
 void _openslide_tiffcache_destroy(struct _openslide_tiffcache *tc) {
   if (tc == NULL) {
     return;
@@ -680,6 +1028,243 @@ void _openslide_tiffcache_destroy(struct _openslide_tiffcache *tc) {
   g_mutex_unlock(&tc->lock);
   g_queue_free(tc->cache);
   g_mutex_clear(&tc->lock);
+  g_ptr_array_free(tc->tiles, true);
+  _openslide_shared_file_destroy(tc->file);
   g_free(tc->filename);
   g_free(tc);
 }
+
+static void *grid_get_tiff(void *ctx, GError **err) {
+  struct _openslide_cached_tiff ct = _openslide_tiffcache_get(ctx, err);
+  return ct.tiff;
+}
+
+static void grid_put_tiff(void *ctx, void *arg) {
+  struct _openslide_cached_tiff ct = {
+    .tc = ctx,
+    .tiff = arg,
+  };
+  _openslide_cached_tiff_put(&ct);
+}
+
+void _openslide_tiffcache_set_grid_worker_arg(struct _openslide_tiffcache *tc,
+                                              struct _openslide_grid *grid) {
+  _openslide_grid_set_worker_arg(grid, grid_get_tiff, grid_put_tiff, tc);
+}
+
+static void staged_tile_free(struct staged_tile *st) {
+  g_free(st->buf);
+  g_free(st);
+}
+
+// called as each read completes
+static void stage_tile(struct _openslide_read_req *req, size_t count,
+                       void *data) {
+  struct fetch_batch *batch = data;
+  struct _openslide_tiff_fetch *tf = batch->tf;
+  if (count != req->size) {
+    // leave it to the tile read, which will report the error
+    return;
+  }
+  guint i = req - (struct _openslide_read_req *) batch->reqs->data;
+  ttile_t tile_no = g_array_index(batch->tile_nos, ttile_t, i);
+  // a NULL buf tells grid_release_tiles() that we staged the tile
+  g_autofree void *buf = g_steal_pointer(&req->buf);
+  g_mutex_lock(&tf->lock);
+  struct staged_tile *st = g_hash_table_lookup(tf->staged, &tile_no);
+  if (!st) {
+    st = g_new0(struct staged_tile, 1);
+    st->tile_no = tile_no;
+    g_hash_table_insert(tf->staged, &st->tile_no, st);
+  }
+  st->batches++;
+  if (!st->buf) {
+    st->buf = g_steal_pointer(&buf);
+    st->len = count;
+  }
+  g_mutex_unlock(&tf->lock);
+}
+
+static void *grid_fetch_tiles(void *ctx, void *arg,
+                              const int64_t *cols, const int64_t *rows,
+                              uint32_t count) {
+  struct _openslide_tiff_fetch *tf = ctx;
+  struct _openslide_tiff_level *tiffl = tf->tiffl;
+  TIFF *tiff = arg;
+
+  // any failure here will be reported by the tile reads
+  toff_t *offsets = NULL;
+  toff_t *sizes = NULL;
+  ttile_t tile_count = 0;
+  if (!tiffl->tiles) {
+    if (!_openslide_tiff_set_dir(tiff, tiffl->dir, NULL)) {
+      return NULL;
+    }
+    if (!TIFFGetField(tiff, TIFFTAG_TILEOFFSETS, &offsets) ||
+        !TIFFGetField(tiff, TIFFTAG_TILEBYTECOUNTS, &sizes)) {
+      return NULL;
+    }
+    tile_count = TIFFNumberOfTiles(tiff);
+  }
+  g_auto(_openslide_pinned_file) pf =
+    _openslide_shared_file_get(tf->tc->file, NULL);
+  struct _openslide_file *f = pf.file;
+  if (!f) {
+    return NULL;
+  }
+
+  // tiles in a mapped file are decoded in place, so only page them in
+  bool mapped = _openslide_file_is_mapped(f);
+  struct fetch_batch *batch = NULL;
+  if (!mapped) {
+    batch = g_new0(struct fetch_batch, 1);
+    batch->tf = tf;
+    batch->reqs = g_array_new(false, false,
+                              sizeof(struct _openslide_read_req));
+    batch->tile_nos = g_array_new(false, false, sizeof(ttile_t));
+  }
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    ttile_t tile_no;
+    uint64_t tile_offset;
+    uint64_t tile_size;
+    if (tiffl->tiles) {
+      tile_no = rows[i] * tiffl->tiles_across + cols[i];
+      if (!_openslide_tifflike_array_get(tiffl->tiles->offsets, f, tile_no,
+                                         &tile_offset, NULL) ||
+          !_openslide_tifflike_array_get(tiffl->tiles->sizes, f, tile_no,
+                                         &tile_size, NULL)) {
+        continue;
+      }
+    } else {
+      tile_no = get_tile_no(tiffl, tiff, cols[i], rows[i]);
+      if (tile_no >= tile_count) {
+        continue;
+      }
+      tile_offset = offsets[tile_no];
+      tile_size = sizes[tile_no];
+    }
+    if (tile_size == 0 || tile_size > G_MAXINT32 ||
+        tile_offset > G_MAXINT64) {
+      // missing or bogus; leave it to the tile read
+      continue;
+    }
+    total += tile_size;
+    if (total > FETCH_MAX_BYTES) {
+      break;
+    }
+    if (mapped) {
+      _openslide_fmap_willneed(f, tile_offset, tile_size);
+      continue;
+    }
+    struct _openslide_read_req req = {
+      .offset = tile_offset,
+      .buf = g_malloc(tile_size),
+      .size = tile_size,
+    };
+    g_array_append_val(batch->reqs, req);
+    g_array_append_val(batch->tile_nos, tile_no);
+  }
+  if (!batch) {
+    return NULL;
+  }
+
+  _openslide_fread_batch(f, (struct _openslide_read_req *) batch->reqs->data,
+                         batch->reqs->len, stage_tile, batch);
+  return batch;
+}
+
+static void grid_release_tiles(void *ctx G_GNUC_UNUSED, void *data) {
+  struct fetch_batch *batch = data;
+  struct _openslide_tiff_fetch *tf = batch->tf;
+
+  g_mutex_lock(&tf->lock);
+  for (guint i = 0; i < batch->reqs->len; i++) {
+    struct _openslide_read_req *req =
+      &g_array_index(batch->reqs, struct _openslide_read_req, i);
+    if (req->buf) {
+      // failed read
+      g_free(req->buf);
+      continue;
+    }
+    // drop staged data once no paint can need it
+    ttile_t tile_no = g_array_index(batch->tile_nos, ttile_t, i);
+    struct staged_tile *st = g_hash_table_lookup(tf->staged, &tile_no);
+    g_assert(st && st->batches);
+    if (--st->batches == 0) {
+      g_hash_table_remove(tf->staged, &tile_no);
+    }
+  }
+  g_mutex_unlock(&tf->lock);
+
+  g_array_free(batch->reqs, true);
+  g_array_free(batch->tile_nos, true);
+  g_free(batch);
+}
+
+static void fetch_free(void *data) {
+  struct _openslide_tiff_fetch *tf = data;
+  g_hash_table_destroy(tf->staged);
+  g_mutex_clear(&tf->lock);
+  g_free(tf);
+}
+
+void _openslide_tiffcache_set_grid_fetch(struct _openslide_tiffcache *tc,
+                                         struct _openslide_tiff_level *tiffl,
+                                         struct _openslide_grid *grid) {
+  struct _openslide_tiff_fetch *tf = g_new0(struct _openslide_tiff_fetch, 1);
+  tf->tc = tc;
+  tf->tiffl = tiffl;
+  g_mutex_init(&tf->lock);
+  tf->staged = g_hash_table_new_full(g_int_hash, g_int_equal, NULL,
+                                     (GDestroyNotify) staged_tile_free);
+  tiffl->fetch = tf;
+  _openslide_grid_set_fetch(grid, grid_fetch_tiles, grid_release_tiles,
+                            tf, fetch_free);
+}
+
+void _openslide_tiffcache_set_level_tiles(struct _openslide_tiffcache *tc,
+                                          struct _openslide_tifflike *tl,
+                                          struct _openslide_tiff_level *tiffl) {
+  // one sample plane, so one tile per grid position
+  int64_t count = tiffl->tiles_across * tiffl->tiles_down;
+  if (_openslide_tifflike_get_value_count(tl, tiffl->dir,
+                                          TIFFTAG_TILEOFFSETS) != count ||
+      _openslide_tifflike_get_value_count(tl, tiffl->dir,
+                                          TIFFTAG_TILEBYTECOUNTS) != count) {
+    return;
+  }
+  g_autoptr(_openslide_tifflike_array) offsets =
+    _openslide_tifflike_get_uint_array(tl, tiffl->dir, TIFFTAG_TILEOFFSETS,
+                                       NULL);
+  g_autoptr(_openslide_tifflike_array) sizes =
+    _openslide_tifflike_get_uint_array(tl, tiffl->dir,
+                                       TIFFTAG_TILEBYTECOUNTS, NULL);
+  if (!offsets || !sizes) {
+    return;
+  }
+
+  // JPEG tables, if any
+  int64_t tables_len =
+    _openslide_tifflike_get_value_count(tl, tiffl->dir, TIFFTAG_JPEGTABLES);
+  const void *tables = NULL;
+  if (tables_len) {
+    tables = _openslide_tifflike_get_buffer(tl, tiffl->dir,
+                                            TIFFTAG_JPEGTABLES, NULL);
+    if (!tables || tables_len > G_MAXUINT32) {
+      return;
+    }
+  }
+
+  struct _openslide_tiff_tiles *tiles =
+    g_new0(struct _openslide_tiff_tiles, 1);
+  tiles->tc = tc;
+  tiles->offsets = g_steal_pointer(&offsets);
+  tiles->sizes = g_steal_pointer(&sizes);
+  if (tables) {
+    tiles->jpeg_tables = g_memdup(tables, tables_len);
+    tiles->jpeg_tables_len = tables_len;
+  }
+  g_ptr_array_add(tc->tiles, tiles);
+  tiffl->tiles = tiles;
+}
@@ -43,6 +43,14 @@ struct _openslide_tiff_level {
   bool tile_read_direct;
   gint warned_read_indirect;
   uint16_t photometric;
+  uint16_t compression;
+
+  // > 1 for a virtual level decoding another directory's tiles at reduced
+  // scale; image and tile sizes are then the scaled ones
+  int32_t scale_denom;
+
+  struct _openslide_tiff_fetch *fetch;  // owned by the level's grid
+  struct _openslide_tiff_tiles *tiles;  // owned by the tiffcache
 };
 
 struct _openslide_tiffcache;
@@ -58,6 +66,17 @@ bool _openslide_tiff_level_init(TIFF *tiff,
                                 struct _openslide_tiff_level *tiffl,
                                 GError **err);
 
+// initialize a virtual level that decodes the parent's JPEG tiles at
+// 1/scale_denom size, or if caller_decodes, whose tiles the caller decodes
+// at that size from _openslide_tiff_read_tile_data().  Returns false if
+// the parent can't be read that way.  The caller creates the level's grid.
+bool _openslide_tiff_level_init_scaled(const struct _openslide_level *parent,
+                                       const struct _openslide_tiff_level *parent_tiffl,
+                                       int32_t scale_denom,
+                                       bool caller_decodes,
+                                       struct _openslide_level *level,
+                                       struct _openslide_tiff_level *tiffl);
+
 bool _openslide_tiff_check_missing_tile(struct _openslide_tiff_level *tiffl,
                                         TIFF *tiff,
                                         int64_t tile_col, int64_t tile_row,
@@ -70,12 +89,41 @@ bool _openslide_tiff_read_tile(struct _openslide_tiff_level *tiffl,
                                int64_t tile_col, int64_t tile_row,
                                GError **err);
 
+// like _openslide_tiff_read_tile(), but JPEG tiles read directly may
+// only have the pixels covering crop decoded
+bool _openslide_tiff_read_tile_cropped(struct _openslide_tiff_level *tiffl,
+                                       TIFF *tiff,
+                                       uint32_t *dest,
+                                       int64_t tile_col, int64_t tile_row,
+                                       const struct _openslide_tile_crop *crop,
+                                       GError **err);
+
 bool _openslide_tiff_read_tile_data(struct _openslide_tiff_level *tiffl,
                                     TIFF *tiff,
                                     void **buf, int32_t *len,
                                     int64_t tile_col, int64_t tile_row,
                                     GError **err);
 
+// like _openslide_tiff_read_tile_data(), but tiles in a memory-mapped file
+// aren't copied.  *buf is valid until *owned is freed, or if *owned is
+// NULL, until the slide is closed.
+bool _openslide_tiff_read_tile_data_borrowed(struct _openslide_tiff_level *tiffl,
+                                             TIFF *tiff,
+                                             const void **buf, int32_t *len,
+                                             void **owned,
+                                             int64_t tile_col, int64_t tile_row,
+                                             GError **err);
+
+// returns a tile's stored JPEG data with the directory's JPEGTables merged
+// in, or NULL with err unset if the tile can't be decoded without TIFF
+// metadata
+void *_openslide_tiff_read_raw_tile(struct _openslide_tiff_level *tiffl,
+                                    TIFF *tiff,
+                                    int64_t tile_col, int64_t tile_row,
+                                    enum openslide_tile_codec *codec,
+                                    size_t *len,
+                                    GError **err);
+
 bool _openslide_tiff_clip_tile(struct _openslide_tiff_level *tiffl,
                                uint32_t *tiledata,
                                int64_t tile_col, int64_t tile_row,
@@ -102,8 +150,37 @@ struct _openslide_cached_tiff _openslide_tiffcache_get(struct _openslide_tiffcac
 
 void _openslide_cached_tiff_put(struct _openslide_cached_tiff *ct);
 
+// check out a handle for reading a level, or leave ct->tiff NULL if the
+// level is read without one.  ct must be zero-initialized.
+bool _openslide_tiffcache_get_for_level(struct _openslide_tiffcache *tc,
+                                        struct _openslide_tiff_level *tiffl,
+                                        struct _openslide_cached_tiff *ct,
+                                        GError **err);
+
 void _openslide_tiffcache_destroy(struct _openslide_tiffcache *tc);
 
+// let parallel decode workers for a grid painted with a TIFF * arg take
+// their own TIFF handles
+void _openslide_tiffcache_set_grid_worker_arg(struct _openslide_tiffcache *tc,
+                                              struct _openslide_grid *grid);
+
+// read the level's tile data directly from the file, at the tile offsets
+// parsed by tifflike, rather than through a TIFF handle.  If it succeeds
+// (sets tiffl->tiles), the level's tile data and raw tile functions accept
+// a NULL TIFF, as does _openslide_tiff_read_tile() if
+// tiffl->tile_read_direct; other calls check out a handle as needed.
+// Leaves the level unchanged if its offsets are unusable.
+void _openslide_tiffcache_set_level_tiles(struct _openslide_tiffcache *tc,
+                                          struct _openslide_tifflike *tl,
+                                          struct _openslide_tiff_level *tiffl);
+
+// for levels whose tiles are decoded from _openslide_tiff_read_tile_data(),
+// let a simple grid painted with a TIFF * arg read the data for all of a
+// region's tiles in one batch
+void _openslide_tiffcache_set_grid_fetch(struct _openslide_tiffcache *tc,
+                                         struct _openslide_tiff_level *tiffl,
+                                         struct _openslide_grid *grid);
+
 typedef struct _openslide_tiffcache _openslide_tiffcache;
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(_openslide_tiffcache,
                               _openslide_tiffcache_destroy)
@@ -34,6 +34,9 @@
 
 #define NDPI_TAG 65420
 
+// values per chunk of a lazily-read array
+#define ARRAY_CHUNK_VALUES 4096
+
 
 struct _openslide_tifflike {
   char *filename;
@@ -41,6 +44,7 @@ struct _openslide_tifflike {
   bool ndpi;
   GPtrArray *directories;
   GMutex value_lock;
+  struct _openslide_file *file;  // protected by value_lock
 };
 
 struct tiff_directory {
@@ -60,6 +64,15 @@ struct tiff_item {
   void *buffer;
 };
 
+struct _openslide_tifflike_array {
+  int64_t count;
+  uint64_t offset;  // of the values in the file
+  uint32_t value_size;
+  bool big_endian;
+  int64_t chunk_count;
+  uint64_t **chunks;  // atomic ops only; NULL until read
+};
+
 
 static void fix_byte_order(void *data, int32_t size, int64_t count,
                            bool big_endian) {
@@ -324,9 +337,12 @@ static bool populate_item(struct _openslide_tifflike *tl,
     return true;
   }
 
-  g_autoptr(_openslide_file) f = _openslide_fopen(tl->filename, err);
-  if (!f) {
-    return false;
+  // reuse one handle for all values
+  if (!tl->file) {
+    tl->file = _openslide_fopen(tl->filename, err);
+    if (!tl->file) {
+      return false;
+    }
   }
 
   uint64_t count = item->count;
@@ -342,11 +358,7 @@ static bool populate_item(struct _openslide_tifflike *tl,
   }
 
   //g_debug("reading tiff value: len: %"PRId64", offset %"PRIu64, len, item->offset);
-  if (!_openslide_fseek(f, item->offset, SEEK_SET, err)) {
-    g_prefix_error(err, "Couldn't seek to read TIFF value: ");
-    return false;
-  }
-  if (_openslide_fread(f, buf, len) != (size_t) len) {
+  if (_openslide_fread_at(tl->file, item->offset, buf, len) != (size_t) len) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                 "Couldn't read TIFF value");
     return false;
@@ -676,6 +688,9 @@ void _openslide_tifflike_destroy(struct _openslide_tifflike *tl) {
   }
   g_mutex_unlock(&tl->value_lock);
   g_ptr_array_free(tl->directories, true);
+  if (tl->file) {
+    _openslide_fclose(tl->file);
+  }
   g_free(tl->filename);
   g_mutex_clear(&tl->value_lock);
   g_free(tl);
@@ -930,6 +945,131 @@ const void *_openslide_tifflike_get_buffer(struct _openslide_tifflike *tl,
   return item->buffer;
 }
 
+struct _openslide_tifflike_array *_openslide_tifflike_get_uint_array(struct _openslide_tifflike *tl,
+                                                                     int64_t dir, int32_t tag,
+                                                                     GError **err) {
+  struct tiff_item *item = get_and_check_item(tl, dir, tag, err);
+  if (item == NULL) {
+    return NULL;
+  }
+  switch (item->type) {
+  case TIFF_BYTE:
+  case TIFF_SHORT:
+  case TIFF_LONG:
+  case TIFF_LONG8:
+  case TIFF_IFD:
+  case TIFF_IFD8:
+    break;
+  default:
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Unexpected value type: directory %"PRId64", "
+                "tag %d, type %d", dir, tag, item->type);
+    return NULL;
+  }
+
+  uint64_t count = item->count;
+  uint32_t value_size = get_value_size(item->type, &count);
+  int64_t chunk_count = (count + ARRAY_CHUNK_VALUES - 1) / ARRAY_CHUNK_VALUES;
+  uint64_t **chunks = g_try_new0(uint64_t *, chunk_count);
+  if (chunks == NULL) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Cannot allocate TIFF value array");
+    return NULL;
+  }
+
+  struct _openslide_tifflike_array *arr =
+    g_new0(struct _openslide_tifflike_array, 1);
+  arr->count = count;
+  arr->value_size = value_size;
+  arr->big_endian = tl->big_endian;
+  arr->chunk_count = chunk_count;
+  arr->chunks = chunks;
+
+  g_mutex_lock(&tl->value_lock);
+  if (item->offset == NO_OFFSET) {
+    // already loaded
+    for (int64_t i = 0; i < chunk_count; i++) {
+      int64_t first = i * ARRAY_CHUNK_VALUES;
+      int64_t n = MIN(ARRAY_CHUNK_VALUES, arr->count - first);
+      chunks[i] = g_memdup(item->uints + first, n * sizeof(uint64_t));
+    }
+  } else {
+    arr->offset = item->offset;
+  }
+  g_mutex_unlock(&tl->value_lock);
+  return arr;
+}
+
+static uint64_t *read_array_chunk(struct _openslide_tifflike_array *arr,
+                                  struct _openslide_file *f,
+                                  int64_t chunk,
+                                  GError **err) {
+  int64_t first = chunk * ARRAY_CHUNK_VALUES;
+  int64_t n = MIN(ARRAY_CHUNK_VALUES, arr->count - first);
+  size_t len = n * arr->value_size;
+  g_autofree void *buf = g_malloc(len);
+  if (_openslide_fread_at(f, arr->offset + first * arr->value_size,
+                          buf, len) != len) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Couldn't read TIFF value");
+    return NULL;
+  }
+  fix_byte_order(buf, arr->value_size, n, arr->big_endian);
+
+  uint64_t *values = g_new(uint64_t, n);
+  switch (arr->value_size) {
+  case 1:
+    CONVERT_VALUES_EXTEND(values, uint8_t, buf, n);
+    break;
+  case 2:
+    CONVERT_VALUES_EXTEND(values, uint16_t, buf, n);
+    break;
+  case 4:
+    CONVERT_VALUES_EXTEND(values, uint32_t, buf, n);
+    break;
+  case 8:
+    memcpy(values, buf, len);
+    break;
+  default:
+    g_assert_not_reached();
+  }
+  return values;
+}
+
+bool _openslide_tifflike_array_get(struct _openslide_tifflike_array *arr,
+                                   struct _openslide_file *f,
+                                   int64_t index, uint64_t *value,
+                                   GError **err) {
+  g_assert(index >= 0 && index < arr->count);
+  int64_t chunk = index / ARRAY_CHUNK_VALUES;
+  uint64_t *values = g_atomic_pointer_get(&arr->chunks[chunk]);
+  if (!values) {
+    values = read_array_chunk(arr, f, chunk, err);
+    if (!values) {
+      return false;
+    }
+    if (!g_atomic_pointer_compare_and_exchange(&arr->chunks[chunk],
+                                               NULL, values)) {
+      // another thread read it first
+      g_free(values);
+      values = g_atomic_pointer_get(&arr->chunks[chunk]);
+    }
+  }
+  *value = values[index % ARRAY_CHUNK_VALUES];
+  return true;
+}
+
+void _openslide_tifflike_array_destroy(struct _openslide_tifflike_array *arr) {
+  if (arr == NULL) {
+    return;
+  }
+  for (int64_t i = 0; i < arr->chunk_count; i++) {
+    g_free(arr->chunks[i]);
+  }
+  g_free(arr->chunks);
+  g_free(arr);
+}
+
 bool _openslide_tifflike_is_tiled(struct _openslide_tifflike *tl,
                                   int64_t dir) {
   return _openslide_tifflike_get_value_count(tl, dir, TIFFTAG_TILEWIDTH) &&
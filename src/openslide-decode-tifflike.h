@@ -99,6 +99,27 @@ const void *_openslide_tifflike_get_buffer(struct _openslide_tifflike *tl,
                                            int64_t dir, int32_t tag,
                                            GError **err);
 
+struct _openslide_tifflike_array;
+
+// TIFF_BYTE, TIFF_SHORT, TIFF_LONG, TIFF_LONG8, TIFF_IFD, TIFF_IFD8
+// for arrays too large to load at open, such as tile offsets.  Values are
+// read from the file in chunks on first access, through a handle the
+// caller supplies.  The array outlives the tifflike.
+struct _openslide_tifflike_array *_openslide_tifflike_get_uint_array(struct _openslide_tifflike *tl,
+                                                                     int64_t dir, int32_t tag,
+                                                                     GError **err);
+
+bool _openslide_tifflike_array_get(struct _openslide_tifflike_array *arr,
+                                   struct _openslide_file *f,
+                                   int64_t index, uint64_t *value,
+                                   GError **err);
+
+void _openslide_tifflike_array_destroy(struct _openslide_tifflike_array *arr);
+
+typedef struct _openslide_tifflike_array _openslide_tifflike_array;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(_openslide_tifflike_array,
+                              _openslide_tifflike_array_destroy)
+
 // return true if directory is tiled
 bool _openslide_tifflike_is_tiled(struct _openslide_tifflike *tl,
                                   int64_t dir);
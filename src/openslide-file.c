@@ -26,24 +26,96 @@
 #include "openslide-private.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
 #include <glib.h>
 
-#ifndef _WIN32
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+#ifdef HAVE_LIBURING
+#include <liburing.h>
 #endif
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define MMAP_ENV_VAR "OPENSLIDE_MMAP"
+// not worth a mapping
+#define MMAP_MIN_SIZE (1 << 20)
+// don't exhaust a 32-bit address space
+#define MMAP_MAX_SIZE_32BIT (256 << 20)
+#define COALESCE_GAP_ENV_VAR "OPENSLIDE_COALESCE_GAP"
+// default largest gap between two batched reads that are merged into one
+#define COALESCE_GAP_DEFAULT (16 << 10)
+// largest merged read
+#define COALESCE_MAX_SIZE (4 << 20)
+#define MAX_OPEN_FILES_ENV_VAR "OPENSLIDE_MAX_OPEN_FILES"
+// default share of RLIMIT_NOFILE for shared files, leaving the rest to
+// the application
+#define MAX_OPEN_FILES_FRACTION 2
+#define MAX_OPEN_FILES_MIN 16
+// for platforms without RLIMIT_NOFILE, or an unlimited one
+#define MAX_OPEN_FILES_DEFAULT 256
+
+struct vfs {
+  openslide_vfs_ops_t ops;
+  void *ctx;
+};
 
 struct _openslide_file {
-  FILE *fp;
+  FILE *fp;  // NULL for VFS and mapped files
+  const struct vfs *vfs;
+  void *handle;  // VFS file handle
+  int64_t pos;  // file position, if no fp
+  const uint8_t *map;  // whole file, or NULL
+  size_t map_size;
+  uint64_t overread;  // atomic ops only
+  int64_t next_offset;  // end of the last positional read; atomic ops only
+};
+
+struct _openslide_shared_file {
+  char *path;
+  GMutex open_lock;  // serializes opens of this file
+  // protected by pool_lock
+  struct _openslide_file *file;
+  int users;  // pins on file
+  bool idle;  // in idle_files
+  GList link;  // in idle_files
+  uint64_t overread;  // from files closed by the pool
 };
 
 struct _openslide_dir {
   GDir *dir;
 };
 
+static bool use_mmap;
+static int64_t coalesce_gap = COALESCE_GAP_DEFAULT;
+
+// process-wide pool of the files underlying shared files.  Unpinned files
+// are closed, least recently used first, when too many are open.
+static GMutex pool_lock;
+static GQueue idle_files;  // open, unpinned, unmapped; most recent first
+static uint64_t open_files;  // unmapped; protected by pool_lock
+static uint64_t peak_open_files;  // protected by pool_lock
+static uint64_t max_open_files;  // set at init
+static uint64_t file_opens;  // protected by pool_lock
+static uint64_t file_evictions;  // protected by pool_lock
+
+// I/O statistics of the handle on whose behalf this thread is working
+static GPrivate current_io_stats;
+
+// scheme -> struct vfs; entries are never removed
+static GHashTable *vfs_table;
+static GMutex vfs_lock;
+
 #undef fopen
 #undef fread
 #undef fclose
@@ -66,6 +138,103 @@ static void io_error(GError **err, const char *fmt, ...) {
   va_end(ap);
 }
 
+// called from shared-library constructor!
+void _openslide_file_init(void) {
+  // note: g_getenv() is not reentrant
+  const char *str = g_getenv(MMAP_ENV_VAR);
+  use_mmap = str && atoi(str) > 0;
+  // negative to disable merging
+  str = g_getenv(COALESCE_GAP_ENV_VAR);
+  if (str) {
+    coalesce_gap = g_ascii_strtoll(str, NULL, 10);
+  }
+  str = g_getenv(MAX_OPEN_FILES_ENV_VAR);
+  if (str && g_ascii_strtoll(str, NULL, 10) > 0) {
+    max_open_files = g_ascii_strtoll(str, NULL, 10);
+  } else {
+    max_open_files = MAX_OPEN_FILES_DEFAULT;
+#ifndef _WIN32
+    struct rlimit rl;
+    if (!getrlimit(RLIMIT_NOFILE, &rl) && rl.rlim_cur != RLIM_INFINITY) {
+      max_open_files = MAX(rl.rlim_cur / MAX_OPEN_FILES_FRACTION,
+                           MAX_OPEN_FILES_MIN);
+    }
+#endif
+  }
+}
+
+struct _openslide_io_scope _openslide_io_scope_enter(openslide_io_stats_t *stats) {
+  struct _openslide_io_scope scope = {
+    .prev = g_private_get(&current_io_stats),
+  };
+  g_private_set(&current_io_stats, stats);
+  return scope;
+}
+
+void _openslide_io_scope_exit(struct _openslide_io_scope *scope) {
+  g_private_set(&current_io_stats, scope->prev);
+}
+
+openslide_io_stats_t *_openslide_io_get_current(void) {
+  return g_private_get(&current_io_stats);
+}
+
+static void count_add(uint64_t *counter, uint64_t value) {
+  __atomic_add_fetch(counter, value, __ATOMIC_RELAXED);
+}
+
+static void count_open(void) {
+  openslide_io_stats_t *stats = g_private_get(&current_io_stats);
+  if (stats) {
+    count_add(&stats->opens, 1);
+  }
+}
+
+// a positional read not starting where the last one ended is a seek
+static void count_seek(openslide_io_stats_t *stats,
+                       struct _openslide_file *file,
+                       int64_t offset, int64_t end) {
+  int64_t prev = __atomic_exchange_n(&file->next_offset, end,
+                                     __ATOMIC_RELAXED);
+  if (offset != prev) {
+    count_add(&stats->seeks, 1);
+    count_add(&stats->seek_distance,
+              offset > prev ? offset - prev : prev - offset);
+  }
+}
+
+static void count_reads(openslide_io_stats_t *stats, uint64_t reads,
+                        uint64_t bytes, int64_t start_time) {
+  count_add(&stats->reads, reads);
+  count_add(&stats->bytes_read, bytes);
+  count_add(&stats->read_time_us, g_get_monotonic_time() - start_time);
+}
+
+void _openslide_io_stats_get(openslide_io_stats_t *stats,
+                             openslide_io_stats_t *out) {
+  out->opens = __atomic_load_n(&stats->opens, __ATOMIC_RELAXED);
+  out->reads = __atomic_load_n(&stats->reads, __ATOMIC_RELAXED);
+  out->bytes_read = __atomic_load_n(&stats->bytes_read, __ATOMIC_RELAXED);
+  out->seeks = __atomic_load_n(&stats->seeks, __ATOMIC_RELAXED);
+  out->seek_distance = __atomic_load_n(&stats->seek_distance,
+                                       __ATOMIC_RELAXED);
+  out->read_time_us = __atomic_load_n(&stats->read_time_us,
+                                      __ATOMIC_RELAXED);
+  out->overread_bytes = __atomic_load_n(&stats->overread_bytes,
+                                        __ATOMIC_RELAXED);
+}
+
+void _openslide_io_stats_add(openslide_io_stats_t *stats,
+                             const openslide_io_stats_t *other) {
+  count_add(&stats->opens, other->opens);
+  count_add(&stats->reads, other->reads);
+  count_add(&stats->bytes_read, other->bytes_read);
+  count_add(&stats->seeks, other->seeks);
+  count_add(&stats->seek_distance, other->seek_distance);
+  count_add(&stats->read_time_us, other->read_time_us);
+  count_add(&stats->overread_bytes, other->overread_bytes);
+}
+
 static FILE *do_fopen(const char *path, const char *mode, GError **err) {
   FILE *f;
 
@@ -96,8 +265,65 @@ static FILE *do_fopen(const char *path, const char *mode, GError **err) {
   return f;
 }
 
+bool _openslide_vfs_register(const char *scheme,
+                             const openslide_vfs_ops_t *ops,
+                             void *ctx) {
+  // RFC 3986 scheme syntax
+  if (!scheme || !g_ascii_isalpha(scheme[0]) ||
+      strspn(scheme, "abcdefghijklmnopqrstuvwxyz"
+                     "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789+-.") !=
+      strlen(scheme) ||
+      !ops || !ops->open || !ops->read || !ops->size || !ops->close) {
+    return false;
+  }
+
+  g_autoptr(GMutexLocker) locker G_GNUC_UNUSED =
+    g_mutex_locker_new(&vfs_lock);
+  if (!vfs_table) {
+    vfs_table = g_hash_table_new(g_str_hash, g_str_equal);
+  }
+  g_autofree char *key = g_ascii_strdown(scheme, -1);
+  if (g_hash_table_contains(vfs_table, key)) {
+    return false;
+  }
+  struct vfs *vfs = g_new0(struct vfs, 1);
+  vfs->ops = *ops;
+  vfs->ctx = ctx;
+  g_hash_table_insert(vfs_table, g_steal_pointer(&key), vfs);
+  return true;
+}
+
+static const struct vfs *get_vfs(const char *path) {
+  const char *sep = strstr(path, "://");
+  if (!sep) {
+    return NULL;
+  }
+  g_autofree char *scheme = g_ascii_strdown(path, sep - path);
+  g_autoptr(GMutexLocker) locker G_GNUC_UNUSED =
+    g_mutex_locker_new(&vfs_lock);
+  if (!vfs_table) {
+    return NULL;
+  }
+  return g_hash_table_lookup(vfs_table, scheme);
+}
+
 struct _openslide_file *_openslide_fopen(const char *path, GError **err)
 {
+  const struct vfs *vfs = get_vfs(path);
+  if (vfs) {
+    void *handle = vfs->ops.open(vfs->ctx, path);
+    if (!handle) {
+      g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                  "Couldn't open %s", path);
+      return NULL;
+    }
+    struct _openslide_file *file = g_new0(struct _openslide_file, 1);
+    file->vfs = vfs;
+    file->handle = handle;
+    count_open();
+    return file;
+  }
+
   g_autoptr(FILE) f = do_fopen(path, "rb" FOPEN_CLOEXEC_FLAG, err);
   if (f == NULL) {
     return NULL;
@@ -125,24 +351,371 @@ struct _openslide_file *_openslide_fopen(const char *path, GError **err)
 
   struct _openslide_file *file = g_new0(struct _openslide_file, 1);
   file->fp = g_steal_pointer(&f);
+  count_open();
+  return file;
+}
+
+struct _openslide_file *_openslide_fdopen(int fd, GError **err) {
+#ifdef _WIN32
+  int new_fd = _dup(fd);
+#else
+  int new_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+#endif
+  if (new_fd == -1) {
+    io_error(err, "Couldn't duplicate file descriptor %d", fd);
+    return NULL;
+  }
+#ifdef _WIN32
+  FILE *f = _fdopen(new_fd, "rb");
+#else
+  FILE *f = fdopen(new_fd, "rb");
+#endif
+  if (f == NULL) {
+    io_error(err, "Couldn't open file descriptor %d", fd);
+#ifdef _WIN32
+    _close(new_fd);
+#else
+    close(new_fd);
+#endif
+    return NULL;
+  }
+
+  struct _openslide_file *file = g_new0(struct _openslide_file, 1);
+  file->fp = f;
+  count_open();
   return file;
 }
 
 size_t _openslide_fread(struct _openslide_file *file, void *buf, size_t size) {
+  if (!file->fp) {
+    size_t count = _openslide_fread_at(file, file->pos, buf, size);
+    file->pos += count;
+    return count;
+  }
+  openslide_io_stats_t *stats = g_private_get(&current_io_stats);
+  int64_t start_time = stats ? g_get_monotonic_time() : 0;
   char *bufp = buf;
   size_t total = 0;
   while (total < size) {
     size_t count = fread(bufp + total, 1, size - total, file->fp);
     if (count == 0) {
+      break;
+    }
+    total += count;
+  }
+  if (stats) {
+    count_reads(stats, 1, total, start_time);
+  }
+  return total;
+}
+
+static size_t read_at(struct _openslide_file *file, off_t offset,
+                      void *buf, size_t size) {
+  char *bufp = buf;
+  size_t total = 0;
+  if (offset < 0) {
+    return 0;
+  }
+  if (file->map) {
+    if ((uint64_t) offset >= file->map_size) {
+      return 0;
+    }
+    size_t count = MIN(size, file->map_size - offset);
+    memcpy(buf, file->map + offset, count);
+    return count;
+  }
+  if (file->vfs) {
+    while (total < size) {
+      int64_t count = file->vfs->ops.read(file->handle, bufp + total,
+                                          size - total, offset + total);
+      if (count <= 0) {
+        return total;
+      }
+      total += count;
+    }
+    return total;
+  }
+#ifdef _WIN32
+  HANDLE h = (HANDLE) _get_osfhandle(_fileno(file->fp));
+  while (total < size) {
+    // overlapped offsets don't use the file position, although a
+    // synchronous read still updates it
+    uint64_t pos = offset + total;
+    OVERLAPPED ov = {
+      .Offset = (DWORD) pos,
+      .OffsetHigh = (DWORD) (pos >> 32),
+    };
+    DWORD count;
+    if (!ReadFile(h, bufp + total, MIN(size - total, G_MAXINT32),
+                  &count, &ov) || count == 0) {
       return total;
     }
     total += count;
   }
+#else
+  int fd = fileno(file->fp);
+  while (total < size) {
+    ssize_t count = pread(fd, bufp + total, size - total, offset + total);
+    if (count == -1 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      return total;
+    }
+    total += count;
+  }
+#endif
   return total;
 }
 
-bool _openslide_fseek(struct _openslide_file *file, off_t offset, int whence,
-                      GError **err) {
+size_t _openslide_fread_at(struct _openslide_file *file, off_t offset,
+                           void *buf, size_t size) {
+  openslide_io_stats_t *stats = g_private_get(&current_io_stats);
+  if (!stats) {
+    return read_at(file, offset, buf, size);
+  }
+  int64_t start_time = g_get_monotonic_time();
+  size_t count = read_at(file, offset, buf, size);
+  count_seek(stats, file, offset, offset + count);
+  count_reads(stats, 1, count, start_time);
+  return count;
+}
+
+// one read covering one or more nearby requests
+struct read_run {
+  off_t offset;
+  size_t size;
+  uint8_t *buf;  // the request's own buffer, if there's only one
+  struct _openslide_read_req **reqs;  // sorted by offset
+  uint32_t count;
+};
+
+static gint compare_req_offsets(gconstpointer a, gconstpointer b) {
+  const struct _openslide_read_req *ra =
+    *(const struct _openslide_read_req * const *) a;
+  const struct _openslide_read_req *rb =
+    *(const struct _openslide_read_req * const *) b;
+  return (ra->offset > rb->offset) - (ra->offset < rb->offset);
+}
+
+// got is the number of bytes already read into the run's buffer
+static void finish_run(struct _openslide_file *file, struct read_run *run,
+                       size_t got,
+                       _openslide_read_done_fn done, void *data) {
+  if (got < run->size) {
+    // short read, error, or not yet read; pread the rest, which also
+    // detects EOF
+    got += read_at(file, run->offset + got, run->buf + got,
+                   run->size - got);
+  }
+  if (run->count == 1) {
+    done(run->reqs[0], got, data);
+    return;
+  }
+  // split the buffer
+  for (uint32_t i = 0; i < run->count; i++) {
+    struct _openslide_read_req *req = run->reqs[i];
+    size_t start = req->offset - run->offset;
+    size_t count = got > start ? MIN(req->size, got - start) : 0;
+    memcpy(req->buf, run->buf + start, count);
+    done(req, count, data);
+  }
+  g_free(run->buf);
+}
+
+#ifdef HAVE_LIBURING
+#define URING_DEPTH 64
+
+static gint uring_unavailable;  // atomic ops only
+
+static void free_ring(void *data) {
+  struct io_uring *ring = data;
+  io_uring_queue_exit(ring);
+  g_free(ring);
+}
+static GPrivate uring_key = G_PRIVATE_INIT(free_ring);
+
+// one ring per thread, created on first use
+static struct io_uring *get_ring(void) {
+  struct io_uring *ring = g_private_get(&uring_key);
+  if (ring || g_atomic_int_get(&uring_unavailable)) {
+    return ring;
+  }
+  ring = g_new0(struct io_uring, 1);
+  if (io_uring_queue_init(URING_DEPTH, ring, 0)) {
+    // old kernel, or blocked by seccomp or sysctl; don't keep trying
+    g_atomic_int_set(&uring_unavailable, 1);
+    g_free(ring);
+    return NULL;
+  }
+  g_private_set(&uring_key, ring);
+  return ring;
+}
+
+// returns the number of runs completed; the caller preads the rest
+static uint32_t fread_runs_uring(struct _openslide_file *file,
+                                 struct read_run *runs, uint32_t count,
+                                 _openslide_read_done_fn done, void *data) {
+  struct io_uring *ring = get_ring();
+  if (!ring) {
+    return 0;
+  }
+  int fd = fileno(file->fp);
+  uint32_t prepared = 0;
+  uint32_t submitted = 0;
+  uint32_t completed = 0;
+  bool failed = false;
+  while (completed < submitted || (!failed && completed < count)) {
+    // keep the queue full
+    while (!failed && prepared < count &&
+           prepared - completed < URING_DEPTH) {
+      struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+      if (!sqe) {
+        break;
+      }
+      struct read_run *run = &runs[prepared++];
+      io_uring_prep_read(sqe, fd, run->buf, run->size, run->offset);
+      io_uring_sqe_set_data(sqe, run);
+    }
+    if (!failed && submitted < prepared) {
+      int ret = io_uring_submit(ring);
+      if (ret >= 0) {
+        submitted += ret;
+      } else if (ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+        // stop submitting, but reap what's in flight
+        failed = true;
+      }
+    }
+    if (completed == submitted) {
+      continue;
+    }
+
+    struct io_uring_cqe *cqe;
+    if (io_uring_wait_cqe(ring, &cqe)) {
+      // interrupted
+      continue;
+    }
+    struct read_run *run = io_uring_cqe_get_data(cqe);
+    int res = cqe->res;
+    io_uring_cqe_seen(ring, cqe);
+    completed++;
+    finish_run(file, run, MAX(res, 0), done, data);
+  }
+  if (failed) {
+    // discard the unsubmitted reads along with the ring
+    g_private_replace(&uring_key, NULL);
+  }
+  return completed;
+}
+#endif
+
+void _openslide_fread_batch(struct _openslide_file *file,
+                            struct _openslide_read_req *reqs, uint32_t count,
+                            _openslide_read_done_fn done, void *data) {
+  // sort by offset, so nearby requests can share a read
+  g_autofree struct _openslide_read_req **sorted =
+    g_new(struct _openslide_read_req *, count);
+  for (uint32_t i = 0; i < count; i++) {
+    sorted[i] = &reqs[i];
+  }
+  qsort(sorted, count, sizeof(*sorted), compare_req_offsets);
+
+  openslide_io_stats_t *stats = g_private_get(&current_io_stats);
+
+  // plan reads, merging requests separated by no more than the gap
+  // threshold.  a mapped file is read with memcpy, so don't bother.
+  int64_t gap_limit = file->map ? -1 : coalesce_gap;
+  g_autoptr(GArray) runs = g_array_new(false, false, sizeof(struct read_run));
+  for (uint32_t i = 0; i < count;) {
+    struct read_run run = {
+      .offset = sorted[i]->offset,
+      .reqs = &sorted[i],
+      .count = 1,
+    };
+    off_t end = sorted[i]->offset + sorted[i]->size;
+    uint64_t gaps = 0;
+    for (i++; i < count; i++) {
+      struct _openslide_read_req *req = sorted[i];
+      off_t req_end = MAX(end, (off_t) (req->offset + req->size));
+      if (req->offset - end > gap_limit ||
+          req_end - run.offset > COALESCE_MAX_SIZE) {
+        break;
+      }
+      gaps += MAX(req->offset - end, 0);
+      end = req_end;
+      run.count++;
+    }
+    run.size = end - run.offset;
+    if (run.count == 1) {
+      run.buf = run.reqs[0]->buf;
+    } else {
+      run.buf = g_malloc(run.size);
+      __atomic_add_fetch(&file->overread, gaps, __ATOMIC_RELAXED);
+      if (stats) {
+        count_add(&stats->overread_bytes, gaps);
+      }
+    }
+    g_array_append_val(runs, run);
+  }
+
+  // account for the batch up front, since runs complete out of order
+  int64_t start_time = stats ? g_get_monotonic_time() : 0;
+  uint64_t bytes = 0;
+  if (stats) {
+    for (guint j = 0; j < runs->len; j++) {
+      struct read_run *run = &g_array_index(runs, struct read_run, j);
+      count_seek(stats, file, run->offset, run->offset + run->size);
+      bytes += run->size;
+    }
+  }
+
+  uint32_t i = 0;
+#ifdef HAVE_LIBURING
+  if (file->fp) {
+    i = fread_runs_uring(file, (struct read_run *) runs->data, runs->len,
+                         done, data);
+  }
+#endif
+  for (; i < runs->len; i++) {
+    finish_run(file, &g_array_index(runs, struct read_run, i), 0,
+               done, data);
+  }
+  if (stats) {
+    count_reads(stats, runs->len, bytes, start_time);
+  }
+}
+
+uint64_t _openslide_fget_overread(struct _openslide_file *file) {
+  return __atomic_load_n(&file->overread, __ATOMIC_RELAXED);
+}
+
+static bool seek(struct _openslide_file *file, off_t offset, int whence,
+                 GError **err) {
+  if (!file->fp) {
+    int64_t base = 0;
+    switch (whence) {
+    case SEEK_SET:
+      break;
+    case SEEK_CUR:
+      base = file->pos;
+      break;
+    case SEEK_END:
+      base = _openslide_fsize(file, err);
+      if (base == -1) {
+        return false;
+      }
+      break;
+    default:
+      g_assert_not_reached();
+    }
+    if (base + offset < 0) {
+      g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                  "Invalid argument");
+      return false;
+    }
+    file->pos = base + offset;
+    return true;
+  }
   if (fseeko(file->fp, offset, whence)) {
     g_set_error(err, G_FILE_ERROR, g_file_error_from_errno(errno),
                 "%s", g_strerror(errno));
@@ -151,7 +724,27 @@ bool _openslide_fseek(struct _openslide_file *file, off_t offset, int whence,
   return true;
 }
 
+bool _openslide_fseek(struct _openslide_file *file, off_t offset, int whence,
+                      GError **err) {
+  openslide_io_stats_t *stats = g_private_get(&current_io_stats);
+  off_t prev = stats ? _openslide_ftell(file, NULL) : -1;
+  if (!seek(file, offset, whence, err)) {
+    return false;
+  }
+  if (stats && prev != -1) {
+    off_t pos = _openslide_ftell(file, NULL);
+    if (pos != -1 && pos != prev) {
+      count_add(&stats->seeks, 1);
+      count_add(&stats->seek_distance, pos > prev ? pos - prev : prev - pos);
+    }
+  }
+  return true;
+}
+
 off_t _openslide_ftell(struct _openslide_file *file, GError **err) {
+  if (!file->fp) {
+    return file->pos;
+  }
   off_t ret = ftello(file->fp);
   if (ret == -1) {
     g_set_error(err, G_FILE_ERROR, g_file_error_from_errno(errno),
@@ -160,30 +753,259 @@ off_t _openslide_ftell(struct _openslide_file *file, GError **err) {
   return ret;
 }
 
+// doesn't use the file position, so is safe on shared files
 off_t _openslide_fsize(struct _openslide_file *file, GError **err) {
-  off_t orig = _openslide_ftell(file, err);
-  if (orig == -1) {
-    return -1;
+  if (file->map) {
+    return file->map_size;
   }
-  if (!_openslide_fseek(file, 0, SEEK_END, err)) {
-    return -1;
+  if (file->vfs) {
+    int64_t size = file->vfs->ops.size(file->handle);
+    if (size < 0) {
+      g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_IO,
+                  "Couldn't get file size");
+    }
+    return size;
   }
-  off_t ret = _openslide_ftell(file, err);
-  if (ret == -1) {
+#ifdef _WIN32
+  struct _stati64 st;
+  if (_fstati64(_fileno(file->fp), &st)) {
+#else
+  struct stat st;
+  if (fstat(fileno(file->fp), &st)) {
+#endif
+    g_set_error(err, G_FILE_ERROR, g_file_error_from_errno(errno),
+                "%s", g_strerror(errno));
     return -1;
   }
-  if (!_openslide_fseek(file, orig, SEEK_SET, err)) {
-    return -1;
+  return st.st_size;
+}
+
+const void *_openslide_fmap(struct _openslide_file *file, off_t offset,
+                            size_t size) {
+  if (!file->map || offset < 0 || (uint64_t) offset > file->map_size ||
+      size > file->map_size - offset) {
+    return NULL;
   }
-  return ret;
+  return file->map + offset;
+}
+
+bool _openslide_file_is_mapped(struct _openslide_file *file) {
+  return file->map != NULL;
+}
+
+// Windows has no equivalent for views of a file
+void _openslide_fmap_willneed(struct _openslide_file *file G_GNUC_UNUSED,
+                              off_t offset G_GNUC_UNUSED,
+                              size_t size G_GNUC_UNUSED) {
+#ifndef _WIN32
+  const uint8_t *p = _openslide_fmap(file, offset, size);
+  if (!p || !size) {
+    return;
+  }
+  // the mapping is page-aligned, so rounding down stays inside it
+  uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t) p & ~(page_size - 1);
+  posix_madvise((void *) start, (uintptr_t) p + size - start,
+                POSIX_MADV_WILLNEED);
+#endif
+}
+
+// best effort; if this fails, reads go through the file descriptor
+static void map_file(struct _openslide_file *file) {
+  if (file->vfs) {
+    return;
+  }
+  off_t size = _openslide_fsize(file, NULL);
+  if (size < MMAP_MIN_SIZE || (uint64_t) size > G_MAXSIZE) {
+    return;
+  }
+  if (GLIB_SIZEOF_VOID_P < 8 && size > MMAP_MAX_SIZE_32BIT) {
+    return;
+  }
+
+#ifdef _WIN32
+  HANDLE h = (HANDLE) _get_osfhandle(_fileno(file->fp));
+  HANDLE mapping = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL) {
+    return;
+  }
+  void *map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+  // the view keeps the mapping alive
+  CloseHandle(mapping);
+  if (map == NULL) {
+    return;
+  }
+#else
+  void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(file->fp), 0);
+  if (map == MAP_FAILED) {
+    return;
+  }
+  // tile reads are scattered, so readahead would mostly be wasted
+  posix_madvise(map, size, POSIX_MADV_RANDOM);
+#endif
+
+  file->map = map;
+  file->map_size = size;
+  // the mapping outlives the descriptor, so don't hold one.  we just
+  // opened the file, so the position is still 0.
+  fclose(g_steal_pointer(&file->fp));
 }
 
 void _openslide_fclose(struct _openslide_file *file) {
-  fclose(file->fp);
+  if (file->map) {
+#ifdef _WIN32
+    UnmapViewOfFile(file->map);
+#else
+    munmap((void *) file->map, file->map_size);
+#endif
+  }
+  if (file->vfs) {
+    file->vfs->ops.close(file->handle);
+  } else if (file->fp) {
+    fclose(file->fp);
+  }
   g_free(file);
 }
 
+struct _openslide_shared_file *_openslide_shared_file_create(const char *path) {
+  struct _openslide_shared_file *sf = g_new0(struct _openslide_shared_file, 1);
+  sf->path = g_strdup(path);
+  sf->link.data = sf;
+  g_mutex_init(&sf->open_lock);
+  return sf;
+}
+
+// call with pool_lock held.  Returns files to close after dropping the
+// lock.
+static GSList *evict_files(void) {
+  GSList *evicted = NULL;
+  while (open_files > max_open_files && idle_files.tail) {
+    struct _openslide_shared_file *sf = idle_files.tail->data;
+    g_queue_unlink(&idle_files, &sf->link);
+    sf->idle = false;
+    sf->overread += _openslide_fget_overread(sf->file);
+    evicted = g_slist_prepend(evicted, g_steal_pointer(&sf->file));
+    open_files--;
+    file_evictions++;
+  }
+  return evicted;
+}
+
+static void close_files(GSList *files) {
+  g_slist_free_full(files, (GDestroyNotify) _openslide_fclose);
+}
+
+struct _openslide_pinned_file _openslide_shared_file_get(struct _openslide_shared_file *sf,
+                                                         GError **err) {
+  struct _openslide_pinned_file pf = {
+    .sf = sf,
+  };
+
+  g_mutex_lock(&pool_lock);
+  // pinning first keeps the file from being evicted once it's open
+  sf->users++;
+  if (sf->idle) {
+    g_queue_unlink(&idle_files, &sf->link);
+    sf->idle = false;
+  }
+  pf.file = sf->file;
+  g_mutex_unlock(&pool_lock);
+  if (pf.file) {
+    return pf;
+  }
+
+  g_mutex_lock(&sf->open_lock);
+  g_mutex_lock(&pool_lock);
+  pf.file = sf->file;
+  g_mutex_unlock(&pool_lock);
+  if (!pf.file) {
+    pf.file = _openslide_fopen(sf->path, err);
+    if (pf.file && use_mmap) {
+      map_file(pf.file);
+    }
+  }
+  GSList *evicted = NULL;
+  g_mutex_lock(&pool_lock);
+  if (!pf.file) {
+    // on failure, try again next time
+    sf->users--;
+  } else if (!sf->file) {
+    sf->file = pf.file;
+    file_opens++;
+    // a mapped file holds no descriptor
+    if (!_openslide_file_is_mapped(pf.file)) {
+      open_files++;
+      peak_open_files = MAX(peak_open_files, open_files);
+      evicted = evict_files();
+    }
+  }
+  g_mutex_unlock(&pool_lock);
+  g_mutex_unlock(&sf->open_lock);
+  close_files(evicted);
+  return pf;
+}
+
+void _openslide_pinned_file_put(struct _openslide_pinned_file *pf) {
+  if (pf == NULL || pf->file == NULL) {
+    return;
+  }
+  struct _openslide_shared_file *sf = pf->sf;
+
+  g_mutex_lock(&pool_lock);
+  g_assert(sf->users > 0);
+  // mapped files hold no descriptor, and can't be unmapped since libtiff
+  // may hold pointers into the mapping
+  if (--sf->users == 0 && !_openslide_file_is_mapped(sf->file)) {
+    g_queue_push_head_link(&idle_files, &sf->link);
+    sf->idle = true;
+  }
+  // we may have gone over the limit while every file was pinned
+  GSList *evicted = evict_files();
+  g_mutex_unlock(&pool_lock);
+  close_files(evicted);
+  pf->file = NULL;
+}
+
+void _openslide_shared_file_destroy(struct _openslide_shared_file *sf) {
+  g_mutex_lock(&pool_lock);
+  g_assert(sf->users == 0);
+  if (sf->idle) {
+    g_queue_unlink(&idle_files, &sf->link);
+  }
+  struct _openslide_file *file = g_steal_pointer(&sf->file);
+  if (file && !_openslide_file_is_mapped(file)) {
+    open_files--;
+  }
+  g_mutex_unlock(&pool_lock);
+
+  if (file) {
+    sf->overread += _openslide_fget_overread(file);
+    _openslide_fclose(file);
+  }
+  if (sf->overread && _openslide_debug(OPENSLIDE_DEBUG_PERFORMANCE)) {
+    g_message("Read %"PRIu64" unneeded bytes from %s while merging reads",
+              sf->overread, sf->path);
+  }
+  g_mutex_clear(&sf->open_lock);
+  g_free(sf->path);
+  g_free(sf);
+}
+
+void _openslide_file_get_stats(openslide_file_stats_t *stats) {
+  g_mutex_lock(&pool_lock);
+  stats->open = open_files;
+  stats->peak_open = peak_open_files;
+  stats->limit = max_open_files;
+  stats->opens = file_opens;
+  stats->evictions = file_evictions;
+  g_mutex_unlock(&pool_lock);
+}
+
 bool _openslide_fexists(const char *path, GError **err G_GNUC_UNUSED) {
+  if (get_vfs(path)) {
+    g_autoptr(_openslide_file) f = _openslide_fopen(path, NULL);
+    return f != NULL;
+  }
   return g_file_test(path, G_FILE_TEST_EXISTS);
 }
 
@@ -20,6 +20,7 @@
  */
 
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <glib.h>
@@ -27,6 +28,7 @@
 #include "openslide-private.h"
 
 #define RANGE_BIN_SIZE_MULTIPLIER 3
+#define DECODE_THREADS_ENV_VAR "OPENSLIDE_DECODE_THREADS"
 #define COLOR_TILE 0.6, 0,   0,   0.3
 #define COLOR_BIN  0,   0,   0.6, 0.15
 
@@ -52,6 +54,15 @@ struct bounds {
   double h;
 };
 
+// a tile that paint_region would read
+struct tile_ref {
+  int64_t col;
+  int64_t row;
+  void *tile;  // grid-specific tile struct, if any
+  double w;
+  double h;
+};
+
 struct grid_ops {
   void (*get_bounds)(struct _openslide_grid *grid,
                      struct bounds *bounds);
@@ -61,6 +72,17 @@ struct grid_ops {
                        struct _openslide_level *level,
                        int32_t w, int32_t h,
                        GError **err);
+  // append the tiles intersecting the region to a GArray of tile_ref
+  void (*list_tiles)(struct _openslide_grid *grid,
+                     double x, double y,
+                     int32_t w, int32_t h,
+                     GArray *tiles);
+  bool (*read_tile)(struct _openslide_grid *grid,
+                    cairo_t *cr,
+                    struct _openslide_level *level,
+                    const struct tile_ref *ref,
+                    void *arg,
+                    GError **err);
   void (*destroy)(struct _openslide_grid *grid);
 };
 
@@ -78,6 +100,42 @@ struct _openslide_grid {
 
   double tile_advance_x;
   double tile_advance_y;
+
+  // obtaining a read_tile arg for a decode worker
+  _openslide_grid_get_arg_fn get_arg;
+  _openslide_grid_put_arg_fn put_arg;
+  void *arg_ctx;
+
+  // no two tiles cover the same area
+  bool disjoint;
+
+  // batched reads of stored tile data
+  _openslide_grid_fetch_fn fetch;
+  _openslide_grid_release_fn release;
+  void *fetch_ctx;
+  GDestroyNotify fetch_ctx_free;
+};
+
+// tiles being decoded by _openslide_parallel_for()
+struct predecode {
+  struct _openslide_grid *grid;
+  struct _openslide_level *level;
+  GArray *tiles;  // tile_ref
+  GThread *caller;
+  void *arg;  // caller's
+};
+
+static int32_t default_decode_threads = 1;
+
+// cairo_t user data: set when the target is known to be transparent
+static const cairo_user_data_key_t blank_target_key;
+// cairo_t user data: set while a disjoint grid paints onto a blank target.
+// tiles no larger than the bounds can be copied straight into the target.
+static const cairo_user_data_key_t direct_blit_key;
+
+struct direct_blit_bounds {
+  double w;
+  double h;
 };
 
 struct simple_grid {
@@ -271,6 +329,17 @@ static bool read_tiles(cairo_t *cr,
   return true;
 }
 
+// the size of the tile about to be painted, beyond which it might cover
+// another tile
+static void set_direct_blit_bounds(cairo_t *cr, double w, double h) {
+  struct direct_blit_bounds *bounds =
+    cairo_get_user_data(cr, &direct_blit_key);
+  if (bounds) {
+    bounds->w = w;
+    bounds->h = h;
+  }
+}
+
 static void label_tile(cairo_t *cr,
                        double r, double g, double b, double a,
                        double w, double h,
@@ -364,6 +433,41 @@ static bool simple_paint_region(struct _openslide_grid *_grid,
   return read_tiles(cr, level, _grid, &region, simple_read_tile, arg, err);
 }
 
+static void simple_list_tiles(struct _openslide_grid *_grid,
+                              double x, double y,
+                              int32_t w, int32_t h,
+                              GArray *tiles) {
+  struct simple_grid *grid = (struct simple_grid *) _grid;
+  struct region region;
+
+  compute_region(_grid, x, y, w, h, &region);
+  for (int64_t row = MAX(region.start_tile_y, 0);
+       row < MIN(region.end_tile_y, grid->tiles_down); row++) {
+    for (int64_t col = MAX(region.start_tile_x, 0);
+         col < MIN(region.end_tile_x, grid->tiles_across); col++) {
+      struct tile_ref ref = {
+        .col = col,
+        .row = row,
+        .w = grid->base.tile_advance_x,
+        .h = grid->base.tile_advance_y,
+      };
+      g_array_append_val(tiles, ref);
+    }
+  }
+}
+
+static bool simple_read_tile_ref(struct _openslide_grid *_grid,
+                                 cairo_t *cr,
+                                 struct _openslide_level *level,
+                                 const struct tile_ref *ref,
+                                 void *arg,
+                                 GError **err) {
+  struct simple_grid *grid = (struct simple_grid *) _grid;
+
+  return grid->read_tile(grid->base.osr, cr, level,
+                         ref->col, ref->row, arg, err);
+}
+
 static void simple_destroy(struct _openslide_grid *_grid) {
   struct simple_grid *grid = (struct simple_grid *) _grid;
 
@@ -373,6 +477,8 @@ static void simple_destroy(struct _openslide_grid *_grid) {
 static const struct grid_ops simple_grid_ops = {
   .get_bounds = simple_get_bounds,
   .paint_region = simple_paint_region,
+  .list_tiles = simple_list_tiles,
+  .read_tile = simple_read_tile_ref,
   .destroy = simple_destroy,
 };
 
@@ -387,6 +493,7 @@ struct _openslide_grid *_openslide_grid_create_simple(openslide_t *osr,
   grid->base.ops = &simple_grid_ops;
   grid->base.tile_advance_x = tile_w;
   grid->base.tile_advance_y = tile_h;
+  grid->base.disjoint = true;
   grid->tiles_across = tiles_across;
   grid->tiles_down = tiles_down;
   grid->read_tile = read_tile;
@@ -429,6 +536,22 @@ static void tilemap_get_bounds(struct _openslide_grid *_grid,
   }
 }
 
+static bool tilemap_tile_in_region(struct tilemap_grid *grid,
+                                   struct tilemap_tile *tile,
+                                   struct region *region) {
+  double x = tile->col * grid->base.tile_advance_x + tile->offset_x;
+  double y = tile->row * grid->base.tile_advance_y + tile->offset_y;
+
+  if (x + tile->w <= region->x ||
+      y + tile->h <= region->y ||
+      x >= region->x + region->w ||
+      y >= region->y + region->h) {
+    //g_debug("skip x %g w %g y %g h %g, region x %g w %d y %g h %d", x, tile->w, y, tile->h, region->x, region->w, region->y, region->h);
+    return false;
+  }
+  return true;
+}
+
 static bool tilemap_read_tile(struct _openslide_grid *_grid,
                               struct region *region,
                               cairo_t *cr,
@@ -448,16 +571,9 @@ static bool tilemap_read_tile(struct _openslide_grid *_grid,
     return true;
   }
 
-  double x = tile_col * grid->base.tile_advance_x + tile->offset_x;
-  double y = tile_row * grid->base.tile_advance_y + tile->offset_y;
-
   // skip the tile if it's outside the requested region
   // (i.e., extra_tiles_* gave us an irrelevant tile)
-  if (x + tile->w <= region->x ||
-      y + tile->h <= region->y ||
-      x >= region->x + region->w ||
-      y >= region->y + region->h) {
-    //g_debug("skip x %g w %g y %g h %g, region x %g w %d y %g h %d", x, tile->w, y, tile->h, region->x, region->w, region->y, region->h);
+  if (!tilemap_tile_in_region(grid, tile, region)) {
     return true;
   }
 
@@ -465,6 +581,7 @@ static bool tilemap_read_tile(struct _openslide_grid *_grid,
 
   g_auto(cairo_matrix) matrix G_GNUC_UNUSED = matrix_save(cr);
   cairo_translate(cr, tile->offset_x, tile->offset_y);
+  set_direct_blit_bounds(cr, tile->w, tile->h);
   if (!grid->read_tile(grid->base.osr, cr, level,
                        tile->col, tile->row, tile->data,
                        arg, err)) {
@@ -510,6 +627,52 @@ static bool tilemap_paint_region(struct _openslide_grid *_grid,
   return read_tiles(cr, level, _grid, &region, tilemap_read_tile, arg, err);
 }
 
+static void tilemap_list_tiles(struct _openslide_grid *_grid,
+                               double x, double y,
+                               int32_t w, int32_t h,
+                               GArray *tiles) {
+  struct tilemap_grid *grid = (struct tilemap_grid *) _grid;
+  struct region region;
+
+  compute_region(_grid, x, y, w, h, &region);
+  for (int64_t row = region.start_tile_y - grid->extra_tiles_top;
+       row < region.end_tile_y + grid->extra_tiles_bottom; row++) {
+    for (int64_t col = region.start_tile_x - grid->extra_tiles_left;
+         col < region.end_tile_x + grid->extra_tiles_right; col++) {
+      struct tilemap_tile coords = {
+        .col = col,
+        .row = row,
+      };
+      struct tilemap_tile *tile = g_hash_table_lookup(grid->tiles, &coords);
+      if (tile == NULL || !tilemap_tile_in_region(grid, tile, &region)) {
+        continue;
+      }
+      struct tile_ref ref = {
+        .col = col,
+        .row = row,
+        .tile = tile,
+        .w = tile->w,
+        .h = tile->h,
+      };
+      g_array_append_val(tiles, ref);
+    }
+  }
+}
+
+static bool tilemap_read_tile_ref(struct _openslide_grid *_grid,
+                                  cairo_t *cr,
+                                  struct _openslide_level *level,
+                                  const struct tile_ref *ref,
+                                  void *arg,
+                                  GError **err) {
+  struct tilemap_grid *grid = (struct tilemap_grid *) _grid;
+  struct tilemap_tile *tile = ref->tile;
+
+  return grid->read_tile(grid->base.osr, cr, level,
+                         tile->col, tile->row, tile->data,
+                         arg, err);
+}
+
 static void tilemap_destroy(struct _openslide_grid *_grid) {
   struct tilemap_grid *grid = (struct tilemap_grid *) _grid;
 
@@ -520,6 +683,8 @@ static void tilemap_destroy(struct _openslide_grid *_grid) {
 static const struct grid_ops tilemap_grid_ops = {
   .get_bounds = tilemap_get_bounds,
   .paint_region = tilemap_paint_region,
+  .list_tiles = tilemap_list_tiles,
+  .read_tile = tilemap_read_tile_ref,
   .destroy = tilemap_destroy,
 };
 
@@ -543,6 +708,13 @@ void _openslide_grid_tilemap_add_tile(struct _openslide_grid *_grid,
 
   g_hash_table_replace(grid->tiles, tile, tile);
 
+  // tiles within their own cells can't overlap
+  if (offset_x < 0 || offset_y < 0 ||
+      offset_x + w > grid->base.tile_advance_x ||
+      offset_y + h > grid->base.tile_advance_y) {
+    grid->base.disjoint = false;
+  }
+
   grid->left = MIN(col * grid->base.tile_advance_x + offset_x,
                    grid->left);
   grid->top = MIN(row * grid->base.tile_advance_y + offset_y,
@@ -588,6 +760,7 @@ struct _openslide_grid *_openslide_grid_create_tilemap(openslide_t *osr,
   grid->base.ops = &tilemap_grid_ops;
   grid->base.tile_advance_x = tile_advance_x;
   grid->base.tile_advance_y = tile_advance_y;
+  grid->base.disjoint = true;
   grid->read_tile = read_tile;
   grid->destroy_tile = destroy_tile;
 
@@ -727,6 +900,7 @@ static bool range_paint_region(struct _openslide_grid *_grid,
     // draw
     //g_debug("tile x %g y %g", tile->x, tile->y);
     cairo_translate(cr, tile->x - x, tile->y - y);
+    set_direct_blit_bounds(cr, tile->w, tile->h);
     if (!grid->read_tile(grid->base.osr, cr, level,
                          tile->id, tile->data,
                          arg, err)) {
@@ -743,6 +917,59 @@ static bool range_paint_region(struct _openslide_grid *_grid,
   return true;
 }
 
+static void range_list_tiles(struct _openslide_grid *_grid,
+                             double x, double y,
+                             int32_t w, int32_t h,
+                             GArray *tiles) {
+  struct range_grid *grid = (struct range_grid *) _grid;
+  g_assert(grid->bins_runtime);
+
+  // tiles can appear in several bins
+  g_autoptr(GHashTable) seen = g_hash_table_new(NULL, NULL);
+  struct range_bin_address addr;
+  for (addr.row = y / grid->bin_height;
+       addr.row < (int64_t) (y + h + grid->bin_height - 1) / grid->bin_height;
+       addr.row++) {
+    for (addr.col = x / grid->bin_width;
+         addr.col < (int64_t) (x + w + grid->bin_width - 1) / grid->bin_width;
+         addr.col++) {
+      struct range_tile **cur = g_hash_table_lookup(grid->bins_runtime,
+                                                    &addr);
+      for (; cur && *cur; cur++) {
+        struct range_tile *tile = *cur;
+        if (tile->x + tile->w <= x ||
+            tile->y + tile->h <= y ||
+            tile->x >= x + w ||
+            tile->y >= y + h ||
+            !g_hash_table_add(seen, tile)) {
+          continue;
+        }
+        struct tile_ref ref = {
+          .col = tile->id,
+          .tile = tile,
+          .w = tile->w,
+          .h = tile->h,
+        };
+        g_array_append_val(tiles, ref);
+      }
+    }
+  }
+}
+
+static bool range_read_tile_ref(struct _openslide_grid *_grid,
+                                cairo_t *cr,
+                                struct _openslide_level *level,
+                                const struct tile_ref *ref,
+                                void *arg,
+                                GError **err) {
+  struct range_grid *grid = (struct range_grid *) _grid;
+  struct range_tile *tile = ref->tile;
+
+  return grid->read_tile(grid->base.osr, cr, level,
+                         tile->id, tile->data,
+                         arg, err);
+}
+
 static void range_destroy(struct _openslide_grid *_grid) {
   struct range_grid *grid = (struct range_grid *) _grid;
 
@@ -766,6 +993,8 @@ static void range_destroy(struct _openslide_grid *_grid) {
 static const struct grid_ops range_grid_ops = {
   .get_bounds = range_get_bounds,
   .paint_region = range_paint_region,
+  .list_tiles = range_list_tiles,
+  .read_tile = range_read_tile_ref,
   .destroy = range_destroy,
 };
 
@@ -811,10 +1040,26 @@ void _openslide_grid_range_add_tile(struct _openslide_grid *_grid,
   grid->bottom = MAX(y + h, grid->bottom);
 }
 
+static bool range_tiles_overlap(const struct range_tile *a,
+                                const struct range_tile *b) {
+  return a->x < b->x + b->w && b->x < a->x + a->w &&
+         a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
 static void range_postprocess_bin(void *key, void *value, void *data) {
   struct range_grid *grid = data;
   GPtrArray *tiles = value;
 
+  // overlapping tiles share at least one bin
+  for (guint i = 0; i < tiles->len && grid->base.disjoint; i++) {
+    for (guint j = i + 1; j < tiles->len; j++) {
+      if (range_tiles_overlap(tiles->pdata[i], tiles->pdata[j])) {
+        grid->base.disjoint = false;
+        break;
+      }
+    }
+  }
+
   struct range_tile **tile_array = g_new(struct range_tile *, tiles->len + 1);
   memcpy(tile_array, tiles->pdata, tiles->len * sizeof(struct range_tile *));
   tile_array[tiles->len] = NULL;
@@ -832,6 +1077,7 @@ void _openslide_grid_range_finish_adding_tiles(struct _openslide_grid *_grid) {
                                              range_bin_address_hash_key_equal,
                                              range_bin_address_free,
                                              g_free);
+  grid->base.disjoint = true;
   g_hash_table_foreach(grid->bins_init, range_postprocess_bin, grid);
   g_hash_table_steal_all(grid->bins_init);
   g_hash_table_destroy(grid->bins_init);
@@ -868,6 +1114,163 @@ struct _openslide_grid *_openslide_grid_create_range(openslide_t *osr,
 
 
 
+static void predecode_tile(uint32_t index, void *data) {
+  struct predecode *pd = data;
+  struct _openslide_grid *grid = pd->grid;
+  const struct tile_ref *ref =
+    &g_array_index(pd->tiles, struct tile_ref, index);
+
+  // nothing is drawn; we only want the side effect of caching the tile
+  g_autoptr(cairo_surface_t) surface =
+    cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 0, 0);
+  g_autoptr(cairo_t) cr = cairo_create(surface);
+  cairo_set_operator(cr, CAIRO_OPERATOR_SATURATE);
+
+  // errors will be reported when the tile is read again for compositing
+  GError *tmp_err = NULL;
+  if (pd->arg && g_thread_self() != pd->caller) {
+    void *arg = grid->get_arg(grid->arg_ctx, &tmp_err);
+    if (arg) {
+      grid->ops->read_tile(grid, cr, pd->level, ref, arg, &tmp_err);
+      grid->put_arg(grid->arg_ctx, arg);
+    }
+  } else {
+    grid->ops->read_tile(grid, cr, pd->level, ref, pd->arg, &tmp_err);
+  }
+  g_clear_error(&tmp_err);
+}
+
+// Decode the region's tiles into the cache on several threads, so the
+// subsequent serial paint finds them there.
+static void predecode_region(struct _openslide_grid *grid, void *arg,
+                             double x, double y,
+                             struct _openslide_level *level,
+                             int32_t w, int32_t h) {
+  openslide_t *osr = grid->osr;
+
+  int32_t threads = g_atomic_int_get(&osr->decode_threads);
+  if (threads < 2 || _openslide_in_parallel_for() ||
+      (arg && !grid->get_arg)) {
+    // disabled, nested, or the vendor's arg can't be shared across threads
+    return;
+  }
+
+  g_autoptr(GArray) tiles = g_array_new(false, false,
+                                        sizeof(struct tile_ref));
+  grid->ops->list_tiles(grid, x, y, w, h, tiles);
+  if (tiles->len < 2) {
+    return;
+  }
+
+  // if the cache can't hold the decoded tiles until we composite them,
+  // we'd only decode them twice.  tiles land in cache shards with separate
+  // budgets.  simple grids' tiles are cached by level, column, and row, so
+  // we can check each shard; otherwise assume they all land in one.
+  g_autofree int64_t *cols = g_new(int64_t, tiles->len);
+  g_autofree int64_t *rows = g_new(int64_t, tiles->len);
+  g_autofree uint64_t *sizes = g_new(uint64_t, tiles->len);
+  uint64_t bytes = 0;
+  for (guint i = 0; i < tiles->len; i++) {
+    struct tile_ref *ref = &g_array_index(tiles, struct tile_ref, i);
+    cols[i] = ref->col;
+    rows[i] = ref->row;
+    sizes[i] = 4 * (uint64_t) ceil(ref->w) * (uint64_t) ceil(ref->h);
+    bytes += sizes[i];
+  }
+  if (grid->ops == &simple_grid_ops) {
+    if (!_openslide_cache_can_keep_all(osr->cache, level, cols, rows,
+                                       sizes, tiles->len)) {
+      return;
+    }
+  } else if (bytes > _openslide_cache_get_min_shard_capacity(osr->cache)) {
+    return;
+  }
+
+  struct predecode pd = {
+    .grid = grid,
+    .level = level,
+    .tiles = tiles,
+    .caller = g_thread_self(),
+    .arg = arg,
+  };
+  _openslide_parallel_for(tiles->len, threads, predecode_tile, &pd);
+}
+
+// Read the stored data of the region's uncached tiles in one batch, so
+// the tile reads don't each wait on storage in turn.
+static void *fetch_region(struct _openslide_grid *grid, void *arg,
+                          double x, double y,
+                          struct _openslide_level *level,
+                          int32_t w, int32_t h) {
+  if (!grid->fetch) {
+    return NULL;
+  }
+
+  g_autoptr(GArray) tiles = g_array_new(false, false,
+                                        sizeof(struct tile_ref));
+  grid->ops->list_tiles(grid, x, y, w, h, tiles);
+  g_autoptr(GArray) cols = g_array_new(false, false, sizeof(int64_t));
+  g_autoptr(GArray) rows = g_array_new(false, false, sizeof(int64_t));
+  for (guint i = 0; i < tiles->len; i++) {
+    struct tile_ref *ref = &g_array_index(tiles, struct tile_ref, i);
+    if (!_openslide_cache_contains(grid->osr->cache, level,
+                                   ref->col, ref->row)) {
+      g_array_append_val(cols, ref->col);
+      g_array_append_val(rows, ref->row);
+    }
+  }
+  if (cols->len < 2) {
+    // nothing to batch
+    return NULL;
+  }
+  return grid->fetch(grid->fetch_ctx, arg,
+                     (const int64_t *) cols->data,
+                     (const int64_t *) rows->data,
+                     cols->len);
+}
+
+void _openslide_grid_set_worker_arg(struct _openslide_grid *grid,
+                                    _openslide_grid_get_arg_fn get_arg,
+                                    _openslide_grid_put_arg_fn put_arg,
+                                    void *ctx) {
+  grid->get_arg = get_arg;
+  grid->put_arg = put_arg;
+  grid->arg_ctx = ctx;
+}
+
+void _openslide_grid_set_fetch(struct _openslide_grid *grid,
+                               _openslide_grid_fetch_fn fetch,
+                               _openslide_grid_release_fn release,
+                               void *ctx, GDestroyNotify ctx_free) {
+  // other grids don't key their cache entries by column and row
+  g_assert(grid->ops == &simple_grid_ops);
+  g_assert(grid->fetch_ctx_free == NULL);
+  grid->fetch = fetch;
+  grid->release = release;
+  grid->fetch_ctx = ctx;
+  grid->fetch_ctx_free = ctx_free;
+}
+
+// called from shared-library constructor!
+void _openslide_grid_init(void) {
+  // note: g_getenv() is not reentrant
+  const char *str = g_getenv(DECODE_THREADS_ENV_VAR);
+  if (str) {
+    default_decode_threads = _openslide_grid_normalize_threads(atoi(str));
+  }
+}
+
+int32_t _openslide_grid_normalize_threads(int32_t threads) {
+  if (threads < 1) {
+    return g_get_num_processors();
+  }
+  return threads;
+}
+
+int32_t _openslide_grid_get_default_threads(void) {
+  return default_decode_threads;
+}
+
 void _openslide_grid_get_bounds(struct _openslide_grid *grid,
                                 double *x, double *y,
                                 double *w, double *h) {
@@ -895,16 +1298,215 @@ bool _openslide_grid_paint_region(struct _openslide_grid *grid,
                                   struct _openslide_level *level,
                                   int32_t w, int32_t h,
                                   GError **err) {
-  return grid->ops->paint_region(grid, cr, arg, x, y, level, w, h, err);
+  void *batch = fetch_region(grid, arg, x, y, level, w, h);
+  predecode_region(grid, arg, x, y, level, w, h);
+
+  // if nothing has been painted yet and our tiles can't overlap, each
+  // tile lands on transparent pixels.  debug labels break that.
+  bool blank = cairo_get_user_data(cr, &blank_target_key) != NULL;
+  cairo_set_user_data(cr, &blank_target_key, NULL, NULL);
+  struct direct_blit_bounds bounds = {
+    .w = grid->tile_advance_x,
+    .h = grid->tile_advance_y,
+  };
+  if (blank && grid->disjoint && !_openslide_debug(OPENSLIDE_DEBUG_TILES)) {
+    cairo_set_user_data(cr, &direct_blit_key, &bounds, NULL);
+  }
+  bool success = grid->ops->paint_region(grid, cr, arg, x, y, level, w, h,
+                                         err);
+  cairo_set_user_data(cr, &direct_blit_key, NULL, NULL);
+
+  if (batch) {
+    grid->release(grid->fetch_ctx, batch);
+  }
+  return success;
 }
 
 void _openslide_grid_destroy(struct _openslide_grid *grid) {
   if (grid == NULL) {
     return;
   }
+  if (grid->fetch_ctx_free) {
+    grid->fetch_ctx_free(grid->fetch_ctx);
+  }
   grid->ops->destroy(grid);
 }
 
+void _openslide_grid_note_blank_target(cairo_t *cr) {
+  cairo_set_user_data(cr, &blank_target_key, (void *) &blank_target_key,
+                      NULL);
+}
+
+// If cr is painting onto a transparent area of an image surface with
+// SATURATE and an integer translation, compositing is just a copy, so do
+// that without cairo.  Returns false if cairo is needed.
+static bool direct_blit(cairo_t *cr, const uint32_t *tiledata,
+                        cairo_format_t format,
+                        int32_t w, int32_t h) {
+  if (_openslide_debug(OPENSLIDE_DEBUG_NO_DIRECT_BLIT) ||
+      cairo_status(cr) != CAIRO_STATUS_SUCCESS ||
+      cairo_get_operator(cr) != CAIRO_OPERATOR_SATURATE) {
+    return false;
+  }
+
+  // target must be an ARGB32 image surface, without a group pushed
+  cairo_surface_t *target = cairo_get_target(cr);
+  if (cairo_get_group_target(cr) != target ||
+      cairo_surface_get_type(target) != CAIRO_SURFACE_TYPE_IMAGE ||
+      cairo_image_surface_get_format(target) != CAIRO_FORMAT_ARGB32) {
+    return false;
+  }
+  double offset_x, offset_y;
+  cairo_surface_get_device_offset(target, &offset_x, &offset_y);
+  if (offset_x != 0 || offset_y != 0) {
+    return false;
+  }
+
+  // transform must be an integer translation
+  cairo_matrix_t m;
+  cairo_get_matrix(cr, &m);
+  if (m.xx != 1 || m.yy != 1 || m.xy != 0 || m.yx != 0 ||
+      m.x0 != floor(m.x0) || m.y0 != floor(m.y0)) {
+    return false;
+  }
+
+  // clip must be a single integer rectangle
+  cairo_rectangle_list_t *clip = cairo_copy_clip_rectangle_list(cr);
+  if (clip->status != CAIRO_STATUS_SUCCESS || clip->num_rectangles > 1) {
+    cairo_rectangle_list_destroy(clip);
+    return false;
+  }
+  if (clip->num_rectangles == 0) {
+    // nothing visible
+    cairo_rectangle_list_destroy(clip);
+    return true;
+  }
+  cairo_rectangle_t clip_rect = clip->rectangles[0];
+  cairo_rectangle_list_destroy(clip);
+  if (clip_rect.x != floor(clip_rect.x) ||
+      clip_rect.y != floor(clip_rect.y) ||
+      clip_rect.width != floor(clip_rect.width) ||
+      clip_rect.height != floor(clip_rect.height)) {
+    return false;
+  }
+
+  // intersect tile with clip and surface, in device space
+  int64_t tile_x = m.x0;
+  int64_t tile_y = m.y0;
+  int64_t x0 = MAX(MAX(tile_x, clip_rect.x + m.x0), 0);
+  int64_t y0 = MAX(MAX(tile_y, clip_rect.y + m.y0), 0);
+  int64_t x1 = MIN(MIN(tile_x + w, clip_rect.x + clip_rect.width + m.x0),
+                   cairo_image_surface_get_width(target));
+  int64_t y1 = MIN(MIN(tile_y + h, clip_rect.y + clip_rect.height + m.y0),
+                   cairo_image_surface_get_height(target));
+  if (x0 >= x1 || y0 >= y1) {
+    return true;
+  }
+
+  // SATURATE onto transparent pixels is a copy.  the pixels are known to
+  // be transparent only if the grid says the tile can't cover another one.
+  struct direct_blit_bounds *bounds =
+    cairo_get_user_data(cr, &direct_blit_key);
+  if (!bounds || w > bounds->w || h > bounds->h) {
+    return false;
+  }
+
+  cairo_surface_flush(target);
+  unsigned char *data = cairo_image_surface_get_data(target);
+  int stride = cairo_image_surface_get_stride(target);
+  int64_t count = x1 - x0;
+  for (int64_t y = y0; y < y1; y++) {
+    uint32_t *dest = (uint32_t *) (data + y * stride) + x0;
+    const uint32_t *src = tiledata + (y - tile_y) * w + (x0 - tile_x);
+    if (format == CAIRO_FORMAT_RGB24) {
+      for (int64_t x = 0; x < count; x++) {
+        dest[x] = src[x] | 0xff000000;
+      }
+    } else {
+      memcpy(dest, src, count * 4);
+    }
+  }
+  cairo_surface_mark_dirty_rectangle(target, x0, y0, count, y1 - y0);
+  return true;
+}
+
+void _openslide_grid_paint_tile(cairo_t *cr, const uint32_t *tiledata,
+                                cairo_format_t format,
+                                int32_t w, int32_t h) {
+  if (direct_blit(cr, tiledata, format, w, h)) {
+    return;
+  }
+  g_autoptr(cairo_surface_t) surface =
+    cairo_image_surface_create_for_data((unsigned char *) tiledata,
+                                        format, w, h, w * 4);
+  cairo_set_source_surface(cr, surface, 0, 0);
+  cairo_paint(cr);
+}
+
+bool _openslide_grid_get_tile_crop(cairo_t *cr, int32_t w, int32_t h,
+                                   struct _openslide_tile_crop *crop) {
+  if (cairo_status(cr) != CAIRO_STATUS_SUCCESS) {
+    return false;
+  }
+  cairo_matrix_t m;
+  cairo_get_matrix(cr, &m);
+  if (m.xy != 0 || m.yx != 0 || m.xx <= 0 || m.yy <= 0) {
+    return false;
+  }
+
+  // bounded by the target surface, in tile pixels
+  double x1, y1, x2, y2;
+  cairo_clip_extents(cr, &x1, &y1, &x2, &y2);
+
+  // unless the transform is an integer translation, the pattern filter
+  // also samples tile pixels just outside the clip
+  double margin_x = 0;
+  double margin_y = 0;
+  if (m.xx != 1 || m.yy != 1 ||
+      m.x0 != floor(m.x0) || m.y0 != floor(m.y0)) {
+    margin_x = 1 + ceil(1 / m.xx);
+    margin_y = 1 + ceil(1 / m.yy);
+  }
+  int64_t cx0 = MAX(floor(x1 - margin_x), 0);
+  int64_t cy0 = MAX(floor(y1 - margin_y), 0);
+  int64_t cx1 = MIN(ceil(x2 + margin_x), w);
+  int64_t cy1 = MIN(ceil(y2 + margin_y), h);
+  if (cx0 >= cx1 || cy0 >= cy1 ||
+      (cx1 - cx0 == w && cy1 - cy0 == h)) {
+    return false;
+  }
+  crop->x = cx0;
+  crop->y = cy0;
+  crop->w = cx1 - cx0;
+  crop->h = cy1 - cy0;
+  return true;
+}
+
+bool _openslide_grid_paint_tile_cropped(openslide_t *osr,
+                                        cairo_t *cr,
+                                        struct _openslide_level *level,
+                                        int64_t tile_col, int64_t tile_row,
+                                        void *arg,
+                                        int32_t w, int32_t h,
+                                        _openslide_grid_decode_crop_fn decode,
+                                        bool *painted,
+                                        GError **err) {
+  *painted = false;
+  struct _openslide_tile_crop crop;
+  if (_openslide_cache_can_keep(osr->cache, level, tile_col, tile_row,
+                                (uint64_t) w * h * 4) ||
+      !_openslide_grid_get_tile_crop(cr, w, h, &crop)) {
+    return true;
+  }
+  g_autofree uint32_t *buf = g_malloc0((size_t) w * h * 4);
+  if (!decode(osr, level, tile_col, tile_row, arg, buf, &crop, err)) {
+    return false;
+  }
+  _openslide_grid_paint_tile(cr, buf, CAIRO_FORMAT_ARGB32, w, h);
+  *painted = true;
+  return true;
+}
+
 void _openslide_grid_draw_tile_info(cairo_t *cr, const char *fmt, ...) {
   if (!_openslide_debug(OPENSLIDE_DEBUG_TILES)) {
     return;
@@ -0,0 +1,375 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide project
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * VFS for reading slides from HTTP servers with range requests.
+ *
+ * Files are read in fixed-size blocks, which are kept in a per-file LRU
+ * cache.  A read needing several uncached blocks fetches them all in
+ * parallel.  Blocks being fetched by one thread are waited for, rather
+ * than fetched again, by others.  Connections, DNS lookups, and TLS
+ * sessions are shared across files.
+ */
+
+#include <config.h>
+
+#include "openslide-private.h"
+
+#include <string.h>
+#include <glib.h>
+#include <curl/curl.h>
+
+#define BLOCK_SIZE (256 << 10)
+// per file
+#define MAX_BLOCKS 128
+#define MAX_CONNECTIONS 8
+// give up on servers that stop responding
+#define CONNECT_TIMEOUT_SECS 30L
+#define LOW_SPEED_BYTES_PER_SEC 1L
+#define LOW_SPEED_TIME_SECS 60L
+
+struct block {
+  int64_t index;
+  uint8_t *data;
+  size_t len;
+  GList link;  // in lru, once ready
+  int users;  // reads waiting on or copying from the block
+  bool ready;
+  bool failed;
+};
+
+struct http_file {
+  char *url;
+  int64_t size;
+
+  GMutex lock;
+  GCond cond;  // a fetch finished
+  GHashTable *blocks;  // int64 index -> struct block
+  GQueue lru;  // ready blocks, most recent first
+};
+
+struct fetch {
+  CURL *easy;
+  struct block *block;
+  size_t got;
+  char range[64];
+};
+
+static CURLSH *share;
+static GMutex share_locks[CURL_LOCK_DATA_LAST];
+
+static void share_lock(CURL *handle G_GNUC_UNUSED, curl_lock_data data,
+                       curl_lock_access access G_GNUC_UNUSED,
+                       void *userptr G_GNUC_UNUSED) {
+  g_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *handle G_GNUC_UNUSED, curl_lock_data data,
+                         void *userptr G_GNUC_UNUSED) {
+  g_mutex_unlock(&share_locks[data]);
+}
+
+static void *init_curl(void *arg G_GNUC_UNUSED) {
+  if (curl_global_init(CURL_GLOBAL_DEFAULT)) {
+    return NULL;
+  }
+  CURLSH *sh = curl_share_init();
+  if (!sh) {
+    return NULL;
+  }
+  if (curl_share_setopt(sh, CURLSHOPT_LOCKFUNC, share_lock) ||
+      curl_share_setopt(sh, CURLSHOPT_UNLOCKFUNC, share_unlock) ||
+      curl_share_setopt(sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT) ||
+      curl_share_setopt(sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS) ||
+      curl_share_setopt(sh, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION)) {
+    curl_share_cleanup(sh);
+    return NULL;
+  }
+  share = sh;
+  return share;
+}
+
+static CURL *easy_new(const char *url) {
+  CURL *easy = curl_easy_init();
+  if (!easy) {
+    return NULL;
+  }
+  curl_easy_setopt(easy, CURLOPT_URL, url);
+  curl_easy_setopt(easy, CURLOPT_SHARE, share);
+  curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+  // we're called from arbitrary threads
+  curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT, CONNECT_TIMEOUT_SECS);
+  curl_easy_setopt(easy, CURLOPT_LOW_SPEED_LIMIT, LOW_SPEED_BYTES_PER_SEC);
+  curl_easy_setopt(easy, CURLOPT_LOW_SPEED_TIME, LOW_SPEED_TIME_SECS);
+  curl_easy_setopt(easy, CURLOPT_USERAGENT, "OpenSlide/" SUFFIXED_VERSION);
+  return easy;
+}
+
+static void block_free(struct block *b) {
+  g_free(b->data);
+  g_free(b);
+}
+
+static size_t write_block(char *ptr, size_t size, size_t nmemb,
+                          void *userdata) {
+  struct fetch *f = userdata;
+  size_t count = size * nmemb;
+  if (count > f->block->len - f->got) {
+    // more than we asked for; the server must have ignored the range
+    return 0;
+  }
+  memcpy(f->block->data + f->got, ptr, count);
+  f->got += count;
+  return count;
+}
+
+// fetch blocks in parallel, without holding the lock
+static void fetch_blocks(struct http_file *hf, struct block **blocks,
+                         uint32_t count) {
+  CURLM *multi = curl_multi_init();
+  curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                    (long) MAX_CONNECTIONS);
+  g_autofree struct fetch *fetches = g_new0(struct fetch, count);
+  for (uint32_t i = 0; i < count; i++) {
+    struct fetch *f = &fetches[i];
+    f->block = blocks[i];
+    f->easy = easy_new(hf->url);
+    if (!f->easy) {
+      continue;
+    }
+    int64_t start = blocks[i]->index * BLOCK_SIZE;
+    g_snprintf(f->range, sizeof(f->range), "%"PRId64"-%"PRId64,
+               start, start + (int64_t) blocks[i]->len - 1);
+    curl_easy_setopt(f->easy, CURLOPT_RANGE, f->range);
+    curl_easy_setopt(f->easy, CURLOPT_WRITEFUNCTION, write_block);
+    curl_easy_setopt(f->easy, CURLOPT_WRITEDATA, f);
+    curl_easy_setopt(f->easy, CURLOPT_PRIVATE, f);
+    curl_multi_add_handle(multi, f->easy);
+  }
+
+  int running;
+  do {
+    if (curl_multi_perform(multi, &running) != CURLM_OK) {
+      break;
+    }
+    if (running && curl_multi_wait(multi, NULL, 0, 1000, NULL) != CURLM_OK) {
+      break;
+    }
+  } while (running);
+
+  // a block is good if its transfer succeeded with a partial response,
+  // or with a full one if the block is the whole file
+  CURLMsg *msg;
+  int remaining;
+  while ((msg = curl_multi_info_read(multi, &remaining)) != NULL) {
+    if (msg->msg != CURLMSG_DONE) {
+      continue;
+    }
+    struct fetch *f;
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &f);
+    long status = 0;
+    curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &status);
+    bool whole_file = f->block->index == 0 &&
+                      (int64_t) f->block->len == hf->size;
+    f->block->ready = msg->data.result == CURLE_OK &&
+                      f->got == f->block->len &&
+                      (status == 206 || (status == 200 && whole_file));
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    struct fetch *f = &fetches[i];
+    if (f->easy) {
+      curl_multi_remove_handle(multi, f->easy);
+      curl_easy_cleanup(f->easy);
+    }
+    if (!f->block->ready) {
+      f->block->failed = true;
+    }
+  }
+  curl_multi_cleanup(multi);
+}
+
+// call with lock held
+static void evict_blocks(struct http_file *hf) {
+  GList *link = hf->lru.tail;
+  while (g_hash_table_size(hf->blocks) > MAX_BLOCKS && link) {
+    GList *prev = link->prev;
+    struct block *b = link->data;
+    if (!b->users) {
+      g_queue_unlink(&hf->lru, link);
+      g_hash_table_remove(hf->blocks, &b->index);
+    }
+    link = prev;
+  }
+}
+
+static int64_t http_read(void *handle, void *buf, int64_t size,
+                         int64_t offset) {
+  struct http_file *hf = handle;
+  if (offset < 0 || size < 0) {
+    return -1;
+  }
+  if (offset >= hf->size) {
+    return 0;
+  }
+  size = MIN(size, hf->size - offset);
+  if (size == 0) {
+    return 0;
+  }
+  int64_t first = offset / BLOCK_SIZE;
+  int64_t last = (offset + size - 1) / BLOCK_SIZE;
+  uint32_t count = last - first + 1;
+
+  // find our blocks, claiming the ones nobody has fetched
+  g_autofree struct block **blocks = g_new(struct block *, count);
+  g_autofree struct block **missing = g_new(struct block *, count);
+  uint32_t missing_count = 0;
+  g_mutex_lock(&hf->lock);
+  for (uint32_t i = 0; i < count; i++) {
+    int64_t index = first + i;
+    struct block *b = g_hash_table_lookup(hf->blocks, &index);
+    if (!b) {
+      b = g_new0(struct block, 1);
+      b->index = index;
+      b->len = MIN(BLOCK_SIZE, hf->size - index * BLOCK_SIZE);
+      b->data = g_malloc(b->len);
+      b->link.data = b;
+      g_hash_table_insert(hf->blocks, &b->index, b);
+      missing[missing_count++] = b;
+    } else if (b->ready) {
+      // move to the front of the LRU
+      g_queue_unlink(&hf->lru, &b->link);
+      g_queue_push_head_link(&hf->lru, &b->link);
+    }
+    b->users++;
+    blocks[i] = b;
+  }
+  g_mutex_unlock(&hf->lock);
+
+  if (missing_count) {
+    fetch_blocks(hf, missing, missing_count);
+  }
+
+  g_mutex_lock(&hf->lock);
+  for (uint32_t i = 0; i < missing_count; i++) {
+    struct block *b = missing[i];
+    if (b->ready) {
+      g_queue_push_head_link(&hf->lru, &b->link);
+    } else {
+      // let later reads try again
+      g_hash_table_steal(hf->blocks, &b->index);
+    }
+  }
+  if (missing_count) {
+    g_cond_broadcast(&hf->cond);
+  }
+
+  // wait for blocks fetched by others, and copy out
+  int64_t total = 0;
+  bool failed = false;
+  for (uint32_t i = 0; i < count; i++) {
+    struct block *b = blocks[i];
+    while (!b->ready && !b->failed) {
+      g_cond_wait(&hf->cond, &hf->lock);
+    }
+    if (b->failed) {
+      failed = true;
+    } else if (!failed) {
+      int64_t start = MAX(offset - b->index * BLOCK_SIZE, 0);
+      int64_t len = MIN((int64_t) b->len - start, size - total);
+      memcpy((uint8_t *) buf + total, b->data + start, len);
+      total += len;
+    }
+    // failed blocks were stolen from the table; the last user frees them
+    if (--b->users == 0 && b->failed) {
+      block_free(b);
+    }
+  }
+  evict_blocks(hf);
+  g_mutex_unlock(&hf->lock);
+
+  if (failed) {
+    // return what we have, so the caller retries the rest
+    return total ? total : -1;
+  }
+  return total;
+}
+
+static void *http_open(void *ctx G_GNUC_UNUSED, const char *path) {
+  static GOnce curl_once = G_ONCE_INIT;
+  if (!g_once(&curl_once, init_curl, NULL)) {
+    return NULL;
+  }
+
+  // get size
+  CURL *easy = easy_new(path);
+  if (!easy) {
+    return NULL;
+  }
+  curl_easy_setopt(easy, CURLOPT_NOBODY, 1L);
+  CURLcode result = curl_easy_perform(easy);
+  long status = 0;
+  curl_off_t size = -1;
+  curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+  curl_easy_getinfo(easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &size);
+  curl_easy_cleanup(easy);
+  if (result != CURLE_OK || status != 200 || size < 0) {
+    return NULL;
+  }
+
+  struct http_file *hf = g_new0(struct http_file, 1);
+  hf->url = g_strdup(path);
+  hf->size = size;
+  g_mutex_init(&hf->lock);
+  g_cond_init(&hf->cond);
+  hf->blocks = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL,
+                                     (GDestroyNotify) block_free);
+  g_queue_init(&hf->lru);
+  return hf;
+}
+
+static int64_t http_size(void *handle) {
+  struct http_file *hf = handle;
+  return hf->size;
+}
+
+static void http_close(void *handle) {
+  struct http_file *hf = handle;
+  g_hash_table_destroy(hf->blocks);
+  g_cond_clear(&hf->cond);
+  g_mutex_clear(&hf->lock);
+  g_free(hf->url);
+  g_free(hf);
+}
+
+static const openslide_vfs_ops_t http_ops = {
+  .open = http_open,
+  .read = http_read,
+  .size = http_size,
+  .close = http_close,
+};
+
+// called from shared-library constructor!
+void _openslide_http_init(void) {
+  _openslide_vfs_register("http", &http_ops, NULL);
+  _openslide_vfs_register("https", &http_ops, NULL);
+}
@@ -33,6 +33,7 @@ typedef struct {
   struct jpeg_source_mgr pub;		/* public fields */
 
   struct _openslide_file * infile;	/* source stream */
+  int64_t offset;			/* file offset of next read */
   JOCTET * buffer;			/* start of buffer */
   boolean start_of_file;		/* have we gotten any data yet? */
 } my_source_mgr;
@@ -102,7 +103,9 @@ static boolean fill_input_buffer (j_decompress_ptr cinfo)
   my_src_ptr src = (my_src_ptr) cinfo->src;
   size_t nbytes;
 
-  nbytes = _openslide_fread(src->infile, src->buffer, INPUT_BUF_SIZE);
+  nbytes = _openslide_fread_at(src->infile, src->offset, src->buffer,
+                               INPUT_BUF_SIZE);
+  src->offset += nbytes;
 
   if (nbytes <= 0) {
     if (src->start_of_file)	/* Treat empty input file as fatal error */
@@ -201,13 +204,15 @@ static void term_source (j_decompress_ptr cinfo G_GNUC_UNUSED)
 
 
 /*
- * Prepare for input from a stdio stream.
- * The caller must have already opened the stream, and is responsible
- * for closing it after finishing decompression.
+ * Prepare for input from a file, starting at the specified offset.
+ * The caller must have already opened the file, and is responsible
+ * for closing it after finishing decompression.  Reads are positional,
+ * so the file may be shared with other threads.
  */
 
 void _openslide_jpeg_stdio_src (j_decompress_ptr cinfo,
-                                struct _openslide_file * infile)
+                                struct _openslide_file * infile,
+                                int64_t offset)
 {
   my_src_ptr src;
 
@@ -235,6 +240,7 @@ void _openslide_jpeg_stdio_src (j_decompress_ptr cinfo,
   src->pub.resync_to_restart = jpeg_resync_to_restart; /* use default method */
   src->pub.term_source = term_source;
   src->infile = infile;
+  src->offset = offset;
   src->pub.bytes_in_buffer = 0; /* forces fill_input_buffer on first read */
   src->pub.next_input_byte = NULL; /* until buffer loaded */
 }
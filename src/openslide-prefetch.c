@@ -0,0 +1,253 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide project
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Background prefetching of hinted regions into the tile cache.
+ *
+ * Each hint is split into chunks, which are queued on a process-wide
+ * thread pool.  A worker "reads" its chunk onto a nil surface, which
+ * decodes the tiles into the handle's cache without compositing them.
+ * The pool is small, so prefetching can't starve foreground reads, and
+ * newer hints are serviced first, since they're more likely to describe
+ * where the viewer is going.
+ */
+
+#include "openslide-private.h"
+
+#include <glib.h>
+#include <cairo.h>
+
+// worker threads shared by all handles
+#define PREFETCH_THREADS 2
+// queued chunks shared by all handles; further chunks are dropped
+#define PREFETCH_MAX_QUEUED 1024
+// minimum chunk size, in level pixels
+#define PREFETCH_CHUNK_SIZE 512
+
+struct hint {
+  int id;
+  uint64_t serial;  // global sequence number, for ordering
+  uint32_t pending;  // chunks not yet finished
+  bool cancelled;
+};
+
+struct _openslide_prefetch {
+  GMutex lock;
+  GCond cond;
+  GHashTable *hints;  // int id -> struct hint
+  int next_id;
+  uint32_t outstanding;  // chunks not yet finished
+  bool closing;
+};
+
+struct chunk {
+  openslide_t *osr;
+  struct hint *hint;
+  uint32_t index;  // order within the hint
+  struct _openslide_level *level;
+  int64_t x;  // level 0 plane
+  int64_t y;
+  int32_t w;  // level plane
+  int32_t h;
+};
+
+static GThreadPool *pool;
+static gint queued;  // atomic ops only
+static uint64_t next_serial;  // protected by serial_lock
+static GMutex serial_lock;
+
+static bool prefetch_chunk(struct chunk *chunk, GError **err) {
+  // paint onto a nil surface, just for the side effect of caching tiles
+  g_autoptr(cairo_surface_t) surface =
+    cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 0, 0);
+  g_autoptr(cairo_t) cr = cairo_create(surface);
+  cairo_set_operator(cr, CAIRO_OPERATOR_SATURATE);
+  return chunk->osr->ops->paint_region(chunk->osr, cr, chunk->x, chunk->y,
+                                       chunk->level, chunk->w, chunk->h,
+                                       err);
+}
+
+static void chunk_done(struct _openslide_prefetch *pf, struct chunk *chunk) {
+  g_mutex_lock(&pf->lock);
+  struct hint *hint = chunk->hint;
+  if (--hint->pending == 0) {
+    g_hash_table_remove(pf->hints, &hint->id);
+  }
+  if (--pf->outstanding == 0) {
+    g_cond_broadcast(&pf->cond);
+  }
+  g_mutex_unlock(&pf->lock);
+  g_free(chunk);
+}
+
+static void worker(gpointer data, gpointer user_data G_GNUC_UNUSED) {
+  struct chunk *chunk = data;
+  struct _openslide_prefetch *pf = chunk->osr->prefetch;
+  g_atomic_int_add(&queued, -1);
+
+  g_mutex_lock(&pf->lock);
+  bool cancelled = chunk->hint->cancelled || pf->closing;
+  g_mutex_unlock(&pf->lock);
+
+  if (!cancelled && !openslide_get_error(chunk->osr)) {
+    g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+      _openslide_io_scope_enter(&chunk->osr->io_stats);
+    GError *tmp_err = NULL;
+    if (!prefetch_chunk(chunk, &tmp_err)) {
+      // a hint is only a hint; the foreground read will report the error
+      //g_debug("prefetch failed: %s", tmp_err->message);
+      g_clear_error(&tmp_err);
+    }
+  }
+  chunk_done(pf, chunk);
+}
+
+// newest hint first, then in order within the hint
+static gint compare_chunks(gconstpointer a, gconstpointer b,
+                           gpointer user_data G_GNUC_UNUSED) {
+  const struct chunk *ca = a;
+  const struct chunk *cb = b;
+  if (ca->hint->serial != cb->hint->serial) {
+    return ca->hint->serial > cb->hint->serial ? -1 : 1;
+  }
+  return ca->index < cb->index ? -1 : ca->index > cb->index;
+}
+
+static void *create_pool(void *arg G_GNUC_UNUSED) {
+  GError *tmp_err = NULL;
+  pool = g_thread_pool_new(worker, NULL, PREFETCH_THREADS, false, &tmp_err);
+  if (!pool) {
+    // only possible for exclusive pools
+    g_warning("Couldn't create prefetch thread pool: %s", tmp_err->message);
+    g_clear_error(&tmp_err);
+    return NULL;
+  }
+  g_thread_pool_set_sort_function(pool, compare_chunks, NULL);
+  return pool;
+}
+
+struct _openslide_prefetch *_openslide_prefetch_create(void) {
+  struct _openslide_prefetch *pf = g_new0(struct _openslide_prefetch, 1);
+  g_mutex_init(&pf->lock);
+  g_cond_init(&pf->cond);
+  pf->hints = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, g_free);
+  pf->next_id = 1;
+  return pf;
+}
+
+int _openslide_prefetch_hint(openslide_t *osr,
+                             int64_t x, int64_t y,
+                             int32_t level,
+                             int64_t w, int64_t h) {
+  static GOnce pool_once = G_ONCE_INIT;
+  if (!g_once(&pool_once, create_pool, NULL)) {
+    return -1;
+  }
+
+  struct _openslide_prefetch *pf = osr->prefetch;
+  struct _openslide_level *l = osr->levels[level];
+  double ds = l->downsample;
+
+  // clip to the level, in level coordinates
+  int64_t lx = MAX(x / ds, 0);
+  int64_t ly = MAX(y / ds, 0);
+  int64_t lx_end = MIN((x / ds) + w, l->w);
+  int64_t ly_end = MIN((y / ds) + h, l->h);
+
+  // chunks no smaller than a tile
+  int64_t chunk_w = MAX(l->tile_w, PREFETCH_CHUNK_SIZE);
+  int64_t chunk_h = MAX(l->tile_h, PREFETCH_CHUNK_SIZE);
+
+  struct hint *hint = g_new0(struct hint, 1);
+  g_mutex_lock(&serial_lock);
+  hint->serial = next_serial++;
+  g_mutex_unlock(&serial_lock);
+
+  g_mutex_lock(&pf->lock);
+  if (pf->next_id == G_MAXINT) {
+    pf->next_id = 1;
+  }
+  hint->id = pf->next_id++;
+  g_hash_table_insert(pf->hints, &hint->id, hint);
+
+  // hold the hint open while queueing, so chunks completing early can't
+  // free it
+  hint->pending = 1;
+  pf->outstanding++;
+  uint32_t index = 0;
+  for (int64_t cy = ly; cy < ly_end; cy += chunk_h) {
+    for (int64_t cx = lx; cx < lx_end; cx += chunk_w) {
+      if (g_atomic_int_add(&queued, 1) >= PREFETCH_MAX_QUEUED) {
+        // too much pending work; drop the rest of the hint
+        g_atomic_int_add(&queued, -1);
+        goto DONE;
+      }
+      struct chunk *chunk = g_new0(struct chunk, 1);
+      chunk->osr = osr;
+      chunk->hint = hint;
+      chunk->index = index++;
+      chunk->level = l;
+      chunk->x = cx * ds;
+      chunk->y = cy * ds;
+      chunk->w = MIN(chunk_w, lx_end - cx);
+      chunk->h = MIN(chunk_h, ly_end - cy);
+      hint->pending++;
+      pf->outstanding++;
+      g_thread_pool_push(pool, chunk, NULL);
+    }
+  }
+DONE:;
+  int id = hint->id;
+  if (--hint->pending == 0) {
+    g_hash_table_remove(pf->hints, &id);
+  }
+  if (--pf->outstanding == 0) {
+    g_cond_broadcast(&pf->cond);
+  }
+  g_mutex_unlock(&pf->lock);
+  return id;
+}
+
+void _openslide_prefetch_cancel(openslide_t *osr, int id) {
+  struct _openslide_prefetch *pf = osr->prefetch;
+  g_mutex_lock(&pf->lock);
+  struct hint *hint = g_hash_table_lookup(pf->hints, &id);
+  if (hint) {
+    // queued chunks will be skipped
+    hint->cancelled = true;
+  }
+  g_mutex_unlock(&pf->lock);
+}
+
+void _openslide_prefetch_destroy(struct _openslide_prefetch *pf) {
+  // skip queued chunks and wait for running ones
+  g_mutex_lock(&pf->lock);
+  pf->closing = true;
+  while (pf->outstanding) {
+    g_cond_wait(&pf->cond, &pf->lock);
+  }
+  g_mutex_unlock(&pf->lock);
+
+  g_hash_table_destroy(pf->hints);
+  g_cond_clear(&pf->cond);
+  g_mutex_clear(&pf->lock);
+  g_free(pf);
+}
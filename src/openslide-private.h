@@ -71,6 +71,18 @@ struct _openslide {
   // cache
   struct _openslide_cache_binding *cache;
 
+  // background prefetching
+  struct _openslide_prefetch *prefetch;
+
+  // threads for decoding a region's tiles
+  gint decode_threads; // atomic ops only
+
+  // where the slide was opened from, if not a path
+  struct _openslide_source *source;
+
+  // I/O counters; atomic ops only
+  openslide_io_stats_t io_stats;
+
   // error handling, NULL if no error
   gpointer error; // must use g_atomic_pointer!
 };
@@ -87,6 +99,8 @@ struct _openslide_level {
   int64_t tile_h;
 };
 
+struct _openslide_cache_entry;
+
 /* the function pointer structure for backends */
 struct _openslide_ops {
   bool (*paint_region)(openslide_t *osr, cairo_t *cr,
@@ -94,6 +108,25 @@ struct _openslide_ops {
 		       struct _openslide_level *level,
 		       int32_t w, int32_t h,
 		       GError **err);
+  // optional; only for backends whose levels have tile size hints and
+  // store native tiles of that size.  returns ARGB data with stride
+  // tile_w * 4, kept alive by the cache entry, or NULL on error.  May
+  // return NULL with err unset if the slide doesn't store the tile.  Either
+  // way, the caller unrefs any cache entry.
+  uint32_t *(*read_tile)(openslide_t *osr,
+                         struct _openslide_level *level,
+                         int64_t tile_col, int64_t tile_row,
+                         struct _openslide_cache_entry **entry,
+                         GError **err);
+  // optional; same requirements as read_tile.  returns the stored
+  // compressed tile, or NULL with err unset if it can't be passed through
+  // unchanged.
+  void *(*read_raw_tile)(openslide_t *osr,
+                         struct _openslide_level *level,
+                         int64_t tile_col, int64_t tile_row,
+                         enum openslide_tile_codec *codec,
+                         size_t *len,
+                         GError **err);
   void (*destroy)(openslide_t *osr);
 };
 
@@ -174,17 +207,128 @@ bool _openslide_clip_tile(uint32_t *tiledata,
 struct _openslide_file;
 
 struct _openslide_file *_openslide_fopen(const char *path, GError **err);
+// duplicates fd; the caller keeps ownership of the original
+struct _openslide_file *_openslide_fdopen(int fd, GError **err);
 size_t _openslide_fread(struct _openslide_file *file, void *buf, size_t size);
+// read at an offset without using the file position; safe to call from
+// several threads at once, but don't mix with fread/fseek on the same file
+size_t _openslide_fread_at(struct _openslide_file *file, off_t offset,
+                           void *buf, size_t size);
+// issue many positional reads at once, through io_uring if available and
+// pread otherwise.  Requests separated by at most OPENSLIDE_COALESCE_GAP
+// bytes (default 16 KiB) are merged into one read.  Offsets must not be
+// negative.  done is called on the calling thread as each read completes,
+// with the number of bytes read.
+struct _openslide_read_req {
+  off_t offset;
+  void *buf;
+  size_t size;
+};
+typedef void (*_openslide_read_done_fn)(struct _openslide_read_req *req,
+                                        size_t count, void *data);
+void _openslide_fread_batch(struct _openslide_file *file,
+                            struct _openslide_read_req *reqs, uint32_t count,
+                            _openslide_read_done_fn done, void *data);
+// bytes read between merged requests and then discarded
+uint64_t _openslide_fget_overread(struct _openslide_file *file);
 bool _openslide_fseek(struct _openslide_file *file, off_t offset, int whence,
                       GError **err);
 off_t _openslide_ftell(struct _openslide_file *file, GError **err);
 off_t _openslide_fsize(struct _openslide_file *file, GError **err);
+// if the file is memory-mapped, return a pointer to size bytes at offset,
+// valid until the file is closed; otherwise NULL
+const void *_openslide_fmap(struct _openslide_file *file, off_t offset,
+                            size_t size);
+bool _openslide_file_is_mapped(struct _openslide_file *file);
+// ask the OS to page in part of a memory-mapped file; no-op otherwise
+void _openslide_fmap_willneed(struct _openslide_file *file, off_t offset,
+                              size_t size);
 void _openslide_fclose(struct _openslide_file *file);
 bool _openslide_fexists(const char *path, GError **err);
 
 typedef struct _openslide_file _openslide_file;
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(_openslide_file, _openslide_fclose)
 
+void _openslide_file_init(void);
+
+/* I/O statistics.  File operations are counted against the stats of the
+   current scope on the calling thread, if any.  Enter a scope for the
+   handle at each entry point which may do I/O, and in threads doing work
+   for it. */
+struct _openslide_io_scope {
+  openslide_io_stats_t *prev;
+};
+
+struct _openslide_io_scope _openslide_io_scope_enter(openslide_io_stats_t *stats);
+void _openslide_io_scope_exit(struct _openslide_io_scope *scope);
+openslide_io_stats_t *_openslide_io_get_current(void);
+void _openslide_io_stats_get(openslide_io_stats_t *stats,
+                             openslide_io_stats_t *out);
+void _openslide_io_stats_add(openslide_io_stats_t *stats,
+                             const openslide_io_stats_t *other);
+
+typedef struct _openslide_io_scope _openslide_io_scope;
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC(_openslide_io_scope,
+                                 _openslide_io_scope_exit)
+
+// paths beginning with "scheme://" are opened through the VFS
+bool _openslide_vfs_register(const char *scheme,
+                             const openslide_vfs_ops_t *ops,
+                             void *ctx);
+
+// HTTP range-request VFS
+#ifdef HAVE_LIBCURL
+void _openslide_http_init(void);
+#endif
+
+/* Slides opened from memory or a file descriptor, through an internal
+   VFS.  The source must outlive every file opened from its path. */
+struct _openslide_source;
+
+void _openslide_source_init(void);
+// exactly one of fd (if not -1) or data is used for the slide file itself
+struct _openslide_source *_openslide_source_create(const char *name,
+                                                   int fd,
+                                                   const void *data,
+                                                   int64_t size,
+                                                   openslide_resolve_fn resolve,
+                                                   void *ctx,
+                                                   GError **err);
+const char *_openslide_source_get_path(struct _openslide_source *src);
+void _openslide_source_destroy(struct _openslide_source *src);
+
+/* A file opened on first use and then kept open for positional reads
+   from any thread, so tile reads don't pay for an open() each time.
+   Underlying files come from a process-wide pool bounded by
+   OPENSLIDE_MAX_OPEN_FILES; files which aren't pinned may be closed and
+   later reopened. */
+struct _openslide_shared_file;
+
+// a pinned file, valid until released with _openslide_pinned_file_put()
+struct _openslide_pinned_file {
+  struct _openslide_shared_file *sf;
+  struct _openslide_file *file;
+};
+
+struct _openslide_shared_file *_openslide_shared_file_create(const char *path);
+// file is NULL on error.  Use only _openslide_fread_at(),
+// _openslide_fread_batch(), _openslide_fsize(), and _openslide_fmap() on
+// it.  If OPENSLIDE_MMAP is set, the file is memory-mapped when possible,
+// and then stays open and its mapping valid until the shared file is
+// destroyed.
+struct _openslide_pinned_file _openslide_shared_file_get(struct _openslide_shared_file *sf,
+                                                         GError **err);
+void _openslide_pinned_file_put(struct _openslide_pinned_file *pf);
+void _openslide_shared_file_destroy(struct _openslide_shared_file *sf);
+void _openslide_file_get_stats(openslide_file_stats_t *stats);
+
+typedef struct _openslide_pinned_file _openslide_pinned_file;
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC(_openslide_pinned_file,
+                                 _openslide_pinned_file_put)
+typedef struct _openslide_shared_file _openslide_shared_file;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(_openslide_shared_file,
+                              _openslide_shared_file_destroy)
+
 struct _openslide_dir;
 
 struct _openslide_dir *_openslide_dir_open(const char *dirname, GError **err);
@@ -264,6 +408,89 @@ bool _openslide_grid_paint_region(struct _openslide_grid *grid,
                                   int32_t w, int32_t h,
                                   GError **err);
 
+// Parallel decoding.  If the handle's decode thread count is > 1, the
+// region's tiles are first decoded into the cache on a thread pool.  The
+// read_tile arg is only valid on the calling thread, so a grid painted with
+// a non-NULL arg must provide a way for pool workers to get their own.
+typedef void *(*_openslide_grid_get_arg_fn)(void *ctx, GError **err);
+typedef void (*_openslide_grid_put_arg_fn)(void *ctx, void *arg);
+
+void _openslide_grid_set_worker_arg(struct _openslide_grid *grid,
+                                    _openslide_grid_get_arg_fn get_arg,
+                                    _openslide_grid_put_arg_fn put_arg,
+                                    void *ctx);
+
+// Simple grids can read the stored data of a region's uncached tiles in
+// one batch before painting, rather than one tile at a time.  fetch
+// returns an opaque batch, which release discards after painting.
+typedef void *(*_openslide_grid_fetch_fn)(void *ctx, void *arg,
+                                          const int64_t *cols,
+                                          const int64_t *rows,
+                                          uint32_t count);
+typedef void (*_openslide_grid_release_fn)(void *ctx, void *batch);
+
+// grid takes ownership of ctx
+void _openslide_grid_set_fetch(struct _openslide_grid *grid,
+                               _openslide_grid_fetch_fn fetch,
+                               _openslide_grid_release_fn release,
+                               void *ctx, GDestroyNotify ctx_free);
+
+void _openslide_grid_init(void);
+
+// < 1 means one thread per processor
+int32_t _openslide_grid_normalize_threads(int32_t threads);
+
+int32_t _openslide_grid_get_default_threads(void);
+
+// Note that nothing has been painted onto cr's transparent target, so
+// grids whose tiles can't overlap may copy tiles straight into it.
+void _openslide_grid_note_blank_target(cairo_t *cr);
+
+// Paint a tile of w * h pixels with stride w * 4, for read_tile callbacks.
+// format is CAIRO_FORMAT_ARGB32 or CAIRO_FORMAT_RGB24.  Copies directly
+// into the destination surface when cairo's compositing would be a copy.
+void _openslide_grid_paint_tile(cairo_t *cr, const uint32_t *tiledata,
+                                cairo_format_t format,
+                                int32_t w, int32_t h);
+
+// part of a tile, in tile pixels
+struct _openslide_tile_crop {
+  int32_t x;
+  int32_t y;
+  int32_t w;
+  int32_t h;
+};
+
+// Get the part of a w * h tile that painting it at the cairo origin can
+// affect, for read_tile callbacks that can decode part of a tile.  Returns
+// false if that is the whole tile or nothing.
+bool _openslide_grid_get_tile_crop(cairo_t *cr, int32_t w, int32_t h,
+                                   struct _openslide_tile_crop *crop);
+
+// Decode the part of a tile covering crop into dest, a zeroed w * h ARGB
+// buffer, clipping it as when the whole tile is decoded.
+typedef bool (*_openslide_grid_decode_crop_fn)(openslide_t *osr,
+                                               struct _openslide_level *level,
+                                               int64_t tile_col,
+                                               int64_t tile_row,
+                                               void *arg,
+                                               uint32_t *dest,
+                                               const struct _openslide_tile_crop *crop,
+                                               GError **err);
+
+// For read_tile callbacks.  If the cache can't keep the w * h ARGB tile,
+// decode only the part being painted, paint it, and set *painted.
+// Otherwise leave the tile to the caller.  Returns false on error.
+bool _openslide_grid_paint_tile_cropped(openslide_t *osr,
+                                        cairo_t *cr,
+                                        struct _openslide_level *level,
+                                        int64_t tile_col, int64_t tile_row,
+                                        void *arg,
+                                        int32_t w, int32_t h,
+                                        _openslide_grid_decode_crop_fn decode,
+                                        bool *painted,
+                                        GError **err);
+
 void _openslide_grid_draw_tile_info(cairo_t *cr, const char *fmt, ...) G_GNUC_PRINTF(2, 3);
 
 void _openslide_grid_destroy(struct _openslide_grid *grid);
@@ -279,10 +506,14 @@ struct _openslide_cache_binding;
 struct _openslide_cache_entry;
 
 // create/release
-openslide_cache_t *_openslide_cache_create(uint64_t capacity_in_bytes);
+openslide_cache_t *_openslide_cache_create(uint64_t capacity_in_bytes,
+                                           enum openslide_cache_policy policy);
 
 void _openslide_cache_release(openslide_cache_t *cache);
 
+void _openslide_cache_get_stats(openslide_cache_t *cache,
+                                openslide_cache_stats_t *stats);
+
 // binding a cache to an openslide_t
 struct _openslide_cache_binding *_openslide_cache_binding_create(void);
 
@@ -291,7 +522,14 @@ void _openslide_cache_binding_set(struct _openslide_cache_binding *cb,
 
 void _openslide_cache_binding_destroy(struct _openslide_cache_binding *cb);
 
+void _openslide_cache_binding_get_stats(struct _openslide_cache_binding *cb,
+                                        openslide_cache_stats_t *stats);
+
 // put and get
+// On a miss, _openslide_cache_get() returns NULL and may set *entry to a
+// claim on the decode.  Other threads missing on the same key will wait
+// until the claim is passed to _openslide_cache_put() or unreffed.  So
+// the caller must not hold a claim while waiting for other work.
 void _openslide_cache_put(struct _openslide_cache_binding *cb,
 			  void *plane,  // coordinate plane (level or grid)
 			  int64_t x,
@@ -306,6 +544,32 @@ void *_openslide_cache_get(struct _openslide_cache_binding *cb,
 			   int64_t y,
 			   struct _openslide_cache_entry **entry);
 
+// whether a tile is cached or being decoded, without counting a lookup
+bool _openslide_cache_contains(struct _openslide_cache_binding *cb,
+                               void *plane,
+                               int64_t x,
+                               int64_t y);
+
+// whether _openslide_cache_put() would keep an entry of this size
+bool _openslide_cache_can_keep(struct _openslide_cache_binding *cb,
+                               void *plane,
+                               int64_t x,
+                               int64_t y,
+                               uint64_t size_in_bytes);
+
+// whether entries of these sizes and coordinates could all be cached at
+// once, without evicting each other from the shards they land in
+bool _openslide_cache_can_keep_all(struct _openslide_cache_binding *cb,
+                                   void *plane,
+                                   const int64_t *x,
+                                   const int64_t *y,
+                                   const uint64_t *sizes_in_bytes,
+                                   uint32_t count);
+
+// the capacity of the smallest shard, i.e. the most data that can be
+// cached at once regardless of the keys
+uint64_t _openslide_cache_get_min_shard_capacity(struct _openslide_cache_binding *cb);
+
 // value unref
 void _openslide_cache_entry_unref(struct _openslide_cache_entry *entry);
 
@@ -314,6 +578,34 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(_openslide_cache_entry,
                               _openslide_cache_entry_unref)
 
 
+/* Prefetch */
+struct _openslide_prefetch *_openslide_prefetch_create(void);
+
+// level must be in range
+int _openslide_prefetch_hint(openslide_t *osr,
+                             int64_t x, int64_t y,
+                             int32_t level,
+                             int64_t w, int64_t h);
+
+void _openslide_prefetch_cancel(openslide_t *osr, int id);
+
+// cancels queued work and waits for running work
+void _openslide_prefetch_destroy(struct _openslide_prefetch *pf);
+
+
+/* Parallel work */
+typedef void (*_openslide_parallel_fn)(uint32_t index, void *data);
+
+// Call func for each index in [0, count) on up to threads threads,
+// including the calling thread, and wait for the calls to finish.
+// Nested calls run serially.
+void _openslide_parallel_for(uint32_t count, int32_t threads,
+                             _openslide_parallel_fn func, void *data);
+
+// whether we're inside _openslide_parallel_for()
+bool _openslide_in_parallel_for(void);
+
+
 /* Internal error propagation */
 enum OpenSlideError {
   // generic failure
@@ -331,7 +623,11 @@ bool _openslide_check_cairo_status(cairo_t *cr, GError **err);
 /* Debug flags */
 enum _openslide_debug_flag {
   OPENSLIDE_DEBUG_DETECTION,
+  OPENSLIDE_DEBUG_IO,
   OPENSLIDE_DEBUG_JPEG_MARKERS,
+  OPENSLIDE_DEBUG_NO_DIRECT_BLIT,
+  OPENSLIDE_DEBUG_NO_JPEG_CROP,
+  OPENSLIDE_DEBUG_NO_JPEG_REUSE,
   OPENSLIDE_DEBUG_PERFORMANCE,
   OPENSLIDE_DEBUG_SEARCH,
   OPENSLIDE_DEBUG_SQL,
@@ -369,19 +665,6 @@ extern const int32_t _openslide_G_Cb[256];
 extern const int32_t _openslide_G_Cr[256];
 extern const int16_t _openslide_B_Cb[256];
 
-// deprecated prefetch stuff (maybe we'll undeprecate it someday),
-// still needs these declarations for ABI compat
-// TODO: remove if soname bump
-#undef openslide_give_prefetch_hint
-OPENSLIDE_PUBLIC()
-int openslide_give_prefetch_hint(openslide_t *osr,
-				 int64_t x, int64_t y,
-				 int32_t level,
-				 int64_t w, int64_t h);
-#undef openslide_cancel_prefetch_hint
-OPENSLIDE_PUBLIC()
-void openslide_cancel_prefetch_hint(openslide_t *osr, int prefetch_id);
-
 /* Prevent use of dangerous functions and functions with mandatory wrappers.
    Every @p replacement must be unique to avoid conflicting-type errors. */
 #define _OPENSLIDE_POISON(replacement) error__use_ ## replacement ## _instead
@@ -0,0 +1,256 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide project
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Slides opened from memory buffers or file descriptors.
+ *
+ * Each source gets a path of the form "openslide-source://ID/NAME", which
+ * is opened through an internal VFS.  Formats then build sibling paths
+ * relative to it as usual, and the VFS hands those to the caller's
+ * resolver.  No paths are looked up in the filesystem.
+ */
+
+#include <config.h>
+
+#include "openslide-private.h"
+
+#include <string.h>
+#include <glib.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define SOURCE_SCHEME "openslide-source"
+
+struct _openslide_source {
+  uint64_t id;
+  char *name;
+  char *path;
+  // the slide file itself
+  const uint8_t *data;
+  int64_t size;
+  struct _openslide_file *file;  // if from a descriptor
+  openslide_resolve_fn resolve;
+  void *ctx;
+};
+
+// a file opened through the VFS; either in memory or descriptor-backed
+struct source_file {
+  const uint8_t *data;
+  int64_t size;
+  struct _openslide_file *file;
+  bool owns_file;  // false for the source's own descriptor
+};
+
+static GMutex sources_lock;
+static GHashTable *sources;  // uint64 id -> struct _openslide_source
+static uint64_t next_id;  // protected by sources_lock
+
+static struct source_file *file_from_file(struct _openslide_file *f,
+                                          bool owns_file) {
+  int64_t size = _openslide_fsize(f, NULL);
+  if (size == -1) {
+    if (owns_file) {
+      _openslide_fclose(f);
+    }
+    return NULL;
+  }
+  struct source_file *sfile = g_new0(struct source_file, 1);
+  sfile->file = f;
+  sfile->size = size;
+  sfile->owns_file = owns_file;
+  return sfile;
+}
+
+// takes ownership of fd
+static struct source_file *file_from_fd(int fd) {
+  struct _openslide_file *f = _openslide_fdopen(fd, NULL);
+#ifdef _WIN32
+  _close(fd);
+#else
+  close(fd);
+#endif
+  if (!f) {
+    return NULL;
+  }
+  return file_from_file(f, true);
+}
+
+static struct source_file *file_from_memory(const void *data, int64_t size) {
+  if (!data || size < 0) {
+    return NULL;
+  }
+  struct source_file *sfile = g_new0(struct source_file, 1);
+  sfile->data = data;
+  sfile->size = size;
+  return sfile;
+}
+
+static void *source_open(void *ctx G_GNUC_UNUSED, const char *path) {
+  // the outer open through the VFS is already counted
+  g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+    _openslide_io_scope_enter(NULL);
+
+  // formats build sibling paths with the platform directory separator
+  g_autofree char *normalized = g_strdelimit(g_strdup(path), "\\", '/');
+
+  // parse "openslide-source://ID/NAME"
+  const char *p = normalized + strlen(SOURCE_SCHEME "://");
+  char *end;
+  uint64_t id = g_ascii_strtoull(p, &end, 10);
+  if (end == p || *end != '/') {
+    return NULL;
+  }
+  const char *name = end + 1;
+
+  g_mutex_lock(&sources_lock);
+  struct _openslide_source *src =
+    sources ? g_hash_table_lookup(sources, &id) : NULL;
+  g_mutex_unlock(&sources_lock);
+  if (!src) {
+    return NULL;
+  }
+
+  // the slide file itself
+  if (g_str_equal(name, src->name)) {
+    if (src->file) {
+      return file_from_file(src->file, false);
+    }
+    return file_from_memory(src->data, src->size);
+  }
+
+  // a sibling
+  if (!src->resolve) {
+    return NULL;
+  }
+  int fd = -1;
+  const void *data = NULL;
+  int64_t size = -1;
+  if (!src->resolve(src->ctx, name, &fd, &data, &size)) {
+    return NULL;
+  }
+  if (fd != -1) {
+    return file_from_fd(fd);
+  }
+  return file_from_memory(data, size);
+}
+
+static int64_t source_read(void *handle, void *buf, int64_t size,
+                           int64_t offset) {
+  struct source_file *sfile = handle;
+  if (sfile->file) {
+    // the outer read through the VFS is already counted
+    g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+      _openslide_io_scope_enter(NULL);
+    return _openslide_fread_at(sfile->file, offset, buf, size);
+  }
+  if (offset >= sfile->size) {
+    return 0;
+  }
+  int64_t count = MIN(size, sfile->size - offset);
+  memcpy(buf, sfile->data + offset, count);
+  return count;
+}
+
+static int64_t source_size(void *handle) {
+  struct source_file *sfile = handle;
+  return sfile->size;
+}
+
+static void source_close(void *handle) {
+  struct source_file *sfile = handle;
+  if (sfile->owns_file) {
+    _openslide_fclose(sfile->file);
+  }
+  g_free(sfile);
+}
+
+static const openslide_vfs_ops_t source_ops = {
+  .open = source_open,
+  .read = source_read,
+  .size = source_size,
+  .close = source_close,
+};
+
+struct _openslide_source *_openslide_source_create(const char *name,
+                                                   int fd,
+                                                   const void *data,
+                                                   int64_t size,
+                                                   openslide_resolve_fn resolve,
+                                                   void *ctx,
+                                                   GError **err) {
+  // take our own descriptor, so the caller can close theirs
+  struct _openslide_file *file = NULL;
+  if (fd != -1) {
+    file = _openslide_fdopen(fd, err);
+    if (!file) {
+      return NULL;
+    }
+  }
+
+  struct _openslide_source *src = g_new0(struct _openslide_source, 1);
+  // detection may depend on the extension, so keep the caller's name
+  src->name = g_path_get_basename(name ? name : "slide");
+  src->file = file;
+  src->data = data;
+  src->size = size;
+  src->resolve = resolve;
+  src->ctx = ctx;
+
+  g_mutex_lock(&sources_lock);
+  if (!sources) {
+    sources = g_hash_table_new(g_int64_hash, g_int64_equal);
+  }
+  src->id = next_id++;
+  g_hash_table_insert(sources, &src->id, src);
+  g_mutex_unlock(&sources_lock);
+
+  src->path = g_strdup_printf(SOURCE_SCHEME "://%"PRIu64"/%s",
+                              src->id, src->name);
+  return src;
+}
+
+const char *_openslide_source_get_path(struct _openslide_source *src) {
+  return src->path;
+}
+
+void _openslide_source_destroy(struct _openslide_source *src) {
+  if (src == NULL) {
+    return;
+  }
+  g_mutex_lock(&sources_lock);
+  g_hash_table_remove(sources, &src->id);
+  g_mutex_unlock(&sources_lock);
+  if (src->file) {
+    _openslide_fclose(src->file);
+  }
+  g_free(src->path);
+  g_free(src->name);
+  g_free(src);
+}
+
+// called from shared-library constructor!
+void _openslide_source_init(void) {
+  _openslide_vfs_register(SOURCE_SCHEME, &source_ops, NULL);
+}
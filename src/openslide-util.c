@@ -41,8 +41,15 @@ static const struct debug_option {
   const char *desc;
 } debug_options[] = {
   {"detection", OPENSLIDE_DEBUG_DETECTION, "log format detection errors"},
+  {"io", OPENSLIDE_DEBUG_IO, "log I/O statistics when closing a slide"},
   {"jpeg-markers", OPENSLIDE_DEBUG_JPEG_MARKERS,
    "verify Hamamatsu restart markers"},
+  {"no-direct-blit", OPENSLIDE_DEBUG_NO_DIRECT_BLIT,
+   "always composite tiles with cairo"},
+  {"no-jpeg-crop", OPENSLIDE_DEBUG_NO_JPEG_CROP,
+   "decode whole tiles even if the cache can't keep them"},
+  {"no-jpeg-reuse", OPENSLIDE_DEBUG_NO_JPEG_REUSE,
+   "create a new JPEG decompressor for every image"},
   {"performance", OPENSLIDE_DEBUG_PERFORMANCE,
    "log conditions causing poor performance"},
   {"search", OPENSLIDE_DEBUG_SEARCH,
@@ -335,3 +342,116 @@ void _openslide_performance_warn_once(gint *warned_flag,
     }
   }
 }
+
+// work shared by the calling thread and some pool workers
+struct parallel_work {
+  gint refcount;
+  _openslide_parallel_fn func;
+  void *data;
+  openslide_io_stats_t *io_stats;  // the caller's
+
+  GMutex lock;
+  GCond cond;
+  uint32_t count;
+  uint32_t next;  // next index to claim
+  uint32_t busy;  // calls in progress
+};
+
+static GThreadPool *parallel_pool;
+// set in threads running parallel work, to prevent nesting
+static GPrivate in_parallel_work = G_PRIVATE_INIT(NULL);
+
+static void parallel_work_unref(struct parallel_work *work) {
+  if (g_atomic_int_dec_and_test(&work->refcount)) {
+    g_cond_clear(&work->cond);
+    g_mutex_clear(&work->lock);
+    g_free(work);
+  }
+}
+
+static void parallel_work_run(struct parallel_work *work) {
+  g_private_set(&in_parallel_work, GINT_TO_POINTER(1));
+  g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+    _openslide_io_scope_enter(work->io_stats);
+  while (true) {
+    g_mutex_lock(&work->lock);
+    if (work->next == work->count) {
+      g_mutex_unlock(&work->lock);
+      break;
+    }
+    uint32_t index = work->next++;
+    work->busy++;
+    g_mutex_unlock(&work->lock);
+
+    // func and data are only guaranteed valid while we hold an index
+    work->func(index, work->data);
+
+    g_mutex_lock(&work->lock);
+    if (--work->busy == 0) {
+      g_cond_broadcast(&work->cond);
+    }
+    g_mutex_unlock(&work->lock);
+  }
+  g_private_set(&in_parallel_work, NULL);
+}
+
+static void parallel_worker(gpointer data, gpointer user_data G_GNUC_UNUSED) {
+  struct parallel_work *work = data;
+  parallel_work_run(work);
+  parallel_work_unref(work);
+}
+
+static void *create_parallel_pool(void *arg G_GNUC_UNUSED) {
+  GError *tmp_err = NULL;
+  parallel_pool = g_thread_pool_new(parallel_worker, NULL,
+                                    g_get_num_processors(), false, &tmp_err);
+  if (!parallel_pool) {
+    // only possible for exclusive pools
+    g_warning("Couldn't create thread pool: %s", tmp_err->message);
+    g_clear_error(&tmp_err);
+  }
+  return parallel_pool;
+}
+
+// The calling thread runs calls too, and then waits only for calls that
+// pool workers have already started, so a saturated pool can't deadlock
+// us.  Workers that start after the work is exhausted just drop their ref.
+void _openslide_parallel_for(uint32_t count, int32_t threads,
+                             _openslide_parallel_fn func, void *data) {
+  static GOnce pool_once = G_ONCE_INIT;
+
+  if (threads < 2 || count < 2 || _openslide_in_parallel_for() ||
+      !g_once(&pool_once, create_parallel_pool, NULL)) {
+    for (uint32_t i = 0; i < count; i++) {
+      func(i, data);
+    }
+    return;
+  }
+
+  struct parallel_work *work = g_new0(struct parallel_work, 1);
+  work->refcount = 1;
+  work->func = func;
+  work->data = data;
+  work->io_stats = _openslide_io_get_current();
+  work->count = count;
+  g_mutex_init(&work->lock);
+  g_cond_init(&work->cond);
+
+  uint32_t workers = MIN((uint32_t) threads, count) - 1;
+  for (uint32_t i = 0; i < workers; i++) {
+    g_atomic_int_inc(&work->refcount);
+    g_thread_pool_push(parallel_pool, work, NULL);
+  }
+  parallel_work_run(work);
+
+  g_mutex_lock(&work->lock);
+  while (work->busy) {
+    g_cond_wait(&work->cond, &work->lock);
+  }
+  g_mutex_unlock(&work->lock);
+  parallel_work_unref(work);
+}
+
+bool _openslide_in_parallel_for(void) {
+  return g_private_get(&in_parallel_work) != NULL;
+}
@@ -29,6 +29,7 @@
 
 #include "openslide-private.h"
 #include "openslide-decode-jp2k.h"
+#include "openslide-decode-jpeg.h"
 #include "openslide-decode-tiff.h"
 #include "openslide-decode-tifflike.h"
 
@@ -54,6 +55,7 @@ struct level {
   struct level *prev;
   GHashTable *missing_tiles;
   uint16_t compression;
+  int32_t jp2k_resolutions;  // 0 if not yet known
 };
 
 static void destroy_level(struct level *l) {
@@ -119,10 +121,12 @@ static bool render_missing_tile(struct level *l,
   return _openslide_check_cairo_status(cr, err);
 }
 
-static bool decode_tile(struct level *l,
+static bool decode_tile(openslide_t *osr,
+                        struct level *l,
                         TIFF *tiff,
                         uint32_t *dest,
                         int64_t tile_col, int64_t tile_row,
+                        const struct _openslide_tile_crop *crop,  // optional
                         GError **err) {
   struct _openslide_tiff_level *tiffl = &l->tiffl;
 
@@ -145,18 +149,19 @@ static bool decode_tile(struct level *l,
     break;
   default:
     // not for us? fallback
-    return _openslide_tiff_read_tile(tiffl, tiff, dest,
-                                     tile_col, tile_row,
-                                     err);
+    return _openslide_tiff_read_tile_cropped(tiffl, tiff, dest,
+                                             tile_col, tile_row, crop,
+                                             err);
   }
 
   // read raw tile
-  g_autofree void *buf = NULL;
+  const void *buf;
   int32_t buflen;
-  if (!_openslide_tiff_read_tile_data(tiffl, tiff,
-                                      &buf, &buflen,
-                                      tile_col, tile_row,
-                                      err)) {
+  g_autofree void *owned = NULL;
+  if (!_openslide_tiff_read_tile_data_borrowed(tiffl, tiff,
+                                               &buf, &buflen, &owned,
+                                               tile_col, tile_row,
+                                               err)) {
     return false;
   }
 
@@ -165,59 +170,161 @@ static bool decode_tile(struct level *l,
                                        tiffl->tile_w, tiffl->tile_h,
                                        buf, buflen,
                                        space,
+                                       tiffl->scale_denom,
+                                       g_atomic_int_get(&osr->decode_threads),
+                                       crop,
                                        err);
 }
 
-static bool read_tile(openslide_t *osr,
-		      cairo_t *cr,
-		      struct _openslide_level *level,
-		      int64_t tile_col, int64_t tile_row,
-		      void *arg,
-		      GError **err) {
+static uint32_t *get_tile(openslide_t *osr,
+                          struct _openslide_level *level,
+                          int64_t tile_col, int64_t tile_row,
+                          TIFF *tiff,
+                          struct _openslide_cache_entry **cache_entry,
+                          GError **err) {
   struct level *l = (struct level *) level;
   struct _openslide_tiff_level *tiffl = &l->tiffl;
-  TIFF *tiff = arg;
 
   // tile size
   int64_t tw = tiffl->tile_w;
   int64_t th = tiffl->tile_h;
 
   // cache
-  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
   uint32_t *tiledata = _openslide_cache_get(osr->cache,
                                             level, tile_col, tile_row,
-                                            &cache_entry);
+                                            cache_entry);
   if (!tiledata) {
     g_autofree uint32_t *buf = g_malloc(tw * th * 4);
-    if (!decode_tile(l, tiff, buf, tile_col, tile_row, err)) {
-      return false;
+    if (!decode_tile(osr, l, tiff, buf, tile_col, tile_row, NULL, err)) {
+      return NULL;
     }
 
     // clip, if necessary
     if (!_openslide_tiff_clip_tile(tiffl, buf,
                                    tile_col, tile_row,
                                    err)) {
-      return false;
+      return NULL;
     }
 
     // put it in the cache
     tiledata = g_steal_pointer(&buf);
     _openslide_cache_put(osr->cache, level, tile_col, tile_row,
 			 tiledata, tw * th * 4,
-			 &cache_entry);
+			 cache_entry);
+  }
+  return tiledata;
+}
+
+static bool decode_tile_crop(openslide_t *osr,
+                             struct _openslide_level *level,
+                             int64_t tile_col, int64_t tile_row,
+                             void *arg,
+                             uint32_t *dest,
+                             const struct _openslide_tile_crop *crop,
+                             GError **err) {
+  struct level *l = (struct level *) level;
+  return decode_tile(osr, l, arg, dest, tile_col, tile_row, crop, err) &&
+         _openslide_tiff_clip_tile(&l->tiffl, dest, tile_col, tile_row, err);
+}
+
+static bool read_tile(openslide_t *osr,
+		      cairo_t *cr,
+		      struct _openslide_level *level,
+		      int64_t tile_col, int64_t tile_row,
+		      void *arg,
+		      GError **err) {
+  struct level *l = (struct level *) level;
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+  int64_t tw = tiffl->tile_w;
+  int64_t th = tiffl->tile_h;
+
+  // if the cache can't keep the tile, decode only the part being painted
+  bool painted;
+  if (!_openslide_grid_paint_tile_cropped(osr, cr, level, tile_col, tile_row,
+                                          arg, tw, th, decode_tile_crop,
+                                          &painted, err)) {
+    return false;
+  }
+  if (painted) {
+    return true;
+  }
+
+  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
+  uint32_t *tiledata = get_tile(osr, level, tile_col, tile_row, arg,
+                                &cache_entry, err);
+  if (!tiledata) {
+    return false;
   }
 
   // draw it
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                        CAIRO_FORMAT_ARGB32,
-                                        tw, th, tw * 4);
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  _openslide_grid_paint_tile(cr, tiledata, CAIRO_FORMAT_ARGB32, tw, th);
 
   return true;
 }
 
+static uint32_t *read_native_tile(openslide_t *osr,
+                                  struct _openslide_level *level,
+                                  int64_t tile_col, int64_t tile_row,
+                                  struct _openslide_cache_entry **cache_entry,
+                                  GError **err) {
+  struct aperio_ops_data *data = osr->data;
+  struct level *l = (struct level *) level;
+
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(data->tc, &l->tiffl, &ct, err)) {
+    return NULL;
+  }
+  return get_tile(osr, level, tile_col, tile_row, ct.tiff, cache_entry, err);
+}
+
+static void *read_raw_tile(openslide_t *osr,
+                           struct _openslide_level *level,
+                           int64_t tile_col, int64_t tile_row,
+                           enum openslide_tile_codec *codec,
+                           size_t *len,
+                           GError **err) {
+  struct aperio_ops_data *data = osr->data;
+  struct level *l = (struct level *) level;
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+
+  // missing tiles are synthesized from another level
+  int64_t tile_no = tile_row * tiffl->tiles_across + tile_col;
+  if (g_hash_table_lookup_extended(l->missing_tiles, &tile_no, NULL, NULL)) {
+    return NULL;
+  }
+
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(data->tc, &l->tiffl, &ct, err)) {
+    return NULL;
+  }
+
+  switch (l->compression) {
+  case APERIO_COMPRESSION_JP2K_YCBCR:
+    // the codestream doesn't say that its components are YCbCr
+    return NULL;
+  case APERIO_COMPRESSION_JP2K_RGB: {
+    if (tiffl->scale_denom > 1) {
+      // virtual level
+      return NULL;
+    }
+    void *buf;
+    int32_t buflen;
+    if (!_openslide_tiff_read_tile_data(tiffl, ct.tiff,
+                                        &buf, &buflen,
+                                        tile_col, tile_row,
+                                        err)) {
+      return NULL;
+    }
+    *codec = OPENSLIDE_TILE_CODEC_JPEG2000;
+    *len = buflen;
+    return buf;
+  }
+  default:
+    return _openslide_tiff_read_raw_tile(tiffl, ct.tiff, tile_col, tile_row,
+                                         codec, len, err);
+  }
+}
+
 static bool paint_region(openslide_t *osr, cairo_t *cr,
 			 int64_t x, int64_t y,
 			 struct _openslide_level *level,
@@ -226,8 +333,8 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
   struct aperio_ops_data *data = osr->data;
   struct level *l = (struct level *) level;
 
-  g_auto(_openslide_cached_tiff) ct = _openslide_tiffcache_get(data->tc, err);
-  if (ct.tiff == NULL) {
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(data->tc, &l->tiffl, &ct, err)) {
     return false;
   }
 
@@ -240,6 +347,8 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
 
 static const struct _openslide_ops aperio_ops = {
   .paint_region = paint_region,
+  .read_tile = read_native_tile,
+  .read_raw_tile = read_raw_tile,
   .destroy = destroy,
 };
 
@@ -373,6 +482,99 @@ static void propagate_missing_tile(void *key, void *value G_GNUC_UNUSED,
   g_hash_table_insert(next_l->missing_tiles, next_tile_no, NULL);
 }
 
+static bool is_jp2k(struct level *l) {
+  return l->compression == APERIO_COMPRESSION_JP2K_YCBCR ||
+         l->compression == APERIO_COMPRESSION_JP2K_RGB;
+}
+
+// read the resolution count from the level's first stored tile
+static bool get_jp2k_resolutions(struct _openslide_tiffcache *tc,
+                                 struct level *l,
+                                 int32_t *resolutions,
+                                 GError **err) {
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+  int64_t tile_no = 0;
+  while (g_hash_table_lookup_extended(l->missing_tiles, &tile_no,
+                                      NULL, NULL)) {
+    if (++tile_no == tiffl->tiles_across * tiffl->tiles_down) {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "No stored tiles in directory %d", tiffl->dir);
+      return false;
+    }
+  }
+
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(tc, tiffl, &ct, err)) {
+    return false;
+  }
+  g_autofree void *buf = NULL;
+  int32_t buflen;
+  if (!_openslide_tiff_read_tile_data(tiffl, ct.tiff, &buf, &buflen,
+                                      tile_no % tiffl->tiles_across,
+                                      tile_no / tiffl->tiles_across,
+                                      err)) {
+    return false;
+  }
+  return _openslide_jp2k_get_resolutions(buf, buflen, resolutions, err);
+}
+
+static struct _openslide_level *create_scaled_level(openslide_t *osr,
+                                                    struct _openslide_level *parent,
+                                                    int32_t scale_denom,
+                                                    void *ctx) {
+  struct _openslide_tiffcache *tc = ctx;
+  struct level *parent_l = (struct level *) parent;
+
+  // JP2K tiles can be reduced by discarding resolution levels, as long as
+  // the codestream has enough of them
+  if (is_jp2k(parent_l)) {
+    if (!parent_l->jp2k_resolutions) {
+      if (!get_jp2k_resolutions(tc, parent_l, &parent_l->jp2k_resolutions,
+                                NULL)) {
+        // unknown; don't reduce.  Reading the tiles will report the error.
+        parent_l->jp2k_resolutions = 1;
+      }
+    }
+    if (scale_denom >= 1 << MIN(parent_l->jp2k_resolutions, 16)) {
+      return NULL;
+    }
+  }
+
+  struct level *l = g_new0(struct level, 1);
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+  if (!_openslide_tiff_level_init_scaled(parent, &parent_l->tiffl,
+                                         scale_denom,
+                                         is_jp2k(parent_l),
+                                         (struct _openslide_level *) l,
+                                         tiffl)) {
+    g_free(l);
+    return NULL;
+  }
+  l->compression = parent_l->compression;
+  l->grid = _openslide_grid_create_simple(osr,
+                                          tiffl->tiles_across,
+                                          tiffl->tiles_down,
+                                          tiffl->tile_w,
+                                          tiffl->tile_h,
+                                          read_tile);
+  _openslide_tiffcache_set_grid_worker_arg(tc, l->grid);
+  _openslide_tiffcache_set_grid_fetch(tc, tiffl, l->grid);
+
+  // the parent's missing tiles are missing here too, and are painted
+  // from the parent's previous level by way of the parent
+  l->prev = parent_l;
+  l->missing_tiles = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                           g_free, NULL);
+  GHashTableIter iter;
+  int64_t *tile_no;
+  g_hash_table_iter_init(&iter, parent_l->missing_tiles);
+  while (g_hash_table_iter_next(&iter, (void **) &tile_no, NULL)) {
+    g_hash_table_insert(l->missing_tiles,
+                        g_memdup(tile_no, sizeof(*tile_no)), NULL);
+  }
+  return (struct _openslide_level *) l;
+}
+
 static bool aperio_open(openslide_t *osr,
                         const char *filename,
                         struct _openslide_tifflike *tl,
@@ -458,6 +660,7 @@ static bool aperio_open(openslide_t *osr,
                                               tiffl->tile_w,
                                               tiffl->tile_h,
                                               read_tile);
+      _openslide_tiffcache_set_grid_worker_arg(tc, l->grid);
 
       // get compression
       if (!TIFFGetField(ct.tiff, TIFFTAG_COMPRESSION, &l->compression)) {
@@ -465,6 +668,10 @@ static bool aperio_open(openslide_t *osr,
                     "Can't read compression scheme");
         return false;
       }
+      if (tiffl->tile_read_direct || is_jp2k(l)) {
+        _openslide_tiffcache_set_grid_fetch(tc, tiffl, l->grid);
+        _openslide_tiffcache_set_level_tiles(tc, tl, tiffl);
+      }
 
       // some Aperio slides have some zero-length tiles, apparently due to
       // an encoder bug
@@ -502,6 +709,23 @@ static bool aperio_open(openslide_t *osr,
                          level_array->pdata[i + 1]);
   }
 
+  // missing tiles are painted from the previous level with the same TIFF
+  // handle, so read all levels without handles or none
+  bool have_tiles = true;
+  for (guint i = 0; i < level_array->len; i++) {
+    struct level *l = level_array->pdata[i];
+    have_tiles = have_tiles && l->tiffl.tiles;
+  }
+  for (guint i = 0; !have_tiles && i < level_array->len; i++) {
+    struct level *l = level_array->pdata[i];
+    l->tiffl.tiles = NULL;
+  }
+
+  // fill gaps in the pyramid by decoding JPEG or JP2K tiles at reduced
+  // scale
+  _openslide_jpeg_add_scaled_levels(osr, level_array,
+                                    create_scaled_level, tc);
+
   // read properties
   if (!_openslide_tiff_set_dir(ct.tiff, 0, err)) {
     return false;
@@ -55,7 +55,11 @@ struct dicom_level {
   int64_t tiles_across;
   int64_t tiles_down;
 
-  struct dicom_file *file;
+  // > 1 for a virtual level decoding another level's frames at reduced
+  // DCT scale
+  int32_t scale_denom;
+
+  struct dicom_file *file;  // owned unless scale_denom > 1
 };
 
 struct associated {
@@ -163,6 +167,7 @@ static void print_level(struct dicom_level *l) {
   debug("  grid = %p", l->grid);
   debug("  tiles_across = %" PRId64, l->tiles_across);
   debug("  tiles_down = %" PRId64, l->tiles_down);
+  debug("  scale_denom = %d", l->scale_denom);
 }
 
 static void print_frame(DcmFrame *frame G_GNUC_UNUSED) {
@@ -185,55 +190,95 @@ static void print_frame(DcmFrame *frame G_GNUC_UNUSED) {
         dcm_frame_get_transfer_syntax_uid(frame));
 }
 
+// libdicom file handle, reading through the shared file pool so idle
+// slides don't hold file descriptors
+struct dicom_io {
+  struct _openslide_shared_file *file;
+  int64_t offset;
+  int64_t size;
+};
+
 static void *dicom_openslide_vfs_open(DcmError **dcm_error, void *client) {
   const char *filename = (const char *) client;
 
+  g_autoptr(_openslide_shared_file) sf =
+    _openslide_shared_file_create(filename);
   GError *err = NULL;
-  struct _openslide_file *file = _openslide_fopen(filename, &err);
-  if (!file) {
+  g_auto(_openslide_pinned_file) pf = _openslide_shared_file_get(sf, &err);
+  if (!pf.file) {
+    gerror_propagate_error(dcm_error, err);
+    return NULL;
+  }
+  int64_t size = _openslide_fsize(pf.file, &err);
+  if (size == -1) {
     gerror_propagate_error(dcm_error, err);
     return NULL;
   }
+  _openslide_pinned_file_put(&pf);
 
-  return file;
+  struct dicom_io *io = g_new0(struct dicom_io, 1);
+  io->file = g_steal_pointer(&sf);
+  io->size = size;
+  return io;
 }
 
 static int dicom_openslide_vfs_close(DcmError **dcm_error G_GNUC_UNUSED,
                                      void *data) {
-  struct _openslide_file *file = (struct _openslide_file *) data;
-  _openslide_fclose(file);
+  struct dicom_io *io = data;
+  _openslide_shared_file_destroy(io->file);
+  g_free(io);
   return 0;
 }
 
-static int64_t dicom_openslide_vfs_read(DcmError **dcm_error G_GNUC_UNUSED,
+static int64_t dicom_openslide_vfs_read(DcmError **dcm_error,
                                         void *data,
                                         char *buffer,
                                         int64_t length) {
-  struct _openslide_file *file = (struct _openslide_file *) data;
+  struct dicom_io *io = data;
+
+  GError *err = NULL;
+  g_auto(_openslide_pinned_file) pf =
+    _openslide_shared_file_get(io->file, &err);
+  if (!pf.file) {
+    gerror_propagate_error(dcm_error, err);
+    return -1;
+  }
   // openslide VFS has no error return for read()
-  return _openslide_fread(file, buffer, length);
+  int64_t count = _openslide_fread_at(pf.file, io->offset, buffer, length);
+  io->offset += count;
+  return count;
 }
 
 static int64_t dicom_openslide_vfs_seek(DcmError **dcm_error,
                                         void *data,
                                         int64_t offset,
                                         int whence) {
-  struct _openslide_file *file = (struct _openslide_file *) data;
-
-  GError *err = NULL;
-  if (!_openslide_fseek(file, offset, whence, &err)) {
-    gerror_propagate_error(dcm_error, err);
+  struct dicom_io *io = data;
+
+  int64_t base;
+  switch (whence) {
+  case SEEK_SET:
+    base = 0;
+    break;
+  case SEEK_CUR:
+    base = io->offset;
+    break;
+  case SEEK_END:
+    base = io->size;
+    break;
+  default:
+    g_assert_not_reached();
+  }
+  if (base + offset < 0) {
+    dcm_error_set(dcm_error, DCM_ERROR_CODE_INVALID,
+                  "Seek failed", "Invalid offset");
     return -1;
   }
 
   // libdicom uses lseek(2) semantics, so it must always return the new file
   // pointer
-  off_t new_position = _openslide_ftell(file, &err);
-  if (new_position < 0) {
-    gerror_propagate_error(dcm_error, err);
-  }
-
-  return new_position;
+  io->offset = base + offset;
+  return io->offset;
 }
 
 static const DcmIO dicom_io_funcs = {
@@ -386,7 +431,7 @@ static struct dicom_file *dicom_file_new(const char *filename, GError **err) {
 
 static void level_destroy(struct dicom_level *l) {
   _openslide_grid_destroy(l->grid);
-  if (l->file) {
+  if (l->file && l->scale_denom == 1) {
     dicom_file_destroy(l->file);
   }
   g_free(l);
@@ -402,69 +447,81 @@ static void destroy(openslide_t *osr) {
   g_free(osr->levels);
 }
 
-static bool read_tile(openslide_t *osr,
-                      cairo_t *cr,
-                      struct _openslide_level *level,
-                      int64_t tile_col, int64_t tile_row,
-                      void *arg G_GNUC_UNUSED,
-                      GError **err) {
-  struct dicom_level *l = (struct dicom_level *) level;
+// decode a frame, or only the part covering crop
+static bool decode_frame(struct dicom_level *l,
+                         uint32_t *dest,
+                         int64_t tile_col, int64_t tile_row,
+                         const struct _openslide_tile_crop *crop,  // optional
+                         GError **err) {
+  uint32_t frame_number = 1 + tile_col + l->tiles_across * tile_row;
 
   debug("read_tile: tile_col = %" PRIu64 ", tile_row = %" PRIu64,
         tile_col, tile_row);
   debug("read_tile level:");
   print_level(l);
 
-  // cache
-  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
-  uint32_t *tiledata = _openslide_cache_get(osr->cache,
-                                            level, tile_col, tile_row,
-                                            &cache_entry);
-  if (!tiledata) {
-    g_autofree uint32_t *buf = g_malloc(l->base.tile_w * l->base.tile_h * 4);
-    uint32_t frame_number = 1 + tile_col + l->tiles_across * tile_row;
+  g_mutex_lock(&l->file->lock);
+  DcmError *dcm_error = NULL;
+  g_autoptr(DcmFrame) frame = dcm_filehandle_read_frame(&dcm_error,
+                                                        l->file->filehandle,
+                                                        l->file->metadata,
+                                                        l->file->bot,
+                                                        frame_number);
+  g_mutex_unlock(&l->file->lock);
 
-    g_mutex_lock(&l->file->lock);
-    DcmError *dcm_error = NULL;
-    g_autoptr(DcmFrame) frame = dcm_filehandle_read_frame(&dcm_error,
-                                                          l->file->filehandle,
-                                                          l->file->metadata,
-                                                          l->file->bot,
-                                                          frame_number);
-    g_mutex_unlock(&l->file->lock);
-
-    if (frame == NULL) {
-      dicom_propagate_error(err, dcm_error);
-      return false;
-    }
+  if (frame == NULL) {
+    dicom_propagate_error(err, dcm_error);
+    return false;
+  }
 
-    const char *frame_value = dcm_frame_get_value(frame);
-    uint32_t frame_length = dcm_frame_get_length(frame);
-    uint32_t tile_width = dcm_frame_get_columns(frame);
-    uint32_t tile_height = dcm_frame_get_rows(frame);
-    if (tile_width != l->base.tile_w || tile_height != l->base.tile_h) {
-      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                  "Unexpected tile size: %ux%u != %"PRId64"x%"PRId64,
-                  tile_width, tile_height, l->base.tile_w, l->base.tile_h);
-      return false;
-    }
+  const char *frame_value = dcm_frame_get_value(frame);
+  uint32_t frame_length = dcm_frame_get_length(frame);
+  uint32_t tile_width = dcm_frame_get_columns(frame);
+  uint32_t tile_height = dcm_frame_get_rows(frame);
+  if (tile_width != l->base.tile_w * l->scale_denom ||
+      tile_height != l->base.tile_h * l->scale_denom) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Unexpected tile size: %ux%u != %"PRId64"x%"PRId64,
+                tile_width, tile_height,
+                l->base.tile_w * l->scale_denom,
+                l->base.tile_h * l->scale_denom);
+    return false;
+  }
 
-    print_frame(frame);
+  print_frame(frame);
 
-    if (!_openslide_jpeg_decode_buffer(frame_value, frame_length,
-                                       buf,
-                                       l->base.tile_w, l->base.tile_h,
-                                       err)) {
-      return false;
-    }
+  if (!_openslide_jpeg_decode_buffer_cropped(frame_value, frame_length,
+                                             dest,
+                                             l->scale_denom,
+                                             l->base.tile_w, l->base.tile_h,
+                                             crop,
+                                             err)) {
+    return false;
+  }
 
-    // clip, if necessary
-    if (!_openslide_clip_tile(buf,
+  // clip, if necessary
+  return _openslide_clip_tile(dest,
                               l->base.tile_w, l->base.tile_h,
                               l->base.w - tile_col * l->base.tile_w,
                               l->base.h - tile_row * l->base.tile_h,
-                              err)) {
-      return false;
+                              err);
+}
+
+static uint32_t *read_native_tile(openslide_t *osr,
+                                  struct _openslide_level *level,
+                                  int64_t tile_col, int64_t tile_row,
+                                  struct _openslide_cache_entry **cache_entry,
+                                  GError **err) {
+  struct dicom_level *l = (struct dicom_level *) level;
+
+  // cache
+  uint32_t *tiledata = _openslide_cache_get(osr->cache,
+                                            level, tile_col, tile_row,
+                                            cache_entry);
+  if (!tiledata) {
+    g_autofree uint32_t *buf = g_malloc(l->base.tile_w * l->base.tile_h * 4);
+    if (!decode_frame(l, buf, tile_col, tile_row, NULL, err)) {
+      return NULL;
     }
 
     // put it in the cache
@@ -472,21 +529,92 @@ static bool read_tile(openslide_t *osr,
     _openslide_cache_put(osr->cache,
 			 level, tile_col, tile_row,
 			 tiledata, l->base.tile_w * l->base.tile_h * 4,
-			 &cache_entry);
+			 cache_entry);
+  }
+
+  return tiledata;
+}
+
+static bool decode_frame_crop(openslide_t *osr G_GNUC_UNUSED,
+                              struct _openslide_level *level,
+                              int64_t tile_col, int64_t tile_row,
+                              void *arg G_GNUC_UNUSED,
+                              uint32_t *dest,
+                              const struct _openslide_tile_crop *crop,
+                              GError **err) {
+  struct dicom_level *l = (struct dicom_level *) level;
+  return decode_frame(l, dest, tile_col, tile_row, crop, err);
+}
+
+static bool read_tile(openslide_t *osr,
+                      cairo_t *cr,
+                      struct _openslide_level *level,
+                      int64_t tile_col, int64_t tile_row,
+                      void *arg,
+                      GError **err) {
+  int64_t tw = level->tile_w;
+  int64_t th = level->tile_h;
+
+  // if the cache can't keep the tile, decode only the part being painted
+  bool painted;
+  if (!_openslide_grid_paint_tile_cropped(osr, cr, level, tile_col, tile_row,
+                                          arg, tw, th, decode_frame_crop,
+                                          &painted, err)) {
+    return false;
+  }
+  if (painted) {
+    return true;
+  }
+
+  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
+  uint32_t *tiledata = read_native_tile(osr, level, tile_col, tile_row,
+                                        &cache_entry, err);
+  if (!tiledata) {
+    return false;
   }
 
   // draw it
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                        CAIRO_FORMAT_ARGB32,
-                                        l->base.tile_w, l->base.tile_h,
-                                        l->base.tile_w * 4);
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  _openslide_grid_paint_tile(cr, tiledata, CAIRO_FORMAT_ARGB32, tw, th);
 
   return true;
 }
 
+static void *read_raw_tile(openslide_t *osr G_GNUC_UNUSED,
+                           struct _openslide_level *level,
+                           int64_t tile_col, int64_t tile_row,
+                           enum openslide_tile_codec *codec,
+                           size_t *len,
+                           GError **err) {
+  struct dicom_level *l = (struct dicom_level *) level;
+  uint32_t frame_number = 1 + tile_col + l->tiles_across * tile_row;
+
+  // virtual levels have no stored frames
+  if (l->scale_denom > 1) {
+    return NULL;
+  }
+
+  g_mutex_lock(&l->file->lock);
+  DcmError *dcm_error = NULL;
+  g_autoptr(DcmFrame) frame = dcm_filehandle_read_frame(&dcm_error,
+                                                        l->file->filehandle,
+                                                        l->file->metadata,
+                                                        l->file->bot,
+                                                        frame_number);
+  g_mutex_unlock(&l->file->lock);
+
+  if (frame == NULL) {
+    dicom_propagate_error(err, dcm_error);
+    return NULL;
+  }
+
+  // we only open baseline JPEG, and each frame is a complete image
+  uint32_t frame_length = dcm_frame_get_length(frame);
+  void *buf = g_memdup(dcm_frame_get_value(frame), frame_length);
+  *codec = OPENSLIDE_TILE_CODEC_JPEG;
+  *len = frame_length;
+  return buf;
+}
+
 static bool paint_region(openslide_t *osr G_GNUC_UNUSED,
                          cairo_t *cr,
                          int64_t x, int64_t y,
@@ -509,6 +637,8 @@ static bool paint_region(openslide_t *osr G_GNUC_UNUSED,
 
 static const struct _openslide_ops dicom_ops = {
   .paint_region = paint_region,
+  .read_tile = read_native_tile,
+  .read_raw_tile = read_raw_tile,
   .destroy = destroy,
 };
 
@@ -634,6 +764,7 @@ static bool add_level(openslide_t *osr,
                       struct dicom_file *f,
                       GError **err) {
   g_autoptr(dicom_level) l = g_new0(struct dicom_level, 1);
+  l->scale_denom = 1;
   l->file = f;
 
   // dimensions
@@ -659,6 +790,35 @@ static bool add_level(openslide_t *osr,
   return true;
 }
 
+static struct _openslide_level *create_scaled_level(openslide_t *osr,
+                                                    struct _openslide_level *parent,
+                                                    int32_t scale_denom,
+                                                    void *ctx G_GNUC_UNUSED) {
+  struct dicom_level *parent_l = (struct dicom_level *) parent;
+
+  // libjpeg scales whole frames, so their sizes must divide evenly
+  if (parent_l->scale_denom > 1 ||
+      parent->tile_w % scale_denom ||
+      parent->tile_h % scale_denom) {
+    return NULL;
+  }
+
+  struct dicom_level *l = g_new0(struct dicom_level, 1);
+  l->scale_denom = scale_denom;
+  l->file = parent_l->file;
+  l->base.w = parent->w / scale_denom;
+  l->base.h = parent->h / scale_denom;
+  l->base.tile_w = parent->tile_w / scale_denom;
+  l->base.tile_h = parent->tile_h / scale_denom;
+  l->tiles_across = parent_l->tiles_across;
+  l->tiles_down = parent_l->tiles_down;
+  l->grid = _openslide_grid_create_simple(osr,
+                                          l->tiles_across, l->tiles_down,
+                                          l->base.tile_w, l->base.tile_h,
+                                          read_tile);
+  return (struct _openslide_level *) l;
+}
+
 // unconditionally takes ownership of dicom_file
 static bool maybe_add_file(openslide_t *osr,
                            GPtrArray *level_array,
@@ -802,6 +962,10 @@ static bool dicom_open(openslide_t *osr,
   // sort levels by width
   g_ptr_array_sort(level_array, compare_level_width);
 
+  // fill gaps in the pyramid by decoding JPEG frames at reduced scale
+  _openslide_jpeg_add_scaled_levels(osr, level_array,
+                                    create_scaled_level, NULL);
+
   debug("found levels:");
   for (guint i = 0; i < level_array->len; i++) {
     struct dicom_level *l = (struct dicom_level *) level_array->pdata[i];
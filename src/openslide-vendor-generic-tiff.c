@@ -28,6 +28,7 @@
  */
 
 #include "openslide-private.h"
+#include "openslide-decode-jpeg.h"
 #include "openslide-decode-tiff.h"
 #include "openslide-decode-tifflike.h"
 
@@ -65,58 +66,127 @@ static void destroy(openslide_t *osr) {
   g_free(osr->levels);
 }
 
-static bool read_tile(openslide_t *osr,
-                      cairo_t *cr,
-                      struct _openslide_level *level,
-                      int64_t tile_col, int64_t tile_row,
-                      void *arg,
-                      GError **err) {
+static uint32_t *get_tile(openslide_t *osr,
+                          struct _openslide_level *level,
+                          int64_t tile_col, int64_t tile_row,
+                          TIFF *tiff,
+                          struct _openslide_cache_entry **cache_entry,
+                          GError **err) {
   struct level *l = (struct level *) level;
   struct _openslide_tiff_level *tiffl = &l->tiffl;
-  TIFF *tiff = arg;
 
   // tile size
   int64_t tw = tiffl->tile_w;
   int64_t th = tiffl->tile_h;
 
   // cache
-  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
   uint32_t *tiledata = _openslide_cache_get(osr->cache,
                                             level, tile_col, tile_row,
-                                            &cache_entry);
+                                            cache_entry);
   if (!tiledata) {
     g_autofree uint32_t *buf = g_malloc(tw * th * 4);
     if (!_openslide_tiff_read_tile(tiffl, tiff,
                                    buf, tile_col, tile_row,
                                    err)) {
-      return false;
+      return NULL;
     }
 
     // clip, if necessary
     if (!_openslide_tiff_clip_tile(tiffl, buf,
                                    tile_col, tile_row,
                                    err)) {
-      return false;
+      return NULL;
     }
 
     // put it in the cache
     tiledata = g_steal_pointer(&buf);
     _openslide_cache_put(osr->cache, level, tile_col, tile_row,
                          tiledata, tw * th * 4,
-                         &cache_entry);
+                         cache_entry);
+  }
+  return tiledata;
+}
+
+static bool decode_tile_crop(openslide_t *osr G_GNUC_UNUSED,
+                             struct _openslide_level *level,
+                             int64_t tile_col, int64_t tile_row,
+                             void *arg,
+                             uint32_t *dest,
+                             const struct _openslide_tile_crop *crop,
+                             GError **err) {
+  struct level *l = (struct level *) level;
+  return _openslide_tiff_read_tile_cropped(&l->tiffl, arg, dest,
+                                           tile_col, tile_row, crop, err) &&
+         _openslide_tiff_clip_tile(&l->tiffl, dest, tile_col, tile_row, err);
+}
+
+static bool read_tile(openslide_t *osr,
+                      cairo_t *cr,
+                      struct _openslide_level *level,
+                      int64_t tile_col, int64_t tile_row,
+                      void *arg,
+                      GError **err) {
+  struct level *l = (struct level *) level;
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+  int64_t tw = tiffl->tile_w;
+  int64_t th = tiffl->tile_h;
+
+  // if the cache can't keep the tile, decode only the part being painted
+  bool painted;
+  if (!_openslide_grid_paint_tile_cropped(osr, cr, level, tile_col, tile_row,
+                                          arg, tw, th, decode_tile_crop,
+                                          &painted, err)) {
+    return false;
+  }
+  if (painted) {
+    return true;
+  }
+
+  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
+  uint32_t *tiledata = get_tile(osr, level, tile_col, tile_row, arg,
+                                &cache_entry, err);
+  if (!tiledata) {
+    return false;
   }
 
   // draw it
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                        CAIRO_FORMAT_ARGB32,
-                                        tw, th, tw * 4);
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  _openslide_grid_paint_tile(cr, tiledata, CAIRO_FORMAT_ARGB32, tw, th);
 
   return true;
 }
 
+static uint32_t *read_native_tile(openslide_t *osr,
+                                  struct _openslide_level *level,
+                                  int64_t tile_col, int64_t tile_row,
+                                  struct _openslide_cache_entry **cache_entry,
+                                  GError **err) {
+  struct generic_tiff_ops_data *data = osr->data;
+  struct level *l = (struct level *) level;
+
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(data->tc, &l->tiffl, &ct, err)) {
+    return NULL;
+  }
+  return get_tile(osr, level, tile_col, tile_row, ct.tiff, cache_entry, err);
+}
+
+static void *read_raw_tile(openslide_t *osr,
+                           struct _openslide_level *level,
+                           int64_t tile_col, int64_t tile_row,
+                           enum openslide_tile_codec *codec,
+                           size_t *len,
+                           GError **err) {
+  struct generic_tiff_ops_data *data = osr->data;
+  struct level *l = (struct level *) level;
+
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(data->tc, &l->tiffl, &ct, err)) {
+    return NULL;
+  }
+  return _openslide_tiff_read_raw_tile(&l->tiffl, ct.tiff, tile_col, tile_row,
+                                       codec, len, err);
+}
+
 static bool paint_region(openslide_t *osr, cairo_t *cr,
                          int64_t x, int64_t y,
                          struct _openslide_level *level,
@@ -125,8 +195,8 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
   struct generic_tiff_ops_data *data = osr->data;
   struct level *l = (struct level *) level;
 
-  g_auto(_openslide_cached_tiff) ct = _openslide_tiffcache_get(data->tc, err);
-  if (ct.tiff == NULL) {
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(data->tc, &l->tiffl, &ct, err)) {
     return false;
   }
 
@@ -139,6 +209,8 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
 
 static const struct _openslide_ops generic_tiff_ops = {
   .paint_region = paint_region,
+  .read_tile = read_native_tile,
+  .read_raw_tile = read_raw_tile,
   .destroy = destroy,
 };
 
@@ -175,6 +247,33 @@ static int width_compare(gconstpointer a, gconstpointer b) {
   }
 }
 
+static struct _openslide_level *create_scaled_level(openslide_t *osr,
+                                                    struct _openslide_level *parent,
+                                                    int32_t scale_denom,
+                                                    void *ctx) {
+  struct _openslide_tiffcache *tc = ctx;
+  struct level *parent_l = (struct level *) parent;
+
+  g_autoptr(level) l = g_new0(struct level, 1);
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+  if (!_openslide_tiff_level_init_scaled(parent, &parent_l->tiffl,
+                                         scale_denom,
+                                         false,
+                                         (struct _openslide_level *) l,
+                                         tiffl)) {
+    return NULL;
+  }
+  l->grid = _openslide_grid_create_simple(osr,
+                                          tiffl->tiles_across,
+                                          tiffl->tiles_down,
+                                          tiffl->tile_w,
+                                          tiffl->tile_h,
+                                          read_tile);
+  _openslide_tiffcache_set_grid_worker_arg(tc, l->grid);
+  _openslide_tiffcache_set_grid_fetch(tc, tiffl, l->grid);
+  return (struct _openslide_level *) g_steal_pointer(&l);
+}
+
 static bool generic_tiff_open(openslide_t *osr,
                               const char *filename,
                               struct _openslide_tifflike *tl,
@@ -237,6 +336,11 @@ static bool generic_tiff_open(openslide_t *osr,
                                             tiffl->tile_w,
                                             tiffl->tile_h,
                                             read_tile);
+    _openslide_tiffcache_set_grid_worker_arg(tc, l->grid);
+    if (tiffl->tile_read_direct) {
+      _openslide_tiffcache_set_grid_fetch(tc, tiffl, l->grid);
+      _openslide_tiffcache_set_level_tiles(tc, tl, tiffl);
+    }
 
     // add to array
     g_ptr_array_add(level_array, g_steal_pointer(&l));
@@ -245,6 +349,10 @@ static bool generic_tiff_open(openslide_t *osr,
   // sort tiled levels
   g_ptr_array_sort(level_array, width_compare);
 
+  // fill gaps in the pyramid by decoding JPEG tiles at reduced scale
+  _openslide_jpeg_add_scaled_levels(osr, level_array,
+                                    create_scaled_level, tc);
+
   // set hash and properties
   struct level *top_level = level_array->pdata[level_array->len - 1];
   if (!_openslide_tifflike_init_properties_and_hash(osr, tl, quickhash1,
@@ -96,6 +96,7 @@ static const int KEY_FILE_MAX_SIZE = 64 << 10;
 
 struct jpeg {
   char *filename;
+  struct _openslide_shared_file *file;  // owned by the ops data
   int64_t start_in_file;
   int64_t end_in_file;
 
@@ -139,6 +140,7 @@ struct jpeg_setup {
 struct hamamatsu_jpeg_ops_data {
   int32_t jpeg_count;
   struct jpeg **all_jpegs;
+  GHashTable *files;  // filename -> struct _openslide_shared_file
 
   // thread stuff, for background search of restart markers
   int64_t restart_marker_last_used_time;
@@ -158,6 +160,7 @@ struct ngr_level {
   struct _openslide_grid *grid;
 
   char *filename;
+  struct _openslide_shared_file *file;
 
   int64_t start_in_file;
 
@@ -218,12 +221,8 @@ static bool jpeg_random_access_src(j_decompress_ptr cinfo,
 
   // read in the 2 parts
   //  g_debug("reading header from %"PRId64, header_start_position);
-  if (!_openslide_fseek(infile, header_start_position, SEEK_SET, err)) {
-    g_prefix_error(err, "Couldn't seek to header start: ");
-    return false;
-  }
-  if (_openslide_fread(infile, buffer, header_length) !=
-      (size_t) header_length) {
+  if (_openslide_fread_at(infile, header_start_position, buffer,
+                          header_length) != (size_t) header_length) {
     g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                 "Cannot read header in JPEG at %"PRId64,
                 header_start_position);
@@ -232,12 +231,8 @@ static bool jpeg_random_access_src(j_decompress_ptr cinfo,
 
   if (data_length) {
     //  g_debug("reading from %"PRId64, start_position);
-    if (!_openslide_fseek(infile, start_position, SEEK_SET, err)) {
-      g_prefix_error(err, "Couldn't seek to data start: ");
-      return false;
-    }
-    if (_openslide_fread(infile, buffer + header_length, data_length) !=
-        (size_t) data_length) {
+    if (_openslide_fread_at(infile, start_position, buffer + header_length,
+                            data_length) != (size_t) data_length) {
       g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                   "Cannot read data in JPEG at %"PRId64, start_position);
       return false;
@@ -398,33 +393,30 @@ static bool find_next_ff_marker(struct _openslide_file *f,
                                 uint8_t **buf,
                                 int buf_size,
                                 int64_t file_size,
+                                int64_t *file_pos,
                                 uint8_t *marker_byte,
                                 int64_t *after_marker_pos,
                                 int *bytes_in_buf,
                                 GError **err) {
   //g_debug("bytes_in_buf: %d", *bytes_in_buf);
-  int64_t file_pos = _openslide_ftell(f, err);
-  if (file_pos == -1) {
-    g_prefix_error(err, "Couldn't get file position: ");
-    return false;
-  }
   bool last_was_ff = false;
   while (true) {
     if (*bytes_in_buf == 0) {
       // fill buffer
       *buf = buf_start;
-      int bytes_to_read = MIN(buf_size, file_size - file_pos);
+      int bytes_to_read = MIN(buf_size, file_size - *file_pos);
 
       //g_debug("bytes_to_read: %d", bytes_to_read);
-      if (bytes_to_read == 0 ||
-          _openslide_fread(f, *buf, bytes_to_read) != (size_t) bytes_to_read) {
+      if (bytes_to_read <= 0 ||
+          _openslide_fread_at(f, *file_pos, *buf, bytes_to_read) !=
+          (size_t) bytes_to_read) {
         g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                     "Short read searching for JPEG marker at %"PRId64,
-                    file_pos);
+                    *file_pos);
         return false;
       }
 
-      file_pos += bytes_to_read;
+      *file_pos += bytes_to_read;
       *bytes_in_buf = bytes_to_read;
     }
 
@@ -434,7 +426,7 @@ static bool find_next_ff_marker(struct _openslide_file *f,
       *marker_byte = (*buf)[0];
       (*buf)++;
       (*bytes_in_buf)--;
-      *after_marker_pos = file_pos - *bytes_in_buf;
+      *after_marker_pos = *file_pos - *bytes_in_buf;
       return true;
     }
 
@@ -456,7 +448,7 @@ static bool find_next_ff_marker(struct _openslide_file *f,
 	(*bytes_in_buf)--;
 	(*buf)++;
 	*marker_byte = ff[1];
-	*after_marker_pos = file_pos - *bytes_in_buf;
+	*after_marker_pos = *file_pos - *bytes_in_buf;
 	return true;
       }
     }
@@ -482,13 +474,7 @@ static bool _compute_mcu_start(struct jpeg *jpeg,
     }
     if (offset != -1) {
       uint8_t buf[2];
-      if (!_openslide_fseek(f, offset - 2, SEEK_SET, err)) {
-        g_prefix_error(err, "Couldn't seek to recorded restart marker at "
-                       "%"PRId64": ", offset - 2);
-        return false;
-      }
-
-      if (_openslide_fread(f, buf, 2) != 2 ||
+      if (_openslide_fread_at(f, offset - 2, buf, 2) != 2 ||
           buf[0] != 0xFF || buf[1] < 0xD0 || buf[1] > 0xD7) {
         g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
                     "Restart marker not found at recorded position %"PRId64,
@@ -509,11 +495,7 @@ static bool _compute_mcu_start(struct jpeg *jpeg,
   //  g_debug("target: %"PRId64", first_good: %"PRId64, target, first_good);
 
   // now search for the new restart markers
-  if (!_openslide_fseek(f, jpeg->mcu_starts[first_good], SEEK_SET, err)) {
-    g_prefix_error(err, "Couldn't seek to first good restart marker: ");
-    return false;
-  }
-
+  int64_t file_pos = jpeg->mcu_starts[first_good];
   uint8_t buf_start[4096];
   uint8_t *buf = buf_start;
   int bytes_in_buf = 0;
@@ -522,6 +504,7 @@ static bool _compute_mcu_start(struct jpeg *jpeg,
     int64_t after_marker_pos;
     if (!find_next_ff_marker(f, buf_start, &buf, sizeof(buf_start),
                              jpeg->end_in_file,
+                             &file_pos,
                              &marker_byte,
                              &after_marker_pos,
                              &bytes_in_buf,
@@ -591,8 +574,9 @@ static bool read_from_jpeg(openslide_t *osr,
                            uint32_t *dest,
                            int32_t w, int32_t h,
                            GError **err) {
-  // open file
-  g_autoptr(_openslide_file) f = _openslide_fopen(jpeg->filename, err);
+  g_auto(_openslide_pinned_file) pf =
+    _openslide_shared_file_get(jpeg->file, err);
+  struct _openslide_file *f = pf.file;
   if (f == NULL) {
     return false;
   }
@@ -631,8 +615,7 @@ static bool read_from_jpeg(openslide_t *osr,
                   "Couldn't read JPEG header");
       return false;
     }
-    cinfo->scale_num = 1;
-    cinfo->scale_denom = scale_denom;
+    _openslide_jpeg_decompress_set_scale(dc, scale_denom);
     cinfo->image_width = jpeg->tile_width;  // cunning
     cinfo->image_height = jpeg->tile_height;
 
@@ -697,13 +680,7 @@ static bool read_jpeg_tile(openslide_t *osr,
   }
 
   // draw it
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                        CAIRO_FORMAT_RGB24,
-                                        tw, th, tw * 4);
-
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  _openslide_grid_paint_tile(cr, tiledata, CAIRO_FORMAT_RGB24, tw, th);
 
   return true;
 }
@@ -772,6 +749,9 @@ static void jpeg_do_destroy(openslide_t *osr) {
     jpeg_free(data->all_jpegs[i]);
   }
   g_free(data->all_jpegs);
+  if (data->files) {
+    g_hash_table_destroy(data->files);
+  }
 
   // levels
   for (int32_t i = 0; i < osr->level_count; i++) {
@@ -891,12 +871,12 @@ static bool verify_mcu_starts(int32_t num_jpegs, struct jpeg **jpegs,
 static gpointer restart_marker_thread_func(gpointer d) {
   openslide_t *osr = d;
   struct hamamatsu_jpeg_ops_data *data = osr->data;
+  g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+    _openslide_io_scope_enter(&osr->io_stats);
 
   int32_t current_jpeg = 0;
   int32_t current_mcu_start = 0;
 
-  g_autoptr(_openslide_file) current_file = NULL;
-
   GError *tmp_err = NULL;
 
   while(current_jpeg < data->jpeg_count) {
@@ -938,15 +918,15 @@ static gpointer restart_marker_thread_func(gpointer d) {
 
     struct jpeg *jp = data->all_jpegs[current_jpeg];
     if (jp->tile_count > 1) {
-      if (current_file == NULL) {
-	current_file = _openslide_fopen(jp->filename, &tmp_err);
-	if (current_file == NULL) {
-	  //g_debug("restart_marker_thread_func fopen failed");
-	  break;
-	}
+      g_auto(_openslide_pinned_file) pf =
+        _openslide_shared_file_get(jp->file, &tmp_err);
+      struct _openslide_file *f = pf.file;
+      if (f == NULL) {
+        //g_debug("restart_marker_thread_func fopen failed");
+        break;
       }
 
-      if (!compute_mcu_start(osr, jp, current_file, current_mcu_start,
+      if (!compute_mcu_start(osr, jp, f, current_mcu_start,
                              NULL, NULL, &tmp_err)) {
         //g_debug("restart_marker_thread_func compute_mcu_start failed");
         break;
@@ -956,7 +936,6 @@ static gpointer restart_marker_thread_func(gpointer d) {
       if (current_mcu_start >= jp->tile_count) {
 	current_mcu_start = 0;
 	current_jpeg++;
-	_openslide_fclose(g_steal_pointer(&current_file));
       }
     } else {
       current_jpeg++;
@@ -1275,6 +1254,19 @@ static bool init_jpeg_ops(openslide_t *_osr,
     g_ptr_array_free(g_steal_pointer(&setup->jpegs), false);
   osr->data = data;
 
+  // share one long-lived file among all JPEGs stored in it
+  data->files =
+    g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                          (GDestroyNotify) _openslide_shared_file_destroy);
+  for (int32_t i = 0; i < data->jpeg_count; i++) {
+    struct jpeg *jp = data->all_jpegs[i];
+    jp->file = g_hash_table_lookup(data->files, jp->filename);
+    if (!jp->file) {
+      jp->file = _openslide_shared_file_create(jp->filename);
+      g_hash_table_insert(data->files, g_strdup(jp->filename), jp->file);
+    }
+  }
+
   // create scale_denom levels
   create_scaled_jpeg_levels(osr, setup->levels);
 
@@ -1515,6 +1507,9 @@ static bool hamamatsu_vms_part2(openslide_t *osr,
 }
 
 static void ngr_level_free(struct ngr_level *l) {
+  if (l->file) {
+    _openslide_shared_file_destroy(l->file);
+  }
   g_free(l->filename);
   _openslide_grid_destroy(l->grid);
   g_free(l);
@@ -1545,7 +1540,9 @@ static bool ngr_read_tile(openslide_t *osr,
 
   if (!tiledata) {
     // read the tile data
-    g_autoptr(_openslide_file) f = _openslide_fopen(l->filename, err);
+    g_auto(_openslide_pinned_file) pf =
+      _openslide_shared_file_get(l->file, err);
+    struct _openslide_file *f = pf.file;
     if (!f) {
       return false;
     }
@@ -1554,19 +1551,23 @@ static bool ngr_read_tile(openslide_t *osr,
     int64_t offset = l->start_in_file +
       (tile_y * NGR_TILE_HEIGHT * l->column_width * 6) +
       (tile_x * l->base.h * l->column_width * 6);
-    //g_debug("tile_x: %"PRId64", tile_y: %"PRId64", seeking to %"PRId64, tile_x, tile_y, offset);
-    if (!_openslide_fseek(f, offset, SEEK_SET, err)) {
-      g_prefix_error(err, "Couldn't seek to tile offset: ");
-      return false;
-    }
+    //g_debug("tile_x: %"PRId64", tile_y: %"PRId64", reading at %"PRId64, tile_x, tile_y, offset);
 
-    // alloc and read
+    // use the mapped file if possible and aligned, otherwise alloc and read
     uint64_t len = tw * th * 6;
-    g_autofree uint16_t *buf = g_malloc(len);
-    if (_openslide_fread(f, buf, len) != len) {
-      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                  "Cannot read file %s", l->filename);
-      return false;
+    g_autofree uint16_t *alloc_buf = NULL;
+    const uint16_t *buf = NULL;
+    if (offset % 2 == 0) {
+      buf = _openslide_fmap(f, offset, len);
+    }
+    if (!buf) {
+      alloc_buf = g_malloc(len);
+      if (_openslide_fread_at(f, offset, alloc_buf, len) != len) {
+        g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                    "Cannot read file %s", l->filename);
+        return false;
+      }
+      buf = alloc_buf;
     }
 
     // got the data, now convert to 8-bit xRGB
@@ -1588,12 +1589,7 @@ static bool ngr_read_tile(openslide_t *osr,
   }
 
   // draw it
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                         CAIRO_FORMAT_RGB24,
-                                         tw, th, tw * 4);
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  _openslide_grid_paint_tile(cr, tiledata, CAIRO_FORMAT_RGB24, tw, th);
 
   return true;
 }
@@ -1643,6 +1639,7 @@ static bool hamamatsu_vmu_part2(openslide_t *osr,
     g_ptr_array_add(level_array, l);
 
     l->filename = g_strdup(image_filenames[i]);
+    l->file = _openslide_shared_file_create(l->filename);
 
     g_autoptr(_openslide_file) f = _openslide_fopen(l->filename, err);
     if (f == NULL) {
@@ -183,12 +183,7 @@ static bool read_tile(openslide_t *osr,
   }
 
   // draw it
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                        CAIRO_FORMAT_ARGB32,
-                                        tw, th, tw * 4);
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  _openslide_grid_paint_tile(cr, tiledata, CAIRO_FORMAT_ARGB32, tw, th);
 
   return true;
 }
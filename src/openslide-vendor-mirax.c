@@ -197,7 +197,8 @@ struct level {
 };
 
 struct mirax_ops_data {
-  gchar **datafile_paths;
+  struct _openslide_shared_file **datafiles;
+  int datafile_count;
 };
 
 static void image_unref(struct image *image) {
@@ -223,27 +224,60 @@ static uint32_t *read_image(openslide_t *osr,
   struct mirax_ops_data *data = osr->data;
   bool result = false;
 
+  g_auto(_openslide_pinned_file) pf =
+    _openslide_shared_file_get(data->datafiles[image->fileno], err);
+  struct _openslide_file *f = pf.file;
+  if (!f) {
+    return NULL;
+  }
+
   g_autofree uint32_t *dest = g_malloc(w * h * 4);
 
+  // decode straight from a memory-mapped file, if possible
+  const void *buf = _openslide_fmap(f, image->start_in_file, image->length);
+  if (buf) {
+    switch (format) {
+    case FORMAT_JPEG:
+      result = _openslide_jpeg_decode_buffer(buf, image->length,
+                                             dest, w, h,
+                                             err);
+      break;
+    case FORMAT_PNG:
+      result = _openslide_png_decode_buffer(buf, image->length,
+                                            dest, w, h,
+                                            err);
+      break;
+    case FORMAT_BMP:
+      result = _openslide_gdkpixbuf_decode_buffer("bmp", buf, image->length,
+                                                  dest, w, h,
+                                                  err);
+      break;
+    default:
+      g_assert_not_reached();
+    }
+    if (!result) {
+      return NULL;
+    }
+    return g_steal_pointer(&dest);
+  }
+
   switch (format) {
   case FORMAT_JPEG:
-    result = _openslide_jpeg_read(data->datafile_paths[image->fileno],
-                                  image->start_in_file,
-                                  dest, w, h,
-                                  err);
+    result = _openslide_jpeg_read_file(f, image->start_in_file,
+                                       dest, w, h,
+                                       err);
     break;
   case FORMAT_PNG:
-    result = _openslide_png_read(data->datafile_paths[image->fileno],
-                                 image->start_in_file,
-                                 dest, w, h,
-                                 err);
+    result = _openslide_png_read_file(f, image->start_in_file,
+                                      dest, w, h,
+                                      err);
     break;
   case FORMAT_BMP:
-    result = _openslide_gdkpixbuf_read("bmp",
-                                       data->datafile_paths[image->fileno],
-                                       image->start_in_file, image->length,
-                                       dest, w, h,
-                                       err);
+    result = _openslide_gdkpixbuf_read_file("bmp", f,
+                                            image->start_in_file,
+                                            image->length,
+                                            dest, w, h,
+                                            err);
     break;
   default:
     g_assert_not_reached();
@@ -355,7 +389,10 @@ static void destroy(openslide_t *osr) {
   g_free(osr->levels);
 
   // the ops data
-  g_strfreev(data->datafile_paths);
+  for (int i = 0; i < data->datafile_count; i++) {
+    _openslide_shared_file_destroy(data->datafiles[i]);
+  }
+  g_free(data->datafiles);
   g_free(data);
 }
 
@@ -1855,7 +1892,11 @@ static bool mirax_open(openslide_t *osr, const char *filename,
   // set private data
   g_assert(osr->data == NULL);
   struct mirax_ops_data *data = g_new0(struct mirax_ops_data, 1);
-  data->datafile_paths = g_steal_pointer(&datafile_paths);
+  data->datafiles = g_new(struct _openslide_shared_file *, datafile_count);
+  data->datafile_count = datafile_count;
+  for (int i = 0; i < datafile_count; i++) {
+    data->datafiles[i] = _openslide_shared_file_create(datafile_paths[i]);
+  }
   osr->data = data;
 
   // set ops
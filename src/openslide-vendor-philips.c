@@ -93,43 +93,41 @@ static void destroy(openslide_t *osr) {
   g_free(osr->levels);
 }
 
-static bool read_tile(openslide_t *osr,
-                      cairo_t *cr,
-                      struct _openslide_level *level,
-                      int64_t tile_col, int64_t tile_row,
-                      void *arg,
-                      GError **err) {
+// returns NULL without an error if the tile is missing
+static uint32_t *get_tile(openslide_t *osr,
+                          struct _openslide_level *level,
+                          int64_t tile_col, int64_t tile_row,
+                          TIFF *tiff,
+                          struct _openslide_cache_entry **cache_entry,
+                          GError **err) {
   struct level *l = (struct level *) level;
   struct _openslide_tiff_level *tiffl = &l->tiffl;
-  TIFF *tiff = arg;
 
   // tile size
   int64_t tw = tiffl->tile_w;
   int64_t th = tiffl->tile_h;
 
   // cache
-  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
   uint32_t *tiledata = _openslide_cache_get(osr->cache,
                                             level, tile_col, tile_row,
-                                            &cache_entry);
+                                            cache_entry);
   if (!tiledata) {
     // slides with multiple ROIs are sparse
     bool is_missing;
     if (!_openslide_tiff_check_missing_tile(tiffl, tiff,
                                             tile_col, tile_row,
                                             &is_missing, err)) {
-      return false;
+      return NULL;
     }
     if (is_missing) {
-      // nothing to draw
-      return true;
+      return NULL;
     }
 
     g_autofree uint32_t *buf = g_malloc(tw * th * 4);
     if (!_openslide_tiff_read_tile(tiffl, tiff,
                                    buf, tile_col, tile_row,
                                    err)) {
-      return false;
+      return NULL;
     }
 
     // clip, if necessary
@@ -138,27 +136,94 @@ static bool read_tile(openslide_t *osr,
                               l->base.w - tile_col * tw,
                               l->base.h - tile_row * th,
                               err)) {
-      return false;
+      return NULL;
     }
 
     // put it in the cache
     tiledata = g_steal_pointer(&buf);
     _openslide_cache_put(osr->cache, level, tile_col, tile_row,
                          tiledata, tw * th * 4,
-                         &cache_entry);
+                         cache_entry);
+  }
+  return tiledata;
+}
+
+static bool read_tile(openslide_t *osr,
+                      cairo_t *cr,
+                      struct _openslide_level *level,
+                      int64_t tile_col, int64_t tile_row,
+                      void *arg,
+                      GError **err) {
+  struct level *l = (struct level *) level;
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+
+  GError *tmp_err = NULL;
+  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
+  uint32_t *tiledata = get_tile(osr, level, tile_col, tile_row, arg,
+                                &cache_entry, &tmp_err);
+  if (!tiledata) {
+    if (tmp_err) {
+      g_propagate_error(err, tmp_err);
+      return false;
+    }
+    // missing tile; nothing to draw
+    return true;
   }
 
   // draw it
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                        CAIRO_FORMAT_ARGB32,
-                                        tw, th, tw * 4);
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  _openslide_grid_paint_tile(cr, tiledata, CAIRO_FORMAT_ARGB32,
+                             tiffl->tile_w, tiffl->tile_h);
 
   return true;
 }
 
+static uint32_t *read_native_tile(openslide_t *osr,
+                                  struct _openslide_level *level,
+                                  int64_t tile_col, int64_t tile_row,
+                                  struct _openslide_cache_entry **cache_entry,
+                                  GError **err) {
+  struct philips_ops_data *data = osr->data;
+  struct level *l = (struct level *) level;
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(data->tc, &l->tiffl, &ct, err)) {
+    return NULL;
+  }
+  GError *tmp_err = NULL;
+  uint32_t *tiledata = get_tile(osr, level, tile_col, tile_row, ct.tiff,
+                                cache_entry, &tmp_err);
+  if (!tiledata) {
+    if (tmp_err) {
+      g_propagate_error(err, tmp_err);
+      return NULL;
+    }
+    // missing tile is transparent
+    uint64_t size = tiffl->tile_w * tiffl->tile_h * 4;
+    tiledata = g_malloc0(size);
+    _openslide_cache_put(osr->cache, level, tile_col, tile_row,
+                         tiledata, size, cache_entry);
+  }
+  return tiledata;
+}
+
+static void *read_raw_tile(openslide_t *osr,
+                           struct _openslide_level *level,
+                           int64_t tile_col, int64_t tile_row,
+                           enum openslide_tile_codec *codec,
+                           size_t *len,
+                           GError **err) {
+  struct philips_ops_data *data = osr->data;
+  struct level *l = (struct level *) level;
+
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(data->tc, &l->tiffl, &ct, err)) {
+    return NULL;
+  }
+  return _openslide_tiff_read_raw_tile(&l->tiffl, ct.tiff, tile_col, tile_row,
+                                       codec, len, err);
+}
+
 static bool paint_region(openslide_t *osr, cairo_t *cr,
                          int64_t x, int64_t y,
                          struct _openslide_level *level,
@@ -167,8 +232,8 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
   struct philips_ops_data *data = osr->data;
   struct level *l = (struct level *) level;
 
-  g_auto(_openslide_cached_tiff) ct = _openslide_tiffcache_get(data->tc, err);
-  if (ct.tiff == NULL) {
+  g_auto(_openslide_cached_tiff) ct = {0};
+  if (!_openslide_tiffcache_get_for_level(data->tc, &l->tiffl, &ct, err)) {
     return false;
   }
 
@@ -181,6 +246,8 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
 
 static const struct _openslide_ops philips_ops = {
   .paint_region = paint_region,
+  .read_tile = read_native_tile,
+  .read_raw_tile = read_raw_tile,
   .destroy = destroy,
 };
 
@@ -504,6 +571,34 @@ static bool verify_main_image_count(xmlDoc *doc, GError **err) {
   return true;
 }
 
+static struct _openslide_level *create_scaled_level(openslide_t *osr,
+                                                    struct _openslide_level *parent,
+                                                    int32_t scale_denom,
+                                                    void *ctx) {
+  struct _openslide_tiffcache *tc = ctx;
+  struct level *parent_l = (struct level *) parent;
+
+  struct level *l = g_new0(struct level, 1);
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+  if (!_openslide_tiff_level_init_scaled(parent, &parent_l->tiffl,
+                                         scale_denom,
+                                         false,
+                                         (struct _openslide_level *) l,
+                                         tiffl)) {
+    g_free(l);
+    return NULL;
+  }
+  l->grid = _openslide_grid_create_simple(osr,
+                                          tiffl->tiles_across,
+                                          tiffl->tiles_down,
+                                          tiffl->tile_w,
+                                          tiffl->tile_h,
+                                          read_tile);
+  _openslide_tiffcache_set_grid_worker_arg(tc, l->grid);
+  _openslide_tiffcache_set_grid_fetch(tc, tiffl, l->grid);
+  return (struct _openslide_level *) l;
+}
+
 static bool philips_open(openslide_t *osr,
                          const char *filename,
                          struct _openslide_tifflike *tl,
@@ -584,6 +679,11 @@ static bool philips_open(openslide_t *osr,
                                               tiffl->tile_w,
                                               tiffl->tile_h,
                                               read_tile);
+      _openslide_tiffcache_set_grid_worker_arg(tc, l->grid);
+      if (tiffl->tile_read_direct) {
+        _openslide_tiffcache_set_grid_fetch(tc, tiffl, l->grid);
+        _openslide_tiffcache_set_level_tiles(tc, tl, tiffl);
+      }
 
       // verify that levels are sorted by size
       if (prev_l &&
@@ -621,6 +721,10 @@ static bool philips_open(openslide_t *osr,
     return false;
   }
 
+  // fill gaps in the pyramid by decoding JPEG tiles at reduced scale
+  _openslide_jpeg_add_scaled_levels(osr, level_array,
+                                    create_scaled_level, tc);
+
   // set hash and properties
   g_assert(level_array->len > 0);
   struct level *top_level = level_array->pdata[level_array->len - 1];
@@ -49,6 +49,9 @@
 struct level {
   struct _openslide_level base;
   struct _openslide_grid *grid;
+  // image items by tile column, followed by one missing tile
+  const struct synthetic_item **items;
+  int32_t item_count;
 };
 
 struct synthetic_item {
@@ -64,6 +67,34 @@ struct synthetic_item {
 
 static const struct synthetic_item **synthetic_items;
 
+// check that pixels from the centers of the R/G/B swatches of an image, or
+// the image decoded at reduced size, are reasonably close to pure colors
+static bool check_swatches(const uint32_t *pixels, int32_t size,
+                           const char *name, GError **err) {
+  uint32_t r = pixels[(size / 4) * size + size / 4];
+  uint32_t g = pixels[(size / 4) * size + 3 * size / 4];
+  uint32_t b = pixels[(3 * size / 4) * size + size / 4];
+  bool ok = true;
+  // these limits are uncomfortably loose, but some versions of the JPEG
+  // decoder are evidently this bad
+  const uint8_t HI = 0xb0;
+  const uint8_t LO = 0x50;
+  #define byte(v, n) ((v >> (8 * n)) & 0xff)
+  ok = ok && byte(r, 3) == 0xff && byte(g, 3) == 0xff && byte(b, 3) == 0xff;
+  ok = ok && byte(r, 2) > HI && byte(g, 1) > HI && byte(b, 0) > HI;
+  ok = ok && byte(r, 1) < LO && byte(r, 0) < LO;
+  ok = ok && byte(g, 2) < LO && byte(g, 0) < LO;
+  ok = ok && byte(b, 2) < LO && byte(b, 1) < LO;
+  #undef byte
+  if (!ok) {
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "Invalid image samples for %s: red %x, green %x, blue %x",
+                name, r, g, b);
+    return false;
+  }
+  return true;
+}
+
 static bool decode_bmp(const void *data, uint32_t len,
                        uint32_t *dest, GError **err) {
   return _openslide_gdkpixbuf_decode_buffer("bmp", data, len, dest,
@@ -72,8 +103,45 @@ static bool decode_bmp(const void *data, uint32_t len,
 
 static bool decode_j2k(const void *data, uint32_t len,
                         uint32_t *dest, GError **err) {
-  return _openslide_jp2k_decode_buffer(dest, IMAGE_PIXELS, IMAGE_PIXELS,
-                                       data, len, OPENSLIDE_JP2K_RGB, err);
+  if (!_openslide_jp2k_decode_buffer(dest, IMAGE_PIXELS, IMAGE_PIXELS,
+                                     data, len, OPENSLIDE_JP2K_RGB,
+                                     1, 1, NULL, err)) {
+    return false;
+  }
+  // also decode at reduced resolution, as for virtual levels, with
+  // intra-tile threads.  The decoder checks the dimensions.
+  uint32_t reduced[IMAGE_PIXELS * IMAGE_PIXELS / 4];
+  if (!_openslide_jp2k_decode_buffer(reduced,
+                                     IMAGE_PIXELS / 2, IMAGE_PIXELS / 2,
+                                     data, len, OPENSLIDE_JP2K_RGB,
+                                     2, 2, NULL, err) ||
+      !check_swatches(reduced, IMAGE_PIXELS / 2, "reduced j2k", err)) {
+    return false;
+  }
+  // and only the bottom right quarter, as for uncached tiles.  The area is
+  // aligned to the code blocks, so it should match exactly.
+  uint32_t cropped[IMAGE_PIXELS * IMAGE_PIXELS];
+  const struct _openslide_tile_crop crop = {
+    .x = IMAGE_PIXELS / 2,
+    .y = IMAGE_PIXELS / 2,
+    .w = IMAGE_PIXELS / 2,
+    .h = IMAGE_PIXELS / 2,
+  };
+  if (!_openslide_jp2k_decode_buffer(cropped, IMAGE_PIXELS, IMAGE_PIXELS,
+                                     data, len, OPENSLIDE_JP2K_RGB,
+                                     1, 1, &crop, err)) {
+    return false;
+  }
+  for (int32_t y = crop.y; y < crop.y + crop.h; y++) {
+    if (memcmp(dest + y * IMAGE_PIXELS + crop.x,
+               cropped + y * IMAGE_PIXELS + crop.x,
+               crop.w * 4)) {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "Cropped decode differs from full decode in row %d", y);
+      return false;
+    }
+  }
+  return true;
 }
 
 static bool decode_jpeg(const void *data, uint32_t len,
@@ -82,6 +150,61 @@ static bool decode_jpeg(const void *data, uint32_t len,
                                        IMAGE_PIXELS, IMAGE_PIXELS, err);
 }
 
+// decode a 48x48 JPEG whole and with a crop not aligned to iMCUs, and
+// compare the cropped pixels
+static bool decode_jpeg_crop(const void *data, uint32_t len,
+                             uint32_t *dest G_GNUC_UNUSED, GError **err) {
+  const int32_t w = 48;
+  const int32_t h = 48;
+  // ends on an iMCU boundary, where upsampling needs the next column
+  const struct _openslide_tile_crop crop = {
+    .x = 19,
+    .y = 9,
+    .w = 13,
+    .h = 20,
+  };
+  g_autofree uint32_t *full = g_malloc(w * h * 4);
+  if (!_openslide_jpeg_decode_buffer(data, len, full, w, h, err)) {
+    return false;
+  }
+  g_autofree uint32_t *cropped = g_malloc0(w * h * 4);
+  if (!_openslide_jpeg_decode_buffer_cropped(data, len, cropped, 1, w, h,
+                                             &crop, err)) {
+    return false;
+  }
+  for (int32_t y = crop.y; y < crop.y + crop.h; y++) {
+    if (memcmp(full + y * w + crop.x, cropped + y * w + crop.x,
+               crop.w * 4)) {
+      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                  "Cropped decode differs from full decode in row %d", y);
+      return false;
+    }
+  }
+  return true;
+}
+
+// decode a valid JPEG on this thread first, so that tables left behind in
+// a reused decompressor would hide the missing ones
+static bool decode_jpeg_notables(const void *data, uint32_t len,
+                                 uint32_t *dest, GError **err) {
+  for (const struct synthetic_item **item = synthetic_items;
+       (*item)->name != NULL;
+       item++) {
+    if (g_str_equal((*item)->name, "jpeg")) {
+      g_autofree void *valid =
+        _openslide_inflate_buffer((*item)->compressed_data,
+                                  (*item)->compressed_size,
+                                  (*item)->uncompressed_size, err);
+      if (!valid ||
+          !decode_jpeg(valid, (*item)->uncompressed_size, dest, err)) {
+        g_prefix_error(err, "Decoding valid JPEG: ");
+        return false;
+      }
+    }
+  }
+  return decode_jpeg(data, len, dest, err);
+}
+
 static bool decode_png(const void *data, uint32_t len,
                        uint32_t *dest, GError **err) {
   return _openslide_png_decode_buffer(data, len, dest,
@@ -188,6 +311,7 @@ static bool decode_xml(const void *data, uint32_t len,
 
 static void level_free(struct level *level) {
   _openslide_grid_destroy(level->grid);
+  g_free(level->items);
   g_free(level);
 }
 typedef struct level level;
@@ -218,68 +342,54 @@ static bool decode_item(const struct synthetic_item *item,
   } else if (!item->is_valid) {
     g_clear_error(err);
   }
-  if (item->is_valid && item->is_image) {
-    // check that pixels from the centers of the R/G/B swatches are reasonably
-    // close to pure colors
-    uint32_t r = dest[17 * IMAGE_PIXELS / 4];
-    uint32_t g = dest[19 * IMAGE_PIXELS / 4];
-    uint32_t b = dest[49 * IMAGE_PIXELS / 4];
-    bool ok = true;
-    // these limits are uncomfortably loose, but some versions of the JPEG
-    // decoder are evidently this bad
-    const uint8_t HI = 0xb0;
-    const uint8_t LO = 0x50;
-    #define byte(v, n) ((v >> (8 * n)) & 0xff)
-    ok = ok && byte(r, 3) == 0xff && byte(g, 3) == 0xff && byte(b, 3) == 0xff;
-    ok = ok && byte(r, 2) > HI && byte(g, 1) > HI && byte(b, 0) > HI;
-    ok = ok && byte(r, 1) < LO && byte(r, 0) < LO;
-    ok = ok && byte(g, 2) < LO && byte(g, 0) < LO;
-    ok = ok && byte(b, 2) < LO && byte(b, 1) < LO;
-    #undef byte
-    if (!ok) {
-      g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                  "Invalid image samples for %s: red %x, green %x, blue %x",
-                  item->name, r, g, b);
-      return false;
-    }
+  if (item->is_valid && item->is_image &&
+      !check_swatches(dest, IMAGE_PIXELS, item->name, err)) {
+    return false;
   }
   return true;
 }
 
-static bool read_tile(openslide_t *osr G_GNUC_UNUSED,
-                      cairo_t *cr,
-                      struct _openslide_level *level,
-                      int64_t tile_col, int64_t tile_row,
-                      void *tile,
-                      void *arg G_GNUC_UNUSED,
-                      GError **err) {
-  const struct synthetic_item *item = tile;
-
+static uint32_t *get_tile(openslide_t *osr,
+                          struct _openslide_level *level,
+                          const struct synthetic_item *item,
+                          int64_t tile_col, int64_t tile_row,
+                          struct _openslide_cache_entry **cache_entry,
+                          GError **err) {
   // cache
-  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
   uint32_t *tiledata = _openslide_cache_get(osr->cache,
                                             level, tile_col, tile_row,
-                                            &cache_entry);
+                                            cache_entry);
   if (!tiledata) {
     g_autofree uint32_t *buf = g_malloc(IMAGE_BUFSIZE);
     if (!decode_item(item, buf, err)) {
-      return false;
+      return NULL;
     }
 
     // put it in the cache
     tiledata = g_steal_pointer(&buf);
     _openslide_cache_put(osr->cache, level, tile_col, tile_row,
-                         tiledata, IMAGE_BUFSIZE, &cache_entry);
+                         tiledata, IMAGE_BUFSIZE, cache_entry);
+  }
+  return tiledata;
+}
+
+static bool read_tile(openslide_t *osr,
+                      cairo_t *cr,
+                      struct _openslide_level *level,
+                      int64_t tile_col, int64_t tile_row,
+                      void *tile,
+                      void *arg G_GNUC_UNUSED,
+                      GError **err) {
+  g_autoptr(_openslide_cache_entry) cache_entry = NULL;
+  uint32_t *tiledata = get_tile(osr, level, tile, tile_col, tile_row,
+                                &cache_entry, err);
+  if (!tiledata) {
+    return false;
   }
 
   // draw it
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                        CAIRO_FORMAT_ARGB32,
-                                        IMAGE_PIXELS, IMAGE_PIXELS,
-                                        IMAGE_PIXELS * 4);
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  _openslide_grid_paint_tile(cr, tiledata, CAIRO_FORMAT_ARGB32,
+                             IMAGE_PIXELS, IMAGE_PIXELS);
 
   return true;
 }
@@ -297,8 +407,28 @@ static bool paint_region(openslide_t *osr G_GNUC_UNUSED, cairo_t *cr,
                                       err);
 }
 
+static uint32_t *read_native_tile(openslide_t *osr,
+                                  struct _openslide_level *level,
+                                  int64_t tile_col, int64_t tile_row,
+                                  struct _openslide_cache_entry **cache_entry,
+                                  GError **err) {
+  struct level *l = (struct level *) level;
+  if (tile_col < l->item_count) {
+    return get_tile(osr, level, l->items[tile_col], tile_col, tile_row,
+                    cache_entry, err);
+  }
+  // the missing tile.  Like a backend that only finds out while decoding,
+  // look in the cache first, so the caller must give up the claim.
+  uint32_t *tiledata = _openslide_cache_get(osr->cache,
+                                            level, tile_col, tile_row,
+                                            cache_entry);
+  g_assert(tiledata == NULL);
+  return NULL;
+}
+
 static const struct _openslide_ops synthetic_ops = {
   .paint_region = paint_region,
+  .read_tile = read_native_tile,
   .destroy = destroy,
 };
 
@@ -333,6 +463,7 @@ static bool synthetic_open(openslide_t *osr,
                                    read_tile, NULL);
 
   g_autofree uint32_t *tiledata = g_malloc(IMAGE_BUFSIZE);
+  g_autoptr(GPtrArray) items = g_ptr_array_new();
   const struct synthetic_item *item;
   int i;
   int32_t count = 0;
@@ -359,6 +490,7 @@ static bool synthetic_open(openslide_t *osr,
       g_hash_table_insert(osr->properties,
                           g_strdup_printf("synthetic.image[%d]", count),
                           g_strdup(item->name));
+      g_ptr_array_add(items, (void *) item);
       count++;
     }
     _openslide_hash_string(quickhash1, item->name);
@@ -366,7 +498,11 @@ static bool synthetic_open(openslide_t *osr,
                          item->compressed_data, item->compressed_size);
   }
 
-  level->base.w = count * IMAGE_PIXELS;
+  level->items = (const struct synthetic_item **)
+    g_ptr_array_free(g_steal_pointer(&items), false);
+  level->item_count = count;
+  // leave a missing tile at the end
+  level->base.w = (count + 1) * IMAGE_PIXELS;
   level->base.h = IMAGE_PIXELS;
   level->base.tile_w = IMAGE_PIXELS;
   level->base.tile_h = IMAGE_PIXELS;
@@ -537,6 +673,325 @@ static const struct synthetic_item **synthetic_items = (const struct synthetic_i
        0x7f, 0x2f, 0x44, 0xdc,
     }
   },
+  &(const struct synthetic_item){
+    .name = "jpeg.crop.420",
+    .description = "Cropped 4:2:0 JPEG",
+    .is_valid = true,
+    .is_image = false,
+    .decode = decode_jpeg_crop,
+    .uncompressed_size = 1259,
+    .compressed_size = 1231,
+    .compressed_data = (const uint8_t[]){
+       0x78, 0xda, 0xfb, 0x7f, 0xe3, 0xff, 0x03, 0x06, 0x01, 0x2f, 0x37, 0x4f,
+       0x37, 0x06, 0x46, 0x46, 0x06, 0x06, 0x46, 0x20, 0x64, 0xf8, 0x7f, 0x9b,
+       0xc1, 0x99, 0x81, 0x83, 0x8d, 0x8d, 0x9d, 0x8d, 0x95, 0x83, 0x9d, 0x9d,
+       0x9d, 0x93, 0x93, 0x83, 0x8b, 0x47, 0x84, 0x97, 0x87, 0x9b, 0x9b, 0x47,
+       0x52, 0x48, 0x98, 0x5f, 0x44, 0x56, 0x4a, 0x5e, 0x4e, 0x56, 0x4a, 0x46,
+       0x46, 0x41, 0x45, 0x4f, 0x5d, 0x41, 0x49, 0x47, 0x59, 0x46, 0x46, 0xc3,
+       0x5c, 0x53, 0xc7, 0xc0, 0xd0, 0xc4, 0xc4, 0x44, 0x5e, 0xdd, 0xd2, 0xd6,
+       0xc2, 0xc8, 0x46, 0xcf, 0xd8, 0xc4, 0x08, 0x64, 0x08, 0x23, 0x27, 0x27,
+       0x27, 0x0f, 0x37, 0x8f, 0x04, 0x2f, 0xaf, 0x84, 0x91, 0xa2, 0x8c, 0xa2,
+       0x11, 0xc9, 0xe0, 0xff, 0x01, 0x06, 0x41, 0x0e, 0x06, 0x03, 0x06, 0x03,
+       0x66, 0x46, 0x25, 0x06, 0x26, 0x41, 0x46, 0x66, 0x41, 0xc6, 0xff, 0x47,
+       0x18, 0x24, 0x19, 0x18, 0x98, 0x19, 0x41, 0xae, 0x85, 0x03, 0x66, 0x16,
+       0x56, 0x26, 0x36, 0x76, 0xa0, 0x94, 0x99, 0x00, 0x03, 0x23, 0x13, 0x0b,
+       0x2b, 0x23, 0x1b, 0x33, 0x1b, 0x3b, 0x44, 0x8a, 0x51, 0x50, 0x88, 0x09,
+       0x28, 0xcd, 0xc0, 0x26, 0xac, 0x68, 0xe8, 0x28, 0xa2, 0xa4, 0x62, 0xe4,
+       0x1c, 0xa8, 0xec, 0x54, 0x28, 0x2a, 0x96, 0xd8, 0xd8, 0x3c, 0x51, 0x5c,
+       0xd5, 0xa5, 0x69, 0xd2, 0xc2, 0x8f, 0x40, 0x7d, 0xe2, 0x8c, 0x8c, 0xa8,
+       0x26, 0x32, 0xb0, 0xb0, 0xb2, 0x31, 0x03, 0x25, 0x8c, 0x04, 0x41, 0x06,
+       0xb2, 0x30, 0xb1, 0xf2, 0xc2, 0x24, 0x18, 0x99, 0x98, 0x19, 0x04, 0x85,
+       0x80, 0x86, 0x05, 0x26, 0x2a, 0x7d, 0x60, 0x31, 0x72, 0x0a, 0x6a, 0x14,
+       0x56, 0x36, 0x4e, 0x2a, 0x6c, 0x9a, 0xb8, 0x70, 0xd1, 0xc6, 0x83, 0x17,
+       0x1f, 0xfe, 0xbf, 0xc5, 0xc0, 0xc3, 0xcc, 0x08, 0x74, 0x2c, 0xb3, 0x20,
+       0x83, 0x3d, 0xc3, 0xa7, 0x53, 0xda, 0xa5, 0xbe, 0x3c, 0x3f, 0xb2, 0xb4,
+       0x9e, 0x66, 0x9e, 0x6c, 0x8c, 0x15, 0x6a, 0xea, 0x12, 0xc8, 0xb1, 0x17,
+       0x32, 0xf8, 0xf3, 0x33, 0x69, 0xcf, 0x81, 0x8c, 0x7f, 0xca, 0xa2, 0x7f,
+       0x05, 0x2b, 0x9e, 0xbf, 0x28, 0xdc, 0x19, 0x6e, 0x58, 0xd7, 0x11, 0xdd,
+       0x6a, 0xd7, 0x38, 0xf7, 0x95, 0xed, 0x89, 0xb9, 0xef, 0x04, 0xaa, 0x13,
+       0x27, 0x2b, 0xbf, 0x7b, 0xc4, 0xb1, 0xc7, 0x6d, 0xff, 0x37, 0xd3, 0xfd,
+       0xbb, 0x7e, 0x6e, 0x60, 0x10, 0x0d, 0x17, 0x78, 0x7c, 0x22, 0xf7, 0xcc,
+       0xe7, 0x5e, 0x77, 0xf7, 0x60, 0xcd, 0x94, 0x4d, 0x27, 0xd5, 0x17, 0x4f,
+       0x36, 0xd5, 0x78, 0xc4, 0xbb, 0x46, 0x47, 0x37, 0xe5, 0x9b, 0x9f, 0xda,
+       0xaf, 0x24, 0xb7, 0x29, 0x9d, 0x01, 0x27, 0xe7, 0x0a, 0xa7, 0x1d, 0x7e,
+       0xd6, 0x2a, 0x6a, 0xf5, 0xe5, 0xa0, 0x6a, 0xb0, 0xcf, 0x94, 0x58, 0x33,
+       0xb1, 0x43, 0x96, 0xda, 0x6d, 0x29, 0xb7, 0xce, 0x5e, 0x12, 0x8c, 0x51,
+       0xcb, 0xe4, 0xdc, 0xaf, 0x1c, 0xd3, 0xb9, 0xdd, 0xba, 0x3a, 0x61, 0x53,
+       0x96, 0xeb, 0x21, 0x45, 0x1f, 0xd5, 0xcc, 0x19, 0xff, 0xd2, 0xb5, 0xd4,
+       0xfe, 0xd4, 0x45, 0xbc, 0x6b, 0x5c, 0xde, 0x77, 0xd1, 0x93, 0xef, 0xdc,
+       0xac, 0x0d, 0xfe, 0xc1, 0x85, 0x53, 0xfe, 0x45, 0x39, 0x3c, 0x3d, 0x2d,
+       0x28, 0x3a, 0x7d, 0xff, 0x3e, 0xae, 0xcc, 0xbb, 0x42, 0xcb, 0x7e, 0x24,
+       0x9c, 0xf8, 0x6d, 0xcb, 0x12, 0x2f, 0xf8, 0x9f, 0x61, 0x92, 0xfa, 0xdf,
+       0xc3, 0x46, 0x2b, 0x7b, 0x5e, 0xb8, 0x5c, 0x88, 0x52, 0x7a, 0x31, 0xc3,
+       0x4b, 0xb7, 0x66, 0x51, 0x73, 0x7e, 0xdc, 0xd2, 0xa4, 0x44, 0xed, 0xa5,
+       0x7d, 0x5d, 0xc7, 0x73, 0xe6, 0x16, 0x2c, 0x98, 0xb8, 0x38, 0x58, 0x75,
+       0x4d, 0xef, 0x45, 0x97, 0x6e, 0x81, 0x96, 0x37, 0x9e, 0x32, 0xc2, 0x0d,
+       0xa9, 0x3f, 0xd3, 0x0d, 0x3b, 0x9f, 0x3d, 0xff, 0xf8, 0x45, 0x7a, 0xf9,
+       0x27, 0xd3, 0x53, 0xfb, 0x42, 0xbe, 0x49, 0xc4, 0x1d, 0x9f, 0xfe, 0x2e,
+       0xb2, 0xec, 0xa5, 0xda, 0xcb, 0xf2, 0x65, 0x6f, 0xae, 0x18, 0xc9, 0xae,
+       0x34, 0xfd, 0x70, 0xec, 0xba, 0x53, 0xa2, 0xb4, 0x93, 0xa7, 0xf5, 0x04,
+       0x8b, 0xa3, 0xd5, 0x4f, 0x36, 0xce, 0x3a, 0x6b, 0xb9, 0xb1, 0x62, 0xdf,
+       0x99, 0xb7, 0xf9, 0xbe, 0xeb, 0xdc, 0x7e, 0x5e, 0x0c, 0x5d, 0xde, 0x9f,
+       0xc3, 0xaa, 0x39, 0x9d, 0x35, 0xd4, 0x7f, 0xfb, 0xb2, 0xcb, 0xff, 0x9e,
+       0x4b, 0x3c, 0xbb, 0xb7, 0xba, 0x6f, 0x96, 0x7b, 0x71, 0xec, 0xd3, 0xfc,
+       0x6d, 0x81, 0x76, 0xfb, 0xd6, 0x2d, 0xba, 0x5a, 0x38, 0xdb, 0xd9, 0xd3,
+       0xd8, 0x6f, 0x5e, 0x90, 0x19, 0x5b, 0xc7, 0x44, 0x07, 0xf5, 0xe2, 0xfd,
+       0x2a, 0x8f, 0xee, 0xe6, 0xae, 0x9b, 0x77, 0xdb, 0xd5, 0x68, 0xd5, 0xac,
+       0xb8, 0x39, 0x37, 0x33, 0x6e, 0xcc, 0xf1, 0xd2, 0x64, 0x78, 0x53, 0xf6,
+       0xe0, 0xc1, 0xb7, 0x59, 0xbf, 0xa4, 0x55, 0xb7, 0xf9, 0xee, 0x7a, 0x6a,
+       0xed, 0xb4, 0xc9, 0xeb, 0x95, 0x77, 0x4a, 0xa0, 0xa9, 0x67, 0x47, 0x3e,
+       0x87, 0x72, 0x93, 0xd5, 0x43, 0xed, 0xd8, 0x79, 0xdb, 0xce, 0xc7, 0x6a,
+       0xed, 0x7a, 0xac, 0xec, 0x36, 0x2d, 0x68, 0x9f, 0x39, 0xc7, 0x44, 0x47,
+       0xe6, 0x04, 0xcf, 0x27, 0x3d, 0x8a, 0x4a, 0xd5, 0xde, 0xaf, 0xff, 0x9e,
+       0x3f, 0x2e, 0xb1, 0xe0, 0xf2, 0x9e, 0x97, 0x1b, 0x9a, 0xa2, 0x96, 0xce,
+       0x5e, 0x31, 0x2b, 0x6b, 0x9f, 0xda, 0x2c, 0xf3, 0x45, 0x5a, 0xeb, 0xe5,
+       0x1d, 0x7b, 0xcf, 0xf7, 0xa5, 0xaa, 0x86, 0x94, 0x7c, 0xea, 0x4e, 0x3d,
+       0xd0, 0x21, 0x58, 0xc9, 0x7d, 0xfd, 0x75, 0xbb, 0x9e, 0xd1, 0xd1, 0x2f,
+       0x27, 0xcd, 0xf6, 0x0b, 0x2e, 0xda, 0x35, 0x5f, 0x3b, 0x54, 0xf8, 0xcc,
+       0xbc, 0xe3, 0x7c, 0x17, 0xfc, 0x97, 0x6d, 0x0f, 0xf2, 0x5e, 0xb2, 0x66,
+       0xe6, 0xd2, 0x40, 0xdd, 0x78, 0x66, 0x4f, 0x57, 0x2d, 0x73, 0xe9, 0x02,
+       0x37, 0x81, 0x79, 0x5f, 0xf6, 0xde, 0x35, 0x7f, 0x92, 0xce, 0x9f, 0xfb,
+       0x32, 0x2e, 0x54, 0xd6, 0xde, 0xe6, 0xb5, 0xcc, 0x97, 0x35, 0x97, 0x8c,
+       0xcf, 0x38, 0xeb, 0x75, 0xc9, 0x1d, 0xc9, 0xb6, 0x5f, 0x71, 0xf5, 0x4a,
+       0xb2, 0xf5, 0xbf, 0xb0, 0xd6, 0xb0, 0xe5, 0xb6, 0x05, 0x27, 0x27, 0xfe,
+       0x31, 0x75, 0x14, 0xff, 0x2c, 0xbf, 0xc5, 0xde, 0xdd, 0xdf, 0xff, 0xcf,
+       0xd4, 0xf8, 0x1f, 0x85, 0xdd, 0x3b, 0x27, 0x6b, 0x45, 0x15, 0xb5, 0xc5,
+       0xaf, 0xda, 0x17, 0xa9, 0x69, 0xad, 0x7b, 0x6c, 0xea, 0xac, 0xe0, 0xad,
+       0xca, 0x33, 0xae, 0xbb, 0x29, 0x74, 0xef, 0x96, 0x54, 0xf8, 0x9e, 0xa4,
+       0x5c, 0x78, 0x5d, 0xf8, 0x93, 0xcf, 0xe6, 0xf9, 0xad, 0x99, 0x67, 0xe6,
+       0x59, 0x6f, 0xcc, 0x7c, 0x51, 0xe5, 0x53, 0x3d, 0xf7, 0x49, 0xd6, 0x6a,
+       0xc5, 0xa7, 0x15, 0x47, 0x9e, 0x4d, 0x39, 0x35, 0x53, 0xdf, 0x44, 0xf5,
+       0xe2, 0xf1, 0x48, 0xcb, 0xc9, 0xd9, 0xdd, 0xef, 0xe6, 0x5d, 0x38, 0x70,
+       0x3b, 0xa6, 0x49, 0x36, 0xe4, 0xd9, 0x66, 0xd3, 0x6c, 0xe6, 0xa9, 0x53,
+       0xfb, 0xf2, 0x5b, 0xe2, 0x8f, 0x86, 0xa7, 0x88, 0xc6, 0xb5, 0xcd, 0x5b,
+       0x1c, 0x7d, 0xe7, 0xb3, 0x46, 0x68, 0xd6, 0xc7, 0xeb, 0xac, 0x93, 0xeb,
+       0x24, 0xd7, 0x29, 0xa6, 0x89, 0xcc, 0x9d, 0x72, 0xe5, 0xd7, 0xad, 0xfe,
+       0xec, 0xea, 0x7f, 0x21, 0xdc, 0x4f, 0xfd, 0xaa, 0x1e, 0x7a, 0x7f, 0x7d,
+       0xf5, 0x74, 0xea, 0xfb, 0xab, 0x66, 0xd1, 0xae, 0xee, 0x69, 0x0b, 0x96,
+       0xe5, 0x4d, 0x59, 0x6b, 0x91, 0x9c, 0xbd, 0x50, 0x50, 0xf6, 0x11, 0xcb,
+       0xdc, 0x47, 0xea, 0xc5, 0xd7, 0x65, 0x73, 0x3f, 0xeb, 0x45, 0x6f, 0xba,
+       0x3a, 0x6d, 0xd1, 0xdb, 0xac, 0x65, 0x6f, 0xbe, 0x6e, 0x79, 0x7b, 0x79,
+       0xd6, 0x8f, 0xc5, 0xd9, 0x8b, 0x04, 0xe6, 0x2e, 0x52, 0x91, 0x5d, 0xa4,
+       0xdc, 0xa3, 0xc3, 0x95, 0xf1, 0x69, 0xfa, 0xea, 0x8b, 0xbf, 0x76, 0x78,
+       0xd5, 0x0b, 0xde, 0x3b, 0xf0, 0x63, 0xe7, 0xf6, 0x54, 0xcd, 0x47, 0x05,
+       0xdf, 0x8e, 0x14, 0x2b, 0xbf, 0xf3, 0xe2, 0xd8, 0x93, 0x9f, 0xfd, 0xd7,
+       0xcc, 0xf8, 0x7b, 0x68, 0xf9, 0xaf, 0xc3, 0x46, 0x6b, 0xd4, 0x0d, 0x9d,
+       0xf4, 0x0e, 0xd5, 0xa7, 0x8b, 0xca, 0x4d, 0x96, 0xbb, 0xf6, 0xbd, 0x32,
+       0x60, 0x8f, 0xbe, 0xc4, 0xbd, 0x90, 0x69, 0xc5, 0x0d, 0xab, 0xcc, 0xf7,
+       0x8b, 0xde, 0x8c, 0x5c, 0xfc, 0x72, 0xeb, 0xb9, 0xf2, 0x89, 0xa2, 0x51,
+       0x96, 0xdf, 0x0e, 0xe4, 0x5d, 0xd7, 0xba, 0xcd, 0x7a, 0xaf, 0x76, 0xdd,
+       0x5d, 0x6b, 0xa7, 0x49, 0xce, 0x25, 0x4f, 0x37, 0x49, 0x4c, 0xbc, 0xd0,
+       0xd1, 0xf7, 0x91, 0xa9, 0x52, 0x7d, 0x9d, 0x48, 0x8b, 0x45, 0x8c, 0xee,
+       0x92, 0x9f, 0x17, 0x3b, 0x4f, 0xf4, 0xa5, 0x4e, 0xe8, 0xf2, 0xd1, 0x3d,
+       0x6a, 0x11, 0x95, 0x71, 0xf2, 0x62, 0xe7, 0xa9, 0x98, 0xd3, 0x1a, 0xff,
+       0x6f, 0x02, 0x00, 0x85, 0x10, 0x05, 0xe9,
+    }
+  },
+  &(const struct synthetic_item){
+    .name = "jpeg.crop.444",
+    .description = "Cropped 4:4:4 JPEG",
+    .is_valid = true,
+    .is_image = false,
+    .decode = decode_jpeg_crop,
+    .uncompressed_size = 1732,
+    .compressed_size = 1710,
+    .compressed_data = (const uint8_t[]){
+       0x78, 0xda, 0x95, 0x8e, 0x7f, 0x3c, 0xd3, 0x89, 0x1f, 0xc7, 0x3f, 0xdb,
+       0xec, 0x17, 0xeb, 0xec, 0x97, 0xf2, 0xbb, 0x6c, 0x63, 0x86, 0x96, 0xcd,
+       0x4a, 0x4e, 0xa8, 0xcc, 0xf2, 0x33, 0x6d, 0xb8, 0xfa, 0x92, 0x3a, 0x51,
+       0xe1, 0x90, 0x4d, 0x11, 0x77, 0xdc, 0x49, 0xcd, 0x8f, 0xe2, 0xf2, 0xab,
+       0x43, 0xa7, 0x6b, 0x52, 0xf2, 0xdb, 0x21, 0x31, 0xbf, 0x4e, 0xe5, 0xf7,
+       0x8f, 0x30, 0xc7, 0x58, 0x7e, 0xb7, 0xfc, 0x48, 0x18, 0xbe, 0x95, 0x8e,
+       0x76, 0xbb, 0xc7, 0xdd, 0xe3, 0xfb, 0xf8, 0xfe, 0x7b, 0xaf, 0xf7, 0x9f,
+       0xaf, 0xd7, 0xfb, 0xf9, 0x78, 0xca, 0xc5, 0xf2, 0x29, 0x00, 0xed, 0xc8,
+       0x72, 0x60, 0x01, 0x20, 0x10, 0x00, 0x80, 0x14, 0x07, 0xc8, 0x25, 0x80,
+       0x2d, 0x80, 0x80, 0xc1, 0xe0, 0x30, 0x28, 0x02, 0x0e, 0x87, 0x23, 0x91,
+       0x08, 0x65, 0x14, 0x7e, 0x07, 0x4a, 0x45, 0x05, 0xa5, 0x81, 0xc5, 0xa9,
+       0xe2, 0x75, 0x34, 0x77, 0xeb, 0xea, 0x68, 0x6a, 0x6b, 0xef, 0x21, 0x51,
+       0xc9, 0x7b, 0x08, 0x26, 0x44, 0x6d, 0x6d, 0x43, 0x73, 0x8a, 0x89, 0x29,
+       0x8d, 0xc1, 0x60, 0xec, 0x26, 0x5b, 0x58, 0x1d, 0xa4, 0x1f, 0xa2, 0x9a,
+       0x31, 0xe8, 0x7f, 0x41, 0x40, 0x48, 0x24, 0x12, 0xa5, 0x82, 0x52, 0xdf,
+       0xb1, 0x43, 0x9d, 0xae, 0xa7, 0xad, 0x47, 0xff, 0xd7, 0x91, 0xff, 0x06,
+       0x60, 0x10, 0x80, 0x29, 0x60, 0x0a, 0x01, 0x61, 0x00, 0x30, 0x06, 0x04,
+       0xc1, 0x80, 0xe4, 0x2f, 0x00, 0x4d, 0x85, 0x24, 0x18, 0xa2, 0x10, 0xfd,
+       0x5f, 0x94, 0x20, 0x50, 0x10, 0x18, 0x06, 0x57, 0x74, 0x07, 0xd0, 0x00,
+       0x08, 0xac, 0x04, 0x05, 0xc1, 0x20, 0x30, 0xf8, 0xdf, 0x1d, 0x08, 0x83,
+       0x05, 0x43, 0x94, 0xa0, 0x00, 0x0c, 0xa7, 0x47, 0x3b, 0x82, 0x27, 0x90,
+       0xe8, 0xb6, 0x6c, 0xe2, 0x51, 0xae, 0xda, 0x4e, 0x9f, 0xd8, 0xb8, 0xd4,
+       0x5d, 0xfa, 0xcc, 0x6b, 0x69, 0x02, 0xd9, 0x5f, 0x4c, 0x10, 0x00, 0x01,
+       0x81, 0x40, 0xff, 0x07, 0x55, 0xfc, 0x80, 0x61, 0x20, 0x40, 0xd1, 0xd1,
+       0x30, 0x0a, 0x26, 0x14, 0x02, 0x86, 0x20, 0x40, 0xd0, 0x7f, 0x98, 0x10,
+       0x85, 0x8e, 0x12, 0x96, 0x86, 0xd7, 0x3b, 0x82, 0x63, 0x43, 0x09, 0xb1,
+       0x6a, 0x44, 0x92, 0xbe, 0x0f, 0x37, 0x55, 0x46, 0x37, 0x13, 0xfc, 0xda,
+       0xb2, 0x2a, 0x1f, 0x03, 0x50, 0x0a, 0x3d, 0x30, 0x46, 0xb1, 0xb2, 0x01,
+       0xd6, 0xba, 0x8c, 0xaf, 0xb8, 0xa0, 0x3e, 0x06, 0x1a, 0x49, 0x03, 0x3a,
+       0x63, 0xbd, 0xb1, 0xd7, 0x92, 0xd0, 0x41, 0x36, 0x58, 0x9a, 0xf5, 0x79,
+       0x12, 0xc7, 0xcb, 0x8f, 0x7a, 0xee, 0x03, 0xbf, 0x7f, 0xe8, 0x6a, 0x34,
+       0xf3, 0xc9, 0x7e, 0xba, 0x84, 0x54, 0x26, 0x6d, 0xe9, 0xd8, 0x13, 0x84,
+       0xb4, 0x30, 0xdd, 0x5c, 0x6b, 0x8d, 0xfc, 0x61, 0x60, 0x8b, 0x65, 0xfc,
+       0x89, 0x20, 0x7b, 0xd9, 0x3f, 0x3b, 0x14, 0xef, 0xf4, 0xe9, 0xee, 0xa1,
+       0xaf, 0x64, 0x50, 0x78, 0xa2, 0x38, 0xe0, 0xbb, 0xe1, 0x7a, 0xd9, 0x9d,
+       0xa0, 0xa7, 0xbe, 0xc8, 0xd4, 0x87, 0x04, 0x77, 0xfa, 0x45, 0xe6, 0x68,
+       0xc5, 0xa6, 0xc0, 0xee, 0x78, 0xa3, 0xa9, 0x93, 0x73, 0xdb, 0x02, 0x57,
+       0x95, 0xfd, 0x7b, 0x81, 0xe3, 0xad, 0xc7, 0x46, 0x9e, 0x3e, 0xa9, 0x1f,
+       0xf6, 0xbd, 0x70, 0x30, 0xca, 0xf1, 0xcb, 0x5b, 0xa8, 0xa8, 0xc1, 0x74,
+       0x9e, 0xd6, 0x68, 0x11, 0x1f, 0xa6, 0x70, 0xd8, 0xc8, 0x67, 0x49, 0x30,
+       0xb0, 0x1a, 0xf5, 0x54, 0x42, 0x49, 0xe3, 0xb6, 0xac, 0xc2, 0xb2, 0x15,
+       0x8a, 0x57, 0xa1, 0xa5, 0x87, 0x27, 0xba, 0x58, 0xe6, 0xb9, 0x4f, 0x42,
+       0x6f, 0x57, 0xc4, 0x15, 0xd0, 0xb0, 0xd5, 0x6e, 0x8e, 0x75, 0x37, 0x37,
+       0x8e, 0xbe, 0xa2, 0x6c, 0xa0, 0x56, 0xd8, 0xcb, 0xcc, 0x95, 0xd0, 0x38,
+       0x09, 0x76, 0x43, 0xe8, 0xf3, 0x7b, 0xc4, 0xa5, 0x21, 0x1e, 0xa4, 0xb5,
+       0xf1, 0x11, 0x83, 0xef, 0x15, 0x22, 0x9d, 0xd4, 0x9a, 0x8e, 0x0f, 0x59,
+       0x4d, 0x27, 0x2e, 0xcf, 0x20, 0x1a, 0x58, 0xcd, 0xef, 0xf7, 0x37, 0x0b,
+       0x37, 0x2b, 0x1c, 0xac, 0xf7, 0x69, 0x99, 0x97, 0x7d, 0xbd, 0xb0, 0x55,
+       0xec, 0xf3, 0xa6, 0x7e, 0xe0, 0xee, 0xfa, 0x84, 0x9a, 0xc1, 0x70, 0xc8,
+       0xed, 0xa4, 0x69, 0x33, 0x7b, 0x97, 0x4d, 0xcd, 0xd7, 0x2e, 0x75, 0x12,
+       0x89, 0xd6, 0xe2, 0x86, 0xab, 0x4b, 0xee, 0xfd, 0x69, 0x1d, 0xf6, 0xdb,
+       0x7a, 0x1b, 0x8d, 0xb6, 0xc9, 0x45, 0xfd, 0x74, 0x0e, 0x15, 0xa3, 0xec,
+       0x63, 0xec, 0xdc, 0xbe, 0x6e, 0xc1, 0x36, 0x9f, 0x5d, 0x6b, 0x11, 0x7a,
+       0xef, 0xb3, 0xac, 0xb7, 0x25, 0x14, 0x97, 0x99, 0x5c, 0xb8, 0xea, 0x90,
+       0xfa, 0x3e, 0x0a, 0xd1, 0x44, 0x94, 0x03, 0x24, 0xd7, 0x3f, 0x92, 0x3b,
+       0x57, 0xb8, 0x55, 0x47, 0x44, 0x6b, 0x41, 0x7a, 0xf4, 0xc2, 0x5b, 0xf3,
+       0xcc, 0x7e, 0x4f, 0xc2, 0x7c, 0x96, 0x44, 0x22, 0x8d, 0xbb, 0x51, 0x6a,
+       0x6a, 0xfc, 0x30, 0x25, 0xa9, 0x3d, 0x28, 0x37, 0xf4, 0x7e, 0xea, 0x03,
+       0x37, 0xfd, 0x92, 0xe4, 0x01, 0xe6, 0x4d, 0xf4, 0xf5, 0x25, 0x07, 0x6d,
+       0x5c, 0xc2, 0xd0, 0x13, 0x65, 0xf7, 0x22, 0xac, 0x7b, 0xad, 0x4d, 0x13,
+       0x31, 0xfb, 0x4c, 0xb6, 0x32, 0x33, 0xa9, 0xc3, 0x51, 0x84, 0xda, 0x45,
+       0xb6, 0xe4, 0x6d, 0x31, 0x35, 0x62, 0xfe, 0xd3, 0x73, 0x2e, 0xb2, 0x6e,
+       0x2b, 0x1a, 0xb6, 0xb0, 0x95, 0xcc, 0x2b, 0xcf, 0xb4, 0xe2, 0x6b, 0x15,
+       0x69, 0x3a, 0x45, 0x59, 0x5a, 0x47, 0xb6, 0x4f, 0x98, 0xb1, 0x04, 0xc5,
+       0x61, 0xec, 0x7a, 0xdf, 0x5b, 0xdb, 0x39, 0xb4, 0xb3, 0x27, 0xd9, 0x81,
+       0xb5, 0xbd, 0x82, 0xfc, 0xec, 0x02, 0x57, 0x8a, 0x16, 0x84, 0x69, 0x7f,
+       0x1f, 0x57, 0x37, 0x99, 0x16, 0xda, 0xfb, 0x25, 0x9d, 0x9a, 0xc5, 0x09,
+       0x7d, 0xdd, 0xd2, 0x25, 0xd2, 0xb7, 0x38, 0x7e, 0xf4, 0x37, 0xbb, 0xf1,
+       0xe0, 0xb2, 0x7b, 0x12, 0x3b, 0x7a, 0x51, 0xce, 0x99, 0x9f, 0x47, 0xfd,
+       0xc5, 0x3f, 0x3b, 0x52, 0x80, 0xa5, 0xf0, 0xa9, 0x29, 0x43, 0xe3, 0x2f,
+       0x45, 0x89, 0x64, 0x2a, 0xea, 0xc0, 0xde, 0x9f, 0x3e, 0xb6, 0xd5, 0x14,
+       0x5e, 0x58, 0x34, 0xc8, 0x29, 0x4f, 0x7c, 0x94, 0x3c, 0x9f, 0x54, 0xdc,
+       0xde, 0xef, 0xf3, 0x30, 0xde, 0xae, 0x64, 0x74, 0x6a, 0xdc, 0x96, 0x2a,
+       0x6b, 0xf8, 0xf8, 0x86, 0xe3, 0x71, 0xcc, 0xd5, 0xb0, 0xe6, 0x34, 0x22,
+       0x76, 0xd7, 0xed, 0xc6, 0x98, 0x5a, 0x3a, 0x07, 0x29, 0xc5, 0xb9, 0x64,
+       0x5d, 0x41, 0xea, 0x73, 0xd8, 0x8c, 0x81, 0xbe, 0x53, 0x6b, 0xdb, 0xdd,
+       0xd4, 0x71, 0xd2, 0x38, 0x75, 0x63, 0x3c, 0x87, 0x6f, 0xfb, 0xc4, 0xa0,
+       0x49, 0x7d, 0x6c, 0xde, 0x99, 0xe8, 0xef, 0x40, 0xe6, 0xc1, 0xd5, 0x59,
+       0x79, 0x85, 0x9a, 0xf9, 0x49, 0x86, 0xbb, 0xb2, 0xa6, 0x42, 0x68, 0xcd,
+       0x36, 0xf6, 0x53, 0x0b, 0x68, 0x4e, 0xf6, 0xe1, 0x3c, 0xc1, 0x0f, 0xdb,
+       0xdc, 0x9d, 0x1f, 0x3a, 0x7d, 0xf7, 0xe7, 0x84, 0x9d, 0x93, 0x45, 0x67,
+       0x8f, 0x4d, 0xdc, 0x3d, 0x9d, 0xbc, 0x9e, 0x57, 0xec, 0xaa, 0x2b, 0xd6,
+       0x41, 0x0f, 0x58, 0x17, 0x74, 0x87, 0x5b, 0xb4, 0x85, 0x6e, 0xcf, 0x24,
+       0x75, 0x29, 0xf3, 0x29, 0xcb, 0x03, 0xe7, 0x03, 0xca, 0x05, 0x95, 0x5e,
+       0x7e, 0x92, 0x32, 0xb7, 0x6a, 0x63, 0x52, 0x59, 0x7e, 0x8d, 0x1d, 0xce,
+       0x3d, 0x8b, 0xbf, 0x7a, 0xed, 0x20, 0xb1, 0xec, 0x90, 0x67, 0xae, 0xe3,
+       0x0d, 0xe5, 0xc7, 0xf1, 0x19, 0x53, 0x72, 0x20, 0xc4, 0xe7, 0x7a, 0x46,
+       0x0d, 0x9b, 0xd2, 0xa3, 0x3c, 0x72, 0xb1, 0xb4, 0x6a, 0xc4, 0xb1, 0xac,
+       0xb6, 0x63, 0xe0, 0x61, 0x46, 0x79, 0xf2, 0x33, 0xd2, 0x89, 0xc3, 0x62,
+       0x6c, 0x24, 0x51, 0xb5, 0x48, 0xf8, 0x4d, 0x87, 0x9b, 0x7d, 0x43, 0xfb,
+       0xe7, 0x37, 0x2a, 0xa4, 0x57, 0xa8, 0xd6, 0xdc, 0xb6, 0x53, 0x4d, 0xd9,
+       0x06, 0x23, 0x33, 0x8c, 0x93, 0x6e, 0xd2, 0xc0, 0xbc, 0xc8, 0x74, 0xf1,
+       0x2c, 0xe3, 0xb9, 0xf3, 0x76, 0xf0, 0x2f, 0xda, 0x72, 0x20, 0x21, 0x40,
+       0x0d, 0xec, 0x55, 0x58, 0xf5, 0xdc, 0x9f, 0x2c, 0xf2, 0x2a, 0xd4, 0x1f,
+       0xfc, 0xca, 0x79, 0xf0, 0xf1, 0x9d, 0xf2, 0xd8, 0xfc, 0xbc, 0x4c, 0xad,
+       0xe4, 0x5a, 0xa2, 0x6e, 0x5f, 0xc6, 0x62, 0xdf, 0x45, 0xe7, 0x83, 0xb4,
+       0xc2, 0x41, 0x76, 0x64, 0xb9, 0xfd, 0x41, 0xda, 0x4b, 0xc7, 0x5e, 0xe2,
+       0xa1, 0x17, 0xf4, 0x79, 0xc1, 0x12, 0xab, 0xea, 0x53, 0xb2, 0x37, 0xcb,
+       0xac, 0x59, 0xea, 0xef, 0x11, 0x18, 0x36, 0x82, 0xf8, 0xd6, 0x7c, 0xf4,
+       0x81, 0xc7, 0x95, 0xe1, 0xd5, 0xde, 0xdc, 0xca, 0xb9, 0x66, 0x7f, 0xa9,
+       0xdd, 0x85, 0xfc, 0xcb, 0xa3, 0xf7, 0xb0, 0x7e, 0xdf, 0xef, 0x38, 0x61,
+       0xb7, 0xd5, 0xfe, 0x4e, 0x75, 0x40, 0x24, 0x92, 0x03, 0xfa, 0x27, 0x3f,
+       0x6b, 0xfb, 0xf2, 0xbe, 0x9b, 0xd4, 0x75, 0xb2, 0xf2, 0x96, 0x03, 0x3a,
+       0xf7, 0x17, 0xfe, 0xc8, 0xe5, 0xaf, 0x20, 0x33, 0x33, 0x53, 0x2e, 0x5d,
+       0x3f, 0xdb, 0x7a, 0xd2, 0x4f, 0xed, 0x0c, 0xff, 0xde, 0x03, 0xaf, 0x57,
+       0xeb, 0x86, 0x1e, 0x81, 0xb2, 0x11, 0xa5, 0xe1, 0xf9, 0x2f, 0x72, 0x24,
+       0xa5, 0x52, 0x89, 0xe5, 0x6c, 0xcc, 0x6a, 0xe8, 0xa3, 0x15, 0x6c, 0x67,
+       0x33, 0x6a, 0x04, 0x5d, 0xa5, 0x7c, 0xbc, 0x2b, 0x30, 0x3a, 0xf8, 0xd8,
+       0x93, 0x46, 0x39, 0x60, 0x04, 0x5d, 0x2b, 0xb0, 0x0a, 0xf5, 0xde, 0x79,
+       0x73, 0x86, 0x2a, 0x9c, 0xd0, 0xa8, 0x7a, 0x3a, 0xd2, 0xc0, 0xb0, 0x12,
+       0x2f, 0x86, 0xdf, 0xd0, 0xd8, 0xcd, 0x3b, 0x61, 0x37, 0xfb, 0xed, 0xd9,
+       0x85, 0x5f, 0x7f, 0x11, 0x16, 0x37, 0x0f, 0x23, 0xc9, 0x3d, 0x5c, 0xe9,
+       0xd3, 0x11, 0x9b, 0x94, 0x7e, 0xbf, 0xcf, 0x66, 0x3e, 0x55, 0x51, 0x73,
+       0xb2, 0x31, 0x9c, 0xd1, 0xb3, 0x30, 0x3c, 0x61, 0x89, 0xfc, 0x9e, 0xcb,
+       0x5e, 0xa0, 0xbd, 0xbb, 0x14, 0x91, 0xa9, 0xf2, 0x4c, 0x96, 0xbc, 0x78,
+       0xb9, 0x69, 0x3a, 0xb7, 0xae, 0x2d, 0x22, 0xee, 0x47, 0xf4, 0x80, 0xee,
+       0x8d, 0xa7, 0xe6, 0xd4, 0xd1, 0xc9, 0xb7, 0x13, 0xc4, 0x9e, 0x6c, 0x8e,
+       0x28, 0x83, 0xbe, 0xed, 0xb1, 0xd6, 0xe9, 0x30, 0x1a, 0xc2, 0x28, 0x19,
+       0xcc, 0x2d, 0xd4, 0x6e, 0x13, 0xd2, 0x94, 0xbc, 0xc5, 0x9d, 0xf0, 0x7a,
+       0x8c, 0x56, 0x4a, 0x6d, 0xdc, 0xf4, 0x7f, 0xbb, 0x47, 0x86, 0x9c, 0x5c,
+       0xd8, 0xfb, 0x07, 0x9d, 0x97, 0xd5, 0x51, 0x60, 0x9e, 0xfa, 0xeb, 0x63,
+       0x94, 0xa0, 0x34, 0xf8, 0x6d, 0x5a, 0xd2, 0x56, 0xba, 0xc9, 0xdc, 0xb4,
+       0x67, 0x18, 0x39, 0x65, 0xc9, 0x33, 0x4a, 0x37, 0x5d, 0x77, 0x2e, 0x52,
+       0xb3, 0xa8, 0x23, 0xf2, 0x0c, 0xcd, 0xf6, 0x45, 0x7c, 0x95, 0xc9, 0x60,
+       0x64, 0x48, 0xc4, 0x1c, 0x6a, 0x34, 0xe6, 0x0d, 0xd2, 0x28, 0xde, 0x40,
+       0x25, 0xa6, 0xf1, 0x74, 0x65, 0xe3, 0xa7, 0x47, 0xdd, 0xfe, 0x8f, 0x97,
+       0x86, 0xf0, 0xbd, 0x83, 0x99, 0x05, 0xa8, 0xe0, 0xcb, 0x04, 0x62, 0xc3,
+       0xe1, 0xf4, 0x06, 0xe6, 0x72, 0xd4, 0xf4, 0x98, 0x26, 0xe3, 0x1b, 0xf4,
+       0x1d, 0x41, 0xe8, 0xba, 0xf3, 0x72, 0x84, 0xfa, 0xde, 0xe7, 0x28, 0x04,
+       0x17, 0x4d, 0xfe, 0xc2, 0xb7, 0xb4, 0xe9, 0x7c, 0x77, 0xb8, 0x67, 0xe5,
+       0x90, 0x77, 0xa9, 0xfb, 0xf8, 0xbd, 0x9a, 0x5c, 0x61, 0xd8, 0x59, 0x7c,
+       0xf0, 0xe5, 0xa3, 0xb8, 0x6a, 0x66, 0x5c, 0x35, 0x93, 0x7b, 0xdd, 0xbf,
+       0x68, 0xb8, 0xc4, 0xd3, 0x7d, 0xe7, 0x3e, 0x4a, 0x87, 0xf8, 0x6b, 0x1b,
+       0xad, 0xf6, 0xa1, 0xb7, 0x3d, 0x95, 0xb1, 0x16, 0xdd, 0x71, 0x90, 0xae,
+       0xb4, 0xbe, 0x50, 0x35, 0xd6, 0x87, 0x99, 0x7a, 0x63, 0x46, 0xf4, 0x81,
+       0xba, 0xbe, 0x35, 0x42, 0xf1, 0x31, 0x6b, 0x71, 0x78, 0xad, 0xff, 0x5e,
+       0xd1, 0xe6, 0xdf, 0x42, 0xab, 0xe3, 0x9e, 0xfc, 0x94, 0x41, 0x7e, 0xdf,
+       0x4a, 0x9f, 0xb5, 0x1c, 0xb8, 0xca, 0x7f, 0xc7, 0x2b, 0xad, 0xf0, 0x9e,
+       0x1b, 0x7b, 0x27, 0xaa, 0xa6, 0x90, 0xcc, 0x8f, 0x7b, 0xe9, 0x25, 0xea,
+       0x20, 0x12, 0x56, 0xd0, 0xe4, 0xb4, 0xa8, 0x69, 0xa1, 0xa3, 0xdf, 0x22,
+       0x5b, 0xc5, 0x48, 0xd7, 0xf7, 0x65, 0x31, 0x17, 0x3f, 0x1f, 0xc0, 0x2e,
+       0x61, 0x79, 0xfc, 0xa4, 0x4a, 0xeb, 0xe4, 0x99, 0x7a, 0x25, 0xc8, 0x47,
+       0xff, 0x04, 0x95, 0x65, 0xf6, 0xf0,
+    }
+  },
+  &(const struct synthetic_item){
+    .name = "jpeg.notables",
+    .description = "JPEG without quantization tables",
+    .is_valid = false,
+    .is_image = true,
+    .decode = decode_jpeg_notables,
+    .uncompressed_size = 597,
+    .compressed_size = 473,
+    .compressed_data = (const uint8_t[]){
+       0x78, 0xda, 0xfb, 0x7f, 0xe3, 0xff, 0x03, 0x06, 0x01, 0x2f, 0x37, 0x4f,
+       0x37, 0x06, 0x46, 0x46, 0x06, 0x06, 0x46, 0x20, 0x64, 0xf8, 0x7f, 0x80,
+       0x41, 0x90, 0x83, 0x41, 0x80, 0x41, 0x80, 0x99, 0x51, 0x89, 0x81, 0x49,
+       0x90, 0x91, 0x59, 0x90, 0xf1, 0xff, 0x11, 0x06, 0x79, 0xa0, 0x2c, 0x2b,
+       0x23, 0x18, 0x30, 0x40, 0x01, 0x23, 0x13, 0x33, 0x0b, 0x2b, 0x1b, 0x3b,
+       0x07, 0x27, 0x17, 0x37, 0x50, 0xc1, 0x56, 0x01, 0x06, 0x26, 0x46, 0x66,
+       0x66, 0x26, 0x16, 0x66, 0x56, 0x56, 0x16, 0x16, 0xa0, 0x6c, 0x2d, 0x50,
+       0x9e, 0x81, 0x45, 0x90, 0x55, 0x48, 0xd1, 0xd0, 0x91, 0x4d, 0x38, 0x30,
+       0x91, 0x5d, 0xa9, 0x50, 0xc4, 0xa8, 0x71, 0xe2, 0x42, 0x0e, 0x65, 0xa7,
+       0x8d, 0x07, 0x45, 0x83, 0x2e, 0x7e, 0x50, 0x31, 0x4e, 0x2a, 0x6a, 0xe2,
+       0xe4, 0x12, 0x13, 0x97, 0x90, 0x94, 0x52, 0x55, 0x53, 0xd7, 0xd0, 0xd4,
+       0x32, 0x31, 0x35, 0x33, 0xb7, 0xb0, 0xb4, 0x72, 0x76, 0x71, 0x75, 0x73,
+       0xf7, 0xf0, 0xf4, 0x0a, 0x0e, 0x09, 0x0d, 0x0b, 0x8f, 0x88, 0x8c, 0x4a,
+       0x4e, 0x49, 0x4d, 0x4b, 0xcf, 0xc8, 0xcc, 0x2a, 0x2e, 0x29, 0x2d, 0x2b,
+       0xaf, 0xa8, 0xac, 0x6a, 0x6e, 0x69, 0x6d, 0x6b, 0xef, 0xe8, 0xec, 0x9a,
+       0x34, 0x79, 0xca, 0xd4, 0x69, 0xd3, 0x67, 0xcc, 0x9c, 0xb5, 0x68, 0xf1,
+       0x92, 0xa5, 0xcb, 0x96, 0xaf, 0x58, 0xb9, 0x6a, 0xd3, 0xe6, 0x2d, 0x5b,
+       0xb7, 0x6d, 0xdf, 0xb1, 0x73, 0xd7, 0xa1, 0xc3, 0x47, 0x8e, 0x1e, 0x3b,
+       0x7e, 0xe2, 0xe4, 0xa9, 0x4b, 0x97, 0xaf, 0x5c, 0xbd, 0x76, 0xfd, 0xc6,
+       0xcd, 0x5b, 0x0f, 0x1f, 0x3d, 0x7e, 0xf2, 0xf4, 0xd9, 0xf3, 0x17, 0x2f,
+       0x5f, 0x7d, 0xfc, 0xf4, 0xf9, 0xcb, 0xd7, 0x6f, 0xdf, 0x7f, 0xfc, 0xfc,
+       0x05, 0xf2, 0x17, 0x23, 0x03, 0x33, 0x23, 0x0c, 0x60, 0xf5, 0x97, 0x20,
+       0xd0, 0x5f, 0x4c, 0x2c, 0x2c, 0xcc, 0x2c, 0xec, 0x20, 0x7f, 0x31, 0x32,
+       0x95, 0x83, 0x14, 0x08, 0xb2, 0xb0, 0x2a, 0x1a, 0xb2, 0x09, 0x39, 0x06,
+       0xb2, 0x27, 0x16, 0x0a, 0x2b, 0x19, 0x35, 0x72, 0x88, 0x38, 0x4d, 0x5c,
+       0xb8, 0xf1, 0x20, 0xa7, 0xb2, 0x71, 0xd0, 0x07, 0xd1, 0xa4, 0xa2, 0x8b,
+       0x5c, 0x62, 0x2a, 0x26, 0x0f, 0x55, 0x3f, 0x82, 0xbc, 0x06, 0xf6, 0x19,
+       0x71, 0x1e, 0x6b, 0x22, 0xcb, 0x67, 0x70, 0x8f, 0x21, 0xfc, 0x75, 0x97,
+       0x01, 0xe8, 0xd2, 0xff, 0xb7, 0x18, 0x78, 0x98, 0x19, 0x81, 0x51, 0xc8,
+       0x2c, 0xc8, 0x60, 0xcf, 0xf0, 0xf3, 0xd2, 0xbe, 0x63, 0xeb, 0x4f, 0x9f,
+       0xfa, 0x9b, 0xf8, 0x9f, 0xa1, 0x69, 0xe5, 0x1f, 0x96, 0xff, 0x0c, 0xad,
+       0x0f, 0xff, 0x33, 0x70, 0x1d, 0xfe, 0xa7, 0xbe, 0xff, 0xc6, 0xfe, 0x9b,
+       0xf5, 0xb7, 0xe6, 0x7f, 0x7a, 0xfe, 0xfc, 0xe7, 0xbe, 0xf4, 0x9b, 0xf6,
+       0x2f, 0x17, 0x3d, 0x96, 0x8b, 0xdf, 0x57, 0x7c, 0x5b, 0xa4, 0x62, 0xe6,
+       0x83, 0xf4, 0x5f, 0x3b, 0xbf, 0xda, 0xff, 0x08, 0xfa, 0x36, 0xef, 0xf2,
+       0xad, 0xfa, 0xd3, 0xeb, 0xa2, 0x8b, 0x3e, 0xd5, 0x5f, 0xbe, 0x5e, 0x7d,
+       0x27, 0xce, 0xe0, 0x59, 0xfd, 0x47, 0xa9, 0xba, 0x85, 0xef, 0x6a, 0x83,
+       0x5f, 0xcd, 0xbb, 0xbe, 0x7e, 0xeb, 0xf3, 0x6f, 0xfb, 0xce, 0x9f, 0x9a,
+       0xaf, 0xaf, 0xbf, 0xf9, 0xf3, 0xde, 0x5f, 0xd1, 0xf1, 0xff, 0x6f, 0x02,
+       0x00, 0xa4, 0x7c, 0xfa, 0x2f,
+    }
+  },
   &(const struct synthetic_item){
     .name = "jpeg.rgb",
     .description = "RGB JPEG",
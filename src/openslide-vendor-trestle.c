@@ -111,12 +111,7 @@ static bool read_tile(openslide_t *osr,
   }
 
   // draw it
-  g_autoptr(cairo_surface_t) surface =
-    cairo_image_surface_create_for_data((unsigned char *) tiledata,
-                                        CAIRO_FORMAT_ARGB32,
-                                        tw, th, tw * 4);
-  cairo_set_source_surface(cr, surface, 0, 0);
-  cairo_paint(cr);
+  _openslide_grid_paint_tile(cr, tiledata, CAIRO_FORMAT_ARGB32, tw, th);
 
   return true;
 }
@@ -342,6 +337,7 @@ static bool trestle_open(openslide_t *osr, const char *filename,
                                              tiffl->tile_w - overlap_x,
                                              tiffl->tile_h - overlap_y,
                                              read_tile, NULL);
+    _openslide_tiffcache_set_grid_worker_arg(tc, l->grid);
 
     // add tiles
     for (int64_t y = 0; y < tiffl->tiles_down; y++) {
@@ -29,6 +29,7 @@
  */
 
 #include "openslide-private.h"
+#include "openslide-decode-jpeg.h"
 #include "openslide-decode-tiff.h"
 #include "openslide-decode-tifflike.h"
 #include "openslide-decode-xml.h"
@@ -243,6 +244,27 @@ static bool read_subtile_tilemap(openslide_t *osr,
                       arg, err);
 }
 
+static void *read_raw_tile(openslide_t *osr,
+                           struct _openslide_level *level,
+                           int64_t tile_col, int64_t tile_row,
+                           enum openslide_tile_codec *codec,
+                           size_t *len,
+                           GError **err) {
+  struct ventana_ops_data *data = osr->data;
+  struct level *l = (struct level *) level;
+
+  // BIF levels have no tile size hints, so we're only called for
+  // Ventana TIFF, whose subtiles are whole tiles
+  g_assert(l->subtiles_per_tile == 1);
+
+  g_auto(_openslide_cached_tiff) ct = _openslide_tiffcache_get(data->tc, err);
+  if (ct.tiff == NULL) {
+    return NULL;
+  }
+  return _openslide_tiff_read_raw_tile(&l->tiffl, ct.tiff, tile_col, tile_row,
+                                       codec, len, err);
+}
+
 static bool paint_region(openslide_t *osr, cairo_t *cr,
                          int64_t x, int64_t y,
                          struct _openslide_level *level,
@@ -265,6 +287,7 @@ static bool paint_region(openslide_t *osr, cairo_t *cr,
 
 static const struct _openslide_ops ventana_ops = {
   .paint_region = paint_region,
+  .read_raw_tile = read_raw_tile,
   .destroy = destroy,
 };
 
@@ -725,6 +748,33 @@ static void set_region_props(openslide_t *osr, struct bif *bif,
   }
 }
 
+static struct _openslide_level *create_scaled_level(openslide_t *osr,
+                                                    struct _openslide_level *parent,
+                                                    int32_t scale_denom,
+                                                    void *ctx) {
+  struct _openslide_tiffcache *tc = ctx;
+  struct level *parent_l = (struct level *) parent;
+
+  struct level *l = g_new0(struct level, 1);
+  struct _openslide_tiff_level *tiffl = &l->tiffl;
+  if (!_openslide_tiff_level_init_scaled(parent, &parent_l->tiffl,
+                                         scale_denom,
+                                         false,
+                                         &l->base, tiffl)) {
+    g_free(l);
+    return NULL;
+  }
+  l->grid = _openslide_grid_create_simple(osr,
+                                          tiffl->tiles_across,
+                                          tiffl->tiles_down,
+                                          tiffl->tile_w,
+                                          tiffl->tile_h,
+                                          read_subtile);
+  l->subtiles_per_tile = 1;
+  _openslide_tiffcache_set_grid_worker_arg(tc, l->grid);
+  return &l->base;
+}
+
 static bool ventana_open(openslide_t *osr, const char *filename,
                          struct _openslide_tifflike *tl,
                          struct _openslide_hash *quickhash1, GError **err) {
@@ -875,6 +925,7 @@ static bool ventana_open(openslide_t *osr, const char *filename,
                                                 read_subtile);
         l->subtiles_per_tile = 1;
       }
+      _openslide_tiffcache_set_grid_worker_arg(tc, l->grid);
       //g_debug("level %"PRId64": magnification %g, downsample %g, size %"PRId64" %"PRId64, level, magnification, downsample, l->base.w, l->base.h);
 
       // verify consistent tile sizes
@@ -918,6 +969,11 @@ static bool ventana_open(openslide_t *osr, const char *filename,
   // set region properties
   if (bif) {
     set_region_props(osr, bif, level0);
+  } else {
+    // fill gaps in the pyramid by decoding JPEG tiles at reduced scale.
+    // BIF grids place tiles by AOI, so they can't simply be rescaled.
+    _openslide_jpeg_add_scaled_levels(osr, level_array,
+                                      create_scaled_level, tc);
   }
 
   // set hash and TIFF properties
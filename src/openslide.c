@@ -27,6 +27,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include <glib.h>
 #include <glib-object.h>
@@ -65,6 +66,16 @@ static void __attribute__((constructor)) _openslide_init(void) {
   xmlInitParser();
   // parse debug options
   _openslide_debug_init();
+  // parse decode thread count
+  _openslide_grid_init();
+  // parse mmap setting
+  _openslide_file_init();
+  // register VFS for in-memory and descriptor sources
+  _openslide_source_init();
+#ifdef HAVE_LIBCURL
+  // register http and https VFS
+  _openslide_http_init();
+#endif
   openslide_was_dynamically_loaded = true;
 }
 
@@ -242,6 +253,11 @@ static const char **strv_from_hashtable_keys(GHashTable *h) {
 openslide_t *openslide_open(const char *filename) {
   g_assert(openslide_was_dynamically_loaded);
 
+  // count detection I/O, before we have a handle to count it against
+  openslide_io_stats_t detect_io = {0};
+  g_auto(_openslide_io_scope) detect_scope G_GNUC_UNUSED =
+    _openslide_io_scope_enter(&detect_io);
+
   // detect format
   g_autoptr(_openslide_tifflike) tl = NULL;
   const struct _openslide_format *format = detect_format(filename, &tl);
@@ -252,6 +268,9 @@ openslide_t *openslide_open(const char *filename) {
 
   // alloc memory
   g_autoptr(openslide_t) osr = create_osr();
+  _openslide_io_stats_add(&osr->io_stats, &detect_io);
+  g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+    _openslide_io_scope_enter(&osr->io_stats);
 
   // refuse to run on unpatched pixman 0.38.x
   static GOnce pixman_once = G_ONCE_INIT;
@@ -354,12 +373,65 @@ openslide_t *openslide_open(const char *filename) {
 
   // start cache
   osr->cache = _openslide_cache_binding_create();
+  osr->prefetch = _openslide_prefetch_create();
+  osr->decode_threads = _openslide_grid_get_default_threads();
 
   return g_steal_pointer(&osr);
 }
 
 
+static openslide_t *open_source(struct _openslide_source *src) {
+  openslide_t *osr = openslide_open(_openslide_source_get_path(src));
+  if (!osr) {
+    _openslide_source_destroy(src);
+    return NULL;
+  }
+  osr->source = src;
+  return osr;
+}
+
+openslide_t *openslide_open_from_memory(const void *data, int64_t size,
+                                        const char *name,
+                                        openslide_resolve_fn resolve,
+                                        void *ctx) {
+  if (!data || size < 0) {
+    return NULL;
+  }
+  struct _openslide_source *src =
+    _openslide_source_create(name, -1, data, size, resolve, ctx, NULL);
+  return open_source(src);
+}
+
+openslide_t *openslide_open_from_fd(int fd, const char *name,
+                                    openslide_resolve_fn resolve,
+                                    void *ctx) {
+  // like a nonexistent path, a bad descriptor isn't a slide
+  struct _openslide_source *src =
+    _openslide_source_create(name, fd, NULL, -1, resolve, ctx, NULL);
+  if (!src) {
+    return NULL;
+  }
+  return open_source(src);
+}
+
 void openslide_close(openslide_t *osr) {
+  // stop background reads first
+  if (osr->prefetch) {
+    _openslide_prefetch_destroy(osr->prefetch);
+  }
+
+  if (_openslide_debug(OPENSLIDE_DEBUG_IO) && osr->ops) {
+    openslide_io_stats_t io;
+    _openslide_io_stats_get(&osr->io_stats, &io);
+    g_message("I/O for %s: %"PRIu64" opens, %"PRIu64" reads, "
+              "%"PRIu64" bytes, %"PRIu64" bytes merged but unused, "
+              "%"PRIu64" seeks spanning %"PRIu64" bytes, %.3f s reading",
+              openslide_get_property_value(osr,
+                                           OPENSLIDE_PROPERTY_NAME_VENDOR),
+              io.opens, io.reads, io.bytes_read, io.overread_bytes,
+              io.seeks, io.seek_distance, io.read_time_us / 1e6);
+  }
+
   if (osr->ops) {
     (osr->ops->destroy)(osr);
   }
@@ -374,6 +446,9 @@ void openslide_close(openslide_t *osr) {
     _openslide_cache_binding_destroy(osr->cache);
   }
 
+  // after the backend has closed its files
+  _openslide_source_destroy(osr->source);
+
   g_free(g_atomic_pointer_get(&osr->error));
 
   g_free(osr);
@@ -472,19 +547,30 @@ double openslide_get_layer_downsample(openslide_t *osr, int32_t level) {
 }
 
 
-int openslide_give_prefetch_hint(openslide_t *osr G_GNUC_UNUSED,
-				 int64_t x G_GNUC_UNUSED,
-				 int64_t y G_GNUC_UNUSED,
-				 int32_t level G_GNUC_UNUSED,
-				 int64_t w G_GNUC_UNUSED,
-				 int64_t h G_GNUC_UNUSED) {
-  g_warning("openslide_give_prefetch_hint has never been implemented and should not be called");
-  return 0;
+int openslide_give_prefetch_hint(openslide_t *osr,
+				 int64_t x, int64_t y,
+				 int32_t level,
+				 int64_t w, int64_t h) {
+  if (openslide_get_error(osr) || !level_in_range(osr, level) ||
+      w < 0 || h < 0) {
+    return -1;
+  }
+  return _openslide_prefetch_hint(osr, x, y, level, w, h);
+}
+
+void openslide_cancel_prefetch_hint(openslide_t *osr, int prefetch_id) {
+  if (openslide_get_error(osr)) {
+    return;
+  }
+  _openslide_prefetch_cancel(osr, prefetch_id);
 }
 
-void openslide_cancel_prefetch_hint(openslide_t *osr G_GNUC_UNUSED,
-				    int prefetch_id G_GNUC_UNUSED) {
-  g_warning("openslide_cancel_prefetch_hint has never been implemented and should not be called");
+void openslide_set_decode_threads(openslide_t *osr, int32_t threads) {
+  if (openslide_get_error(osr)) {
+    return;
+  }
+  g_atomic_int_set(&osr->decode_threads,
+                   _openslide_grid_normalize_threads(threads));
 }
 
 static bool read_region_area(openslide_t *osr,
@@ -510,6 +596,8 @@ static bool read_region_area(openslide_t *osr,
 
   // saturate those seams away!
   cairo_set_operator(cr, CAIRO_OPERATOR_SATURATE);
+  // read_region() cleared the dest
+  _openslide_grid_note_blank_target(cr);
 
   if (level_in_range(osr, level)) {
     struct _openslide_level *l = osr->levels[level];
@@ -546,18 +634,19 @@ static bool read_region_area(openslide_t *osr,
   return true;
 }
 
-void openslide_read_region(openslide_t *osr,
-			   uint32_t *dest,
-			   int64_t x, int64_t y,
-			   int32_t level,
-			   int64_t w, int64_t h) {
+// dest is cleared on success or failure
+static bool read_region(openslide_t *osr,
+                        uint32_t *dest,
+                        int64_t x, int64_t y,
+                        int32_t level,
+                        int64_t w, int64_t h,
+                        GError **err) {
   if (w < 0 || h < 0) {
-    GError *tmp_err = g_error_new(OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
-                                  "negative width (%"PRId64") "
-                                  "or negative height (%"PRId64") "
-                                  "not allowed", w, h);
-    _openslide_propagate_error(osr, tmp_err);
-    return;
+    g_set_error(err, OPENSLIDE_ERROR, OPENSLIDE_ERROR_FAILED,
+                "negative width (%"PRId64") "
+                "or negative height (%"PRId64") "
+                "not allowed", w, h);
+    return false;
   }
 
   // clear the dest
@@ -565,10 +654,8 @@ void openslide_read_region(openslide_t *osr,
     memset(dest, 0, w * h * 4);
   }
 
-  // now that it's cleared, return if an error occurred
-  if (openslide_get_error(osr)) {
-    return;
-  }
+  g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+    _openslide_io_scope_enter(&osr->io_stats);
 
   // Break the work into smaller pieces if the region is large, because:
   // 1. Cairo will not allow surfaces larger than 32767 pixels on a side.
@@ -588,22 +675,262 @@ void openslide_read_region(openslide_t *osr,
       int64_t sh = MIN(h - row * d, d);  // level plane
 
       // paint
-      GError *tmp_err = NULL;
       if (!read_region_area(osr,
                             dest ? dest + w * row * d + col * d : NULL, w * 4,
                             sx, sy, level, sw, sh,
-                            &tmp_err)) {
-        _openslide_propagate_error(osr, tmp_err);
+                            err)) {
         if (dest) {
           // ensure we don't return a partial result
           memset(dest, 0, w * h * 4);
         }
-        return;
+        return false;
       }
     }
   }
+  return true;
+}
+
+void openslide_read_region(openslide_t *osr,
+			   uint32_t *dest,
+			   int64_t x, int64_t y,
+			   int32_t level,
+			   int64_t w, int64_t h) {
+  // clear the dest, and return if an error occurred
+  if (openslide_get_error(osr)) {
+    if (dest && w > 0 && h > 0) {
+      memset(dest, 0, w * h * 4);
+    }
+    return;
+  }
+
+  GError *tmp_err = NULL;
+  if (!read_region(osr, dest, x, y, level, w, h, &tmp_err)) {
+    _openslide_propagate_error(osr, tmp_err);
+  }
+}
+
+struct read_regions {
+  openslide_t *osr;
+  openslide_region_request_t *requests;
+  // sort key for each request
+  struct region_order {
+    int32_t index;
+    int32_t level;
+    int64_t row;
+    int64_t col;
+  } *order;
+  gint failures;
+};
+
+static gint compare_region_order(gconstpointer a, gconstpointer b) {
+  const struct region_order *ra = a;
+  const struct region_order *rb = b;
+  if (ra->level != rb->level) {
+    return ra->level < rb->level ? -1 : 1;
+  }
+  if (ra->row != rb->row) {
+    return ra->row < rb->row ? -1 : 1;
+  }
+  if (ra->col != rb->col) {
+    return ra->col < rb->col ? -1 : 1;
+  }
+  return ra->index < rb->index ? -1 : ra->index > rb->index;
+}
+
+static void read_regions_one(uint32_t index, void *data) {
+  struct read_regions *rr = data;
+  openslide_region_request_t *req = &rr->requests[rr->order[index].index];
+
+  GError *tmp_err = NULL;
+  if (!read_region(rr->osr, req->dest, req->x, req->y, req->level,
+                   req->w, req->h, &tmp_err)) {
+    req->error = g_strdup(tmp_err->message);
+    g_error_free(tmp_err);
+    g_atomic_int_inc(&rr->failures);
+  }
+}
+
+int32_t openslide_read_regions(openslide_t *osr,
+                               openslide_region_request_t *requests,
+                               int32_t count,
+                               int32_t threads) {
+  for (int32_t i = 0; i < count; i++) {
+    requests[i].error = NULL;
+  }
+
+  // clear the dests, and return if an error occurred
+  if (openslide_get_error(osr)) {
+    for (int32_t i = 0; i < count; i++) {
+      openslide_region_request_t *req = &requests[i];
+      if (req->dest && req->w > 0 && req->h > 0) {
+        memset(req->dest, 0, req->w * req->h * 4);
+      }
+    }
+    return -1;
+  }
+  if (count <= 0) {
+    return 0;
+  }
+
+  // sort by level, then tile row, then tile column, so that requests
+  // sharing tiles are read together, and tiles are read in file order
+  // for formats which store them row by row
+  g_autofree struct region_order *order =
+    g_new(struct region_order, count);
+  for (int32_t i = 0; i < count; i++) {
+    openslide_region_request_t *req = &requests[i];
+    struct region_order *o = &order[i];
+    o->index = i;
+    o->level = req->level;
+    o->row = 0;
+    o->col = 0;
+    if (level_in_range(osr, req->level)) {
+      struct _openslide_level *l = osr->levels[req->level];
+      // without tile size hints, use a typical tile size
+      double tile_w = (l->tile_w > 0 ? l->tile_w : 256) * l->downsample;
+      double tile_h = (l->tile_h > 0 ? l->tile_h : 256) * l->downsample;
+      o->row = floor(req->y / tile_h);
+      o->col = floor(req->x / tile_w);
+    }
+  }
+  qsort(order, count, sizeof(*order), compare_region_order);
+
+  struct read_regions rr = {
+    .osr = osr,
+    .requests = requests,
+    .order = order,
+  };
+  _openslide_parallel_for(count, _openslide_grid_normalize_threads(threads),
+                          read_regions_one, &rr);
+  return g_atomic_int_get(&rr.failures);
+}
+
+void openslide_free_region_errors(openslide_region_request_t *requests,
+                                  int32_t count) {
+  for (int32_t i = 0; i < count; i++) {
+    g_free(requests[i].error);
+    requests[i].error = NULL;
+  }
+}
+
+struct _openslide_tile {
+  struct _openslide_cache_entry *entry;
+  const uint32_t *data;
+  int64_t w;
+  int64_t h;
+};
+
+// returns NULL if the level has no native tiles or the tile is out of range
+static struct _openslide_level *get_native_tile_level(openslide_t *osr,
+                                                      int32_t level,
+                                                      int64_t col,
+                                                      int64_t row) {
+  if (!level_in_range(osr, level)) {
+    return NULL;
+  }
+  struct _openslide_level *l = osr->levels[level];
+  if (l->tile_w <= 0 || l->tile_h <= 0) {
+    return NULL;
+  }
+  int64_t cols = (l->w + l->tile_w - 1) / l->tile_w;
+  int64_t rows = (l->h + l->tile_h - 1) / l->tile_h;
+  if (col < 0 || row < 0 || col >= cols || row >= rows) {
+    return NULL;
+  }
+  return l;
+}
+
+openslide_tile_t *openslide_read_tile(openslide_t *osr, int32_t level,
+                                      int64_t col, int64_t row) {
+  if (openslide_get_error(osr) || !osr->ops->read_tile) {
+    return NULL;
+  }
+  struct _openslide_level *l = get_native_tile_level(osr, level, col, row);
+  if (!l) {
+    return NULL;
+  }
+
+  g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+    _openslide_io_scope_enter(&osr->io_stats);
+  struct _openslide_cache_entry *entry = NULL;
+  GError *tmp_err = NULL;
+  uint32_t *data = osr->ops->read_tile(osr, l, col, row, &entry, &tmp_err);
+  if (!data) {
+    // give up our claim on the tile, so other readers can retry it
+    if (entry) {
+      _openslide_cache_entry_unref(entry);
+    }
+    if (tmp_err) {
+      _openslide_propagate_error(osr, tmp_err);
+    }
+    return NULL;
+  }
+
+  struct _openslide_tile *tile = g_new(struct _openslide_tile, 1);
+  tile->entry = entry;
+  tile->data = data;
+  tile->w = l->tile_w;
+  tile->h = l->tile_h;
+  return tile;
+}
+
+const uint32_t *openslide_tile_get_data(openslide_tile_t *tile) {
+  return tile->data;
 }
 
+int64_t openslide_tile_get_stride(openslide_tile_t *tile) {
+  return tile->w * 4;
+}
+
+void openslide_tile_get_dimensions(openslide_tile_t *tile,
+                                   int64_t *w, int64_t *h) {
+  *w = tile->w;
+  *h = tile->h;
+}
+
+void openslide_tile_release(openslide_tile_t *tile) {
+  if (tile) {
+    // the entry outlives the cache and the handle
+    _openslide_cache_entry_unref(tile->entry);
+    g_free(tile);
+  }
+}
+
+void *openslide_read_raw_tile(openslide_t *osr, int32_t level,
+                              int64_t col, int64_t row,
+                              enum openslide_tile_codec *codec,
+                              int64_t *size) {
+  if (openslide_get_error(osr) || !osr->ops->read_raw_tile) {
+    return NULL;
+  }
+  struct _openslide_level *l = get_native_tile_level(osr, level, col, row);
+  if (!l) {
+    return NULL;
+  }
+
+  g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+    _openslide_io_scope_enter(&osr->io_stats);
+  enum openslide_tile_codec tmp_codec = OPENSLIDE_TILE_CODEC_JPEG;
+  size_t len = 0;
+  GError *tmp_err = NULL;
+  void *data = osr->ops->read_raw_tile(osr, l, col, row,
+                                       &tmp_codec, &len, &tmp_err);
+  if (!data) {
+    if (tmp_err) {
+      _openslide_propagate_error(osr, tmp_err);
+    }
+    return NULL;
+  }
+  *codec = tmp_codec;
+  *size = len;
+  return data;
+}
+
+void openslide_free_raw_tile(void *data) {
+  g_free(data);
+}
+
+
 const char * const *openslide_get_property_names(openslide_t *osr) {
   if (openslide_get_error(osr)) {
     return EMPTY_STRING_ARRAY;
@@ -660,6 +987,8 @@ void openslide_read_associated_image(openslide_t *osr,
     size_t pixels = img->w * img->h;
     g_autofree uint32_t *buf = g_new(uint32_t, pixels);
 
+    g_auto(_openslide_io_scope) scope G_GNUC_UNUSED =
+      _openslide_io_scope_enter(&osr->io_stats);
     GError *tmp_err = NULL;
     if (img->ops->get_argb_data(img, buf, &tmp_err)) {
       if (dest) {
@@ -672,7 +1001,12 @@ void openslide_read_associated_image(openslide_t *osr,
 }
 
 openslide_cache_t *openslide_cache_create(size_t capacity) {
-  return _openslide_cache_create(capacity);
+  return _openslide_cache_create(capacity, OPENSLIDE_CACHE_POLICY_LRU);
+}
+
+openslide_cache_t *openslide_cache_create_with_policy(size_t capacity,
+                                                      enum openslide_cache_policy policy) {
+  return _openslide_cache_create(capacity, policy);
 }
 
 void openslide_set_cache(openslide_t *osr, openslide_cache_t *cache) {
@@ -686,6 +1020,60 @@ void openslide_cache_release(openslide_cache_t *cache) {
   _openslide_cache_release(cache);
 }
 
+// copy the fields of a statistics struct that fit in the caller's version
+// of it, as given by its leading struct_size.  if src is NULL, zero them.
+static void copy_stats(void *dest, const void *src, size_t size) {
+  size_t dest_size = *(size_t *) dest;
+  g_return_if_fail(dest_size >= sizeof(size_t));
+  size_t len = MIN(dest_size, size) - sizeof(size_t);
+  if (src) {
+    memcpy((char *) dest + sizeof(size_t),
+           (const char *) src + sizeof(size_t), len);
+  } else {
+    memset((char *) dest + sizeof(size_t), 0, len);
+  }
+}
+
+void openslide_cache_get_stats(openslide_cache_t *cache,
+                               openslide_cache_stats_t *stats) {
+  openslide_cache_stats_t result;
+  _openslide_cache_get_stats(cache, &result);
+  copy_stats(stats, &result, sizeof(result));
+}
+
+void openslide_get_cache_usage_stats(openslide_t *osr,
+                                     openslide_cache_stats_t *stats) {
+  if (openslide_get_error(osr)) {
+    copy_stats(stats, NULL, sizeof(*stats));
+    return;
+  }
+  openslide_cache_stats_t result;
+  _openslide_cache_binding_get_stats(osr->cache, &result);
+  copy_stats(stats, &result, sizeof(result));
+}
+
+bool openslide_register_vfs(const char *scheme,
+                            const openslide_vfs_ops_t *ops,
+                            void *ctx) {
+  return _openslide_vfs_register(scheme, ops, ctx);
+}
+
+void openslide_get_io_stats(openslide_t *osr, openslide_io_stats_t *stats) {
+  if (openslide_get_error(osr)) {
+    copy_stats(stats, NULL, sizeof(*stats));
+    return;
+  }
+  openslide_io_stats_t result;
+  _openslide_io_stats_get(&osr->io_stats, &result);
+  copy_stats(stats, &result, sizeof(result));
+}
+
+void openslide_get_file_stats(openslide_file_stats_t *stats) {
+  openslide_file_stats_t result;
+  _openslide_file_get_stats(&result);
+  copy_stats(stats, &result, sizeof(result));
+}
+
 const char *openslide_get_version(void) {
   return SUFFIXED_VERSION;
 }
@@ -58,6 +58,105 @@ typedef struct _openslide openslide_t;
  */
 typedef struct _openslide_cache openslide_cache_t;
 
+/**
+ * Statistics for an OpenSlide tile cache.
+ *
+ * Statistics can be obtained for an entire cache with
+ * openslide_cache_get_stats(), or for one OpenSlide object's use of its
+ * cache with openslide_get_cache_usage_stats().
+ *
+ * Fields may be added in future versions.  Before requesting statistics,
+ * set @p struct_size to the size of the structure; OpenSlide fills in only
+ * the fields within that size.
+ *
+ * @since 3.5.0
+ */
+typedef struct _openslide_cache_stats {
+  /** Set by the caller to sizeof(openslide_cache_stats_t). */
+  size_t struct_size;
+  /** Tile lookups satisfied from the cache. */
+  uint64_t hits;
+  /** Tile lookups that required the caller to decode the tile. */
+  uint64_t misses;
+  /**
+   * Tile lookups that missed, but then received a tile being decoded by
+   * another thread rather than decoding it again.
+   */
+  uint64_t coalesced;
+  /** Tiles added to the cache. */
+  uint64_t insertions;
+  /** Tiles evicted from the cache to make room for others. */
+  uint64_t evictions;
+  /** Bytes currently held by the cache. */
+  uint64_t bytes;
+  /** Tiles currently held by the cache. */
+  uint64_t entries;
+  /** The largest value of @p bytes so far. */
+  uint64_t peak_bytes;
+  /** The capacity of the cache, in bytes. */
+  uint64_t capacity;
+} openslide_cache_stats_t;
+
+/**
+ * Tile cache eviction policies.
+ *
+ * @since 3.5.0
+ */
+enum openslide_cache_policy {
+  /**
+   * Evict the least recently used tile.  This is the policy used by
+   * openslide_cache_create().
+   */
+  OPENSLIDE_CACHE_POLICY_LRU,
+  /**
+   * Use the S3-FIFO algorithm, which keeps frequently-used tiles in the
+   * cache when other tiles are read only once, as in a sequential scan of
+   * an entire level.  Consider this policy when batch jobs share a cache
+   * with interactive viewers.
+   */
+  OPENSLIDE_CACHE_POLICY_S3FIFO,
+};
+
+/**
+ * A region to be read by openslide_read_regions().
+ *
+ * @since 3.5.0
+ */
+typedef struct _openslide_region_request {
+  /** The top left x-coordinate, in the level 0 reference frame. */
+  int64_t x;
+  /** The top left y-coordinate, in the level 0 reference frame. */
+  int64_t y;
+  /** The desired level. */
+  int32_t level;
+  /** The width of the region. Must be non-negative. */
+  int64_t w;
+  /** The height of the region. Must be non-negative. */
+  int64_t h;
+  /**
+   * The destination buffer for the ARGB data, at least (@p w * @p h * 4)
+   * bytes in length.
+   */
+  uint32_t *dest;
+  /**
+   * Set to NULL if the region was read successfully, or to an error
+   * message which must be freed with openslide_free_region_errors().
+   */
+  char *error;
+} openslide_region_request_t;
+
+/**
+ * Compression formats of tiles returned by openslide_read_raw_tile().
+ *
+ * @since 3.5.0
+ */
+enum openslide_tile_codec {
+  /** A complete baseline JPEG image, with any shared tables included. */
+  OPENSLIDE_TILE_CODEC_JPEG,
+  /** A JPEG 2000 codestream, without a JP2 container. */
+  OPENSLIDE_TILE_CODEC_JPEG2000,
+};
+
 
 /**
  * @name Basic Usage
@@ -93,6 +192,13 @@ const char *openslide_detect_vendor(const char *filename);
  * request.  Instead, it should maintain a cache of OpenSlide objects and
  * reuse them when possible.
  *
+ * If the OPENSLIDE_MMAP environment variable is set to 1 when the library
+ * is loaded, OpenSlide memory-maps the data files of most slide formats
+ * instead of reading them with system calls.  This can speed up reads from
+ * fast local storage.  Only enable it for files which will not be modified
+ * or truncated while they are open, since an I/O error in a mapped file
+ * terminates the process.
+ *
  * @param filename The filename to open.  On Windows, this must be in UTF-8.
  * @return
  *         On success, a new OpenSlide object.
@@ -104,6 +210,77 @@ OPENSLIDE_PUBLIC()
 openslide_t *openslide_open(const char *filename);
 
 
+/**
+ * Callback supplying the other files of a multi-file slide opened with
+ * openslide_open_from_memory() or openslide_open_from_fd().
+ *
+ * The callback must provide the file either as a file descriptor, which
+ * OpenSlide takes ownership of, or as a buffer, which must remain valid
+ * until the OpenSlide object is closed.  It may be called several times
+ * for the same file, and from any thread.
+ *
+ * @param ctx The context pointer passed when opening the slide.
+ * @param name The path of the file relative to the directory containing
+ *             the slide, with "/" as the separator.
+ * @param[out] fd A readable file descriptor, or unchanged (-1) if the
+ *                file is supplied as a buffer.
+ * @param[out] data The file contents, if not supplied with @p fd.
+ * @param[out] size The size of @p data.
+ * @return true if the file was supplied, false if it does not exist.
+ * @since 3.5.0
+ */
+typedef bool (*openslide_resolve_fn)(void *ctx, const char *name, int *fd,
+                                     const void **data, int64_t *size);
+
+
+/**
+ * Open a whole slide image from a buffer in memory.
+ *
+ * This behaves like openslide_open(), but the slide is read from @p data
+ * rather than the filesystem.  Multi-file formats look up their other
+ * files with @p resolve.  Formats which list directories or open
+ * databases (DICOM, Sakura) are not supported.
+ *
+ * @param data The contents of the slide file.  It must remain valid until
+ *             the OpenSlide object is closed.
+ * @param size The size of @p data.
+ * @param name The filename of the slide, used by formats which check the
+ *             file extension.  Directory components are ignored.  If NULL,
+ *             only formats detected from file contents can be opened.
+ * @param resolve Callback supplying other files of the slide, or NULL.
+ * @param ctx A context pointer passed to @p resolve.
+ * @return As for openslide_open().
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+openslide_t *openslide_open_from_memory(const void *data, int64_t size,
+                                        const char *name,
+                                        openslide_resolve_fn resolve,
+                                        void *ctx);
+
+
+/**
+ * Open a whole slide image from a file descriptor.
+ *
+ * This behaves like openslide_open_from_memory(), but reads the slide
+ * from @p fd, which must support positional reads.  OpenSlide duplicates
+ * the descriptor, so the caller may close @p fd once this function
+ * returns.
+ *
+ * @param fd A readable file descriptor.
+ * @param name The filename of the slide, as for
+ *             openslide_open_from_memory().
+ * @param resolve Callback supplying other files of the slide, or NULL.
+ * @param ctx A context pointer passed to @p resolve.
+ * @return As for openslide_open().
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+openslide_t *openslide_open_from_fd(int fd, const char *name,
+                                    openslide_resolve_fn resolve,
+                                    void *ctx);
+
+
 /**
  * Get the number of levels in the whole slide image.
  *
@@ -196,6 +373,47 @@ void openslide_read_region(openslide_t *osr,
 			   int32_t level,
 			   int64_t w, int64_t h);
 
+/**
+ * Copy pre-multiplied ARGB data for many regions of a whole slide image.
+ *
+ * This is equivalent to calling openslide_read_region() for each request,
+ * except that an error reading one region is reported in that request's
+ * @p error field and does not place @p osr into an error state.  The
+ * regions are read in order of their position in the slide, so tiles
+ * shared by nearby regions are usually decoded only once.  If @p threads
+ * is not 1, regions are read in parallel on an internal thread pool.
+ *
+ * The destination buffer of a failed request is cleared.  If @p osr is
+ * already in an error state, all destination buffers are cleared and -1
+ * is returned.
+ *
+ * @param osr The OpenSlide object.
+ * @param requests The regions to read.  Any error messages from a previous
+ *                 call must be freed before the array is reused.
+ * @param count The number of requests.
+ * @param threads The number of threads to use, including the calling
+ *                thread, or 0 for one thread per processor.
+ * @return The number of requests that failed, or -1 if @p osr is in an
+ *         error state.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+int32_t openslide_read_regions(openslide_t *osr,
+                               openslide_region_request_t *requests,
+                               int32_t count,
+                               int32_t threads);
+
+/**
+ * Free the error messages set by openslide_read_regions().
+ *
+ * @param requests The requests passed to openslide_read_regions().
+ * @param count The number of requests.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_free_region_errors(openslide_region_request_t *requests,
+                                  int32_t count);
+
 
 /**
  * Close an OpenSlide object.
@@ -479,6 +697,19 @@ void openslide_read_associated_image(openslide_t *osr,
 OPENSLIDE_PUBLIC()
 openslide_cache_t *openslide_cache_create(size_t capacity);
 
+/**
+ * Create a new tile cache with the specified eviction policy.  Otherwise
+ * identical to openslide_cache_create().
+ *
+ * @param capacity The capacity of the cache, in bytes.
+ * @param policy The eviction policy.
+ * @return A new cache, or NULL if the policy is invalid.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+openslide_cache_t *openslide_cache_create_with_policy(size_t capacity,
+                                                      enum openslide_cache_policy policy);
+
 /**
  * Attach a cache to the specified OpenSlide object, replacing the
  * current cache.
@@ -501,6 +732,432 @@ void openslide_set_cache(openslide_t *osr, openslide_cache_t *cache);
 OPENSLIDE_PUBLIC()
 void openslide_cache_release(openslide_cache_t *cache);
 
+/**
+ * Get statistics for a cache.
+ *
+ * @param cache The cache.
+ * @param[in,out] stats The cache statistics.  @p struct_size must be set.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_cache_get_stats(openslide_cache_t *cache,
+                               openslide_cache_stats_t *stats);
+
+/**
+ * Get statistics for an OpenSlide object's use of its current cache.
+ * Counters are reset when a cache is attached with openslide_set_cache().
+ * @p capacity reports the capacity of the entire cache.
+ *
+ * @param osr The OpenSlide object.
+ * @param[in,out] stats The cache statistics.  @p struct_size must be set.
+ *                      Zeroed if @p osr is in an error state.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_get_cache_usage_stats(openslide_t *osr,
+                                     openslide_cache_stats_t *stats);
+
+//@}
+
+/**
+ * @name Prefetching
+ * Reading regions into the tile cache in the background.
+ *
+ * An application that can predict which regions it will read next, such
+ * as a viewer tracking the direction of panning, can ask OpenSlide to
+ * decode those regions into the cache ahead of time.  Prefetching is
+ * performed by a small pool of background threads shared by all OpenSlide
+ * objects.  More recent hints are serviced first.  Hints may be partially
+ * or entirely dropped if too much prefetch work is already queued, and
+ * errors encountered while prefetching are ignored.
+ *
+ * Prefetched tiles are only useful if the cache is large enough to hold
+ * them until they are read.
+ */
+//@{
+
+/**
+ * Give a hint that a region will probably be read soon.  The arguments
+ * have the same meaning as in openslide_read_region().
+ *
+ * @param osr The OpenSlide object.
+ * @param x The top left x-coordinate, in the level 0 reference frame.
+ * @param y The top left y-coordinate, in the level 0 reference frame.
+ * @param level The desired level.
+ * @param w The width of the region. Must be non-negative.
+ * @param h The height of the region. Must be non-negative.
+ * @return A prefetch ID that can be passed to
+ *         openslide_cancel_prefetch_hint(), or -1 if an error occurred or
+ *         the arguments were invalid.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+int openslide_give_prefetch_hint(openslide_t *osr,
+				 int64_t x, int64_t y,
+				 int32_t level,
+				 int64_t w, int64_t h);
+
+/**
+ * Cancel a prefetch hint.  Work queued for the hint is discarded, but
+ * work already in progress is allowed to finish.  Unknown or completed
+ * prefetch IDs are ignored.
+ *
+ * @param osr The OpenSlide object.
+ * @param prefetch_id A prefetch ID returned by
+ *                    openslide_give_prefetch_hint().
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_cancel_prefetch_hint(openslide_t *osr, int prefetch_id);
+
+//@}
+
+/**
+ * @name Parallel Decoding
+ * Decoding a region's tiles on several threads.
+ *
+ * When a region covers several tiles, OpenSlide can decode them in
+ * parallel on an internal thread pool before compositing them into the
+ * destination buffer.  This reduces the latency of large reads from
+ * uncached areas of the slide.  Parallel decoding is disabled by default.
+ * The default for new OpenSlide objects can be changed with the
+ * OPENSLIDE_DECODE_THREADS environment variable, which is read when the
+ * library is loaded.
+ *
+ * Parallel decoding relies on the tile cache, so it is skipped for regions
+ * whose tiles would not fit in the cache.  Some slide formats do not
+ * support parallel decoding.
+ */
+//@{
+
+/**
+ * Set the number of threads used to decode each region read from an
+ * OpenSlide object, including the calling thread.
+ *
+ * @param osr The OpenSlide object.
+ * @param threads The number of threads, 1 to disable parallel decoding,
+ *                or 0 for one thread per processor.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_set_decode_threads(openslide_t *osr, int32_t threads);
+
+//@}
+
+/**
+ * @name Native Tiles
+ * Direct access to decoded tiles in the tile cache.
+ *
+ * Some slide formats store each level as a grid of tiles, whose size is
+ * reported by the openslide.level[N].tile-width and
+ * openslide.level[N].tile-height properties.  For these formats, a
+ * decoded tile can be borrowed from the tile cache without copying it
+ * into a caller buffer.  The tile remains valid until it is released,
+ * even if it is evicted from the cache or the OpenSlide object is closed.
+ *
+ * Tile data is pre-multiplied ARGB, in the same format as
+ * openslide_read_region().  Tiles at the right and bottom edges of a
+ * level have full tile dimensions; pixels outside the level are
+ * transparent.
+ */
+//@{
+
+/**
+ * An opaque reference to a decoded tile.
+ * @since 3.5.0
+ */
+typedef struct _openslide_tile openslide_tile_t;
+
+/**
+ * Get a reference to a decoded tile of a whole slide image.
+ *
+ * If the slide format does not store native tiles, or the tile is out of
+ * range or missing from the slide, NULL is returned without setting an
+ * error.  If an error occurs while decoding the tile, NULL is returned and
+ * @p osr is placed into an error state.
+ *
+ * @param osr The OpenSlide object.
+ * @param level The desired level.
+ * @param col The tile column.
+ * @param row The tile row.
+ * @return A tile reference which must be released with
+ *         openslide_tile_release(), or NULL.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+openslide_tile_t *openslide_read_tile(openslide_t *osr, int32_t level,
+                                      int64_t col, int64_t row);
+
+/**
+ * Get the pixel data of a tile.
+ *
+ * @param tile The tile.
+ * @return The ARGB pixel data, which must not be modified.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+const uint32_t *openslide_tile_get_data(openslide_tile_t *tile);
+
+/**
+ * Get the distance between the starts of consecutive rows of a tile.
+ *
+ * @param tile The tile.
+ * @return The row stride, in bytes.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+int64_t openslide_tile_get_stride(openslide_tile_t *tile);
+
+/**
+ * Get the dimensions of a tile.
+ *
+ * @param tile The tile.
+ * @param[out] w The width of the tile.
+ * @param[out] h The height of the tile.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_tile_get_dimensions(openslide_tile_t *tile,
+                                   int64_t *w, int64_t *h);
+
+/**
+ * Release a tile reference.
+ *
+ * @param tile The tile.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_tile_release(openslide_tile_t *tile);
+
+/**
+ * Get the compressed data of a tile of a whole slide image, as stored in
+ * the slide file.
+ *
+ * This allows a tile to be served to a client without decoding and
+ * re-encoding it.  If the tile cannot be decoded as a standalone image
+ * of the returned @p codec, with the same pixels that openslide_read_tile()
+ * would return, NULL is returned without setting an error.  This happens
+ * for some slide formats and compression schemes, and for tiles that are
+ * missing from the slide.  Tiles at the right and bottom edges of a level
+ * may contain image data beyond the level boundary, which
+ * openslide_read_tile() would make transparent.
+ *
+ * If an error occurs while reading the tile, NULL is returned and @p osr
+ * is placed into an error state.
+ *
+ * @param osr The OpenSlide object.
+ * @param level The desired level.
+ * @param col The tile column.
+ * @param row The tile row.
+ * @param[out] codec The compression format of the data.
+ * @param[out] size The length of the data, in bytes.
+ * @return The compressed data, which must be freed with
+ *         openslide_free_raw_tile(), or NULL.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void *openslide_read_raw_tile(openslide_t *osr, int32_t level,
+                              int64_t col, int64_t row,
+                              enum openslide_tile_codec *codec,
+                              int64_t *size);
+
+/**
+ * Free the data returned by openslide_read_raw_tile().
+ *
+ * @param data The data.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_free_raw_tile(void *data);
+
+//@}
+
+/**
+ * @name Virtual File Systems
+ * Reading slides from storage other than the local filesystem.
+ *
+ * A virtual file system (VFS) handles every path beginning with its URL
+ * scheme followed by "://", such as "s3://bucket/slide.svs".  OpenSlide
+ * opens such paths through the VFS callbacks instead of the C library.
+ * If OpenSlide is built with libcurl, a VFS for the "http" and "https"
+ * schemes is registered automatically.  It fetches fixed-size blocks of
+ * the file with HTTP range requests, in parallel where possible, and
+ * keeps recently used blocks in memory.
+ *
+ * Only formats stored in a single file can be read through a VFS, since
+ * OpenSlide can't list the directories of multi-file slides.
+ */
+//@{
+
+/**
+ * Callbacks implementing a virtual file system.
+ * @since 3.5.0
+ */
+typedef struct openslide_vfs_ops {
+  /**
+   * Open a file.
+   *
+   * @param ctx The context pointer passed to openslide_register_vfs().
+   * @param path The full path, including the scheme.
+   * @return An opaque file handle, or NULL if the file can't be opened.
+   */
+  void *(*open)(void *ctx, const char *path);
+  /**
+   * Read from a file.  May be called from several threads at once.
+   *
+   * @param handle The file handle.
+   * @param buf The buffer to read into.
+   * @param size The number of bytes to read.
+   * @param offset The offset into the file.
+   * @return The number of bytes read, which may be less than size, 0 at
+   *         end of file, or -1 on error.
+   */
+  int64_t (*read)(void *handle, void *buf, int64_t size, int64_t offset);
+  /**
+   * Get the size of a file.
+   *
+   * @param handle The file handle.
+   * @return The size in bytes, or -1 on error.
+   */
+  int64_t (*size)(void *handle);
+  /**
+   * Close a file.
+   *
+   * @param handle The file handle.
+   */
+  void (*close)(void *handle);
+} openslide_vfs_ops_t;
+
+/**
+ * Register a virtual file system for a URL scheme.  Registrations are
+ * permanent.  This function should be called before opening any slides
+ * with the scheme.
+ *
+ * @param scheme The URL scheme, such as "s3", without the trailing colon.
+ * @param ops The VFS callbacks.  They are copied.
+ * @param ctx A context pointer passed to the open callback.
+ * @return true on success, or false if the scheme is invalid or already
+ *         registered.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+bool openslide_register_vfs(const char *scheme,
+                            const openslide_vfs_ops_t *ops,
+                            void *ctx);
+
+//@}
+
+/**
+ * @name File Handles
+ * Limiting the files held open by all OpenSlide objects.
+ *
+ * OpenSlide keeps slide data files open between reads.  To avoid
+ * exhausting the process's file descriptors when many slides are open,
+ * these files are drawn from a process-wide pool.  When the pool is full,
+ * the least recently used files not currently being read are closed, and
+ * are transparently reopened when next needed.
+ *
+ * The pool size can be set with the OPENSLIDE_MAX_OPEN_FILES environment
+ * variable before the library is loaded.  By default it is half of the
+ * process's soft RLIMIT_NOFILE, or 256 if that limit is unavailable.
+ * Memory-mapped files (see openslide_open()) hold no file descriptor once
+ * mapped, so they are neither counted nor closed early.  Short-lived files
+ * used while opening a slide are not counted either.
+ */
+//@{
+
+/**
+ * Statistics for the file handle pool.
+ *
+ * @p struct_size must be set as for @ref openslide_cache_stats_t.
+ *
+ * @since 3.5.0
+ */
+typedef struct _openslide_file_stats {
+  /** Set by the caller to sizeof(openslide_file_stats_t). */
+  size_t struct_size;
+  /** Pooled files currently holding a file descriptor. */
+  uint64_t open;
+  /** The largest value of @p open so far. */
+  uint64_t peak_open;
+  /** The pool size. */
+  uint64_t limit;
+  /** Files opened so far, including reopens. */
+  uint64_t opens;
+  /** Files closed to stay within the limit. */
+  uint64_t evictions;
+} openslide_file_stats_t;
+
+/**
+ * Get statistics for the process-wide file handle pool.
+ *
+ * @param[in,out] stats The pool statistics.  @p struct_size must be set.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_get_file_stats(openslide_file_stats_t *stats);
+
+//@}
+
+/**
+ * @name I/O Statistics
+ * Measuring an OpenSlide object's file access.
+ *
+ * OpenSlide counts the file operations it performs on behalf of each
+ * OpenSlide object, including reads by background threads decoding or
+ * prefetching for it.  Comparing the time spent reading with the total
+ * time of a slow operation shows whether storage or decoding is the
+ * bottleneck.
+ *
+ * If the OPENSLIDE_DEBUG environment variable contains "io" when the
+ * library is loaded, these statistics are logged when each OpenSlide
+ * object is closed.
+ */
+//@{
+
+/**
+ * I/O statistics for an OpenSlide object.
+ *
+ * Reads from memory-mapped files are counted as reads.  Reads through
+ * a virtual file system are counted once, at the VFS interface.
+ *
+ * @p struct_size must be set as for @ref openslide_cache_stats_t.
+ *
+ * @since 3.5.0
+ */
+typedef struct _openslide_io_stats {
+  /** Set by the caller to sizeof(openslide_io_stats_t). */
+  size_t struct_size;
+  /** Files opened, including detection and reopens. */
+  uint64_t opens;
+  /** Read operations.  Nearby reads merged into one are counted once. */
+  uint64_t reads;
+  /** Bytes read. */
+  uint64_t bytes_read;
+  /**
+   * Explicit seeks, plus positional reads not starting where the previous
+   * read of the same file ended.
+   */
+  uint64_t seeks;
+  /** Total distance covered by @p seeks, in bytes. */
+  uint64_t seek_distance;
+  /** Wall-clock time spent in read operations, in microseconds. */
+  uint64_t read_time_us;
+  /** Bytes read only because they separated two merged reads. */
+  uint64_t overread_bytes;
+} openslide_io_stats_t;
+
+/**
+ * Get I/O statistics for an OpenSlide object since it was opened.
+ *
+ * @param osr The OpenSlide object.
+ * @param[in,out] stats The I/O statistics.  @p struct_size must be set.
+ *                      Zeroed if @p osr is in an error state.
+ * @since 3.5.0
+ */
+OPENSLIDE_PUBLIC()
+void openslide_get_io_stats(openslide_t *osr, openslide_io_stats_t *stats);
+
 //@}
 
 /**
@@ -638,17 +1295,6 @@ const char *openslide_get_comment(openslide_t *osr);
 
 //@}
 
-#ifndef OPENSLIDE_SIMPLIFY_HEADERS
-// these are meant to throw compile- and link-time errors,
-// since the functions they replace were never implemented
-int _openslide_give_prefetch_hint_UNIMPLEMENTED(void);
-void _openslide_cancel_prefetch_hint_UNIMPLEMENTED(void);
-#define openslide_give_prefetch_hint(osr, x, y, level, w, h)	\
-  _openslide_give_prefetch_hint_UNIMPLEMENTED(-1);
-#define openslide_cancel_prefetch_hint(osr, prefetch_id)	\
-  _openslide_cancel_prefetch_hint_UNIMPLEMENTED(-1)
-#endif
-
 /**
  * @mainpage OpenSlide
  *
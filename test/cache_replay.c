@@ -0,0 +1,169 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide project
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Generate a trace mixing an interactive viewer, which pans around a small
+   area of level 0, with a batch job sweeping sequentially across all of
+   level 0.  Replay the trace against a shared cache using each eviction
+   policy, and report the hit ratios. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <glib.h>
+#include <openslide.h>
+#include "openslide-common.h"
+
+#define READ_SIZE 512
+#define HOT_SIZE 8  // viewer pans within this many reads in each dimension
+#define SWEEP_READS_PER_STEP 4
+
+struct read {
+  bool viewer;
+  int64_t x;
+  int64_t y;
+};
+
+struct result {
+  openslide_cache_stats_t viewer;
+  openslide_cache_stats_t total;
+};
+
+static const struct {
+  const char *name;
+  enum openslide_cache_policy policy;
+} policies[] = {
+  {"LRU", OPENSLIDE_CACHE_POLICY_LRU},
+  {"S3-FIFO", OPENSLIDE_CACHE_POLICY_S3FIFO},
+};
+
+static GArray *make_trace(int64_t w, int64_t h, int steps) {
+  GArray *trace = g_array_new(false, false, sizeof(struct read));
+  g_autoptr(GRand) rand = g_rand_new_with_seed(1);
+
+  int64_t cols = MAX(w / READ_SIZE, 1);
+  int64_t rows = MAX(h / READ_SIZE, 1);
+  int64_t hot_x = MAX(cols / 2 - HOT_SIZE / 2, 0);
+  int64_t hot_y = MAX(rows / 2 - HOT_SIZE / 2, 0);
+  int64_t view_col = hot_x;
+  int64_t view_row = hot_y;
+  int64_t sweep = 0;
+
+  for (int i = 0; i < steps; i++) {
+    // viewer pans by at most one read in each direction
+    view_col = CLAMP(view_col + g_rand_int_range(rand, -1, 2),
+                     hot_x, MIN(hot_x + HOT_SIZE, cols) - 1);
+    view_row = CLAMP(view_row + g_rand_int_range(rand, -1, 2),
+                     hot_y, MIN(hot_y + HOT_SIZE, rows) - 1);
+    struct read r = {
+      .viewer = true,
+      .x = view_col * READ_SIZE,
+      .y = view_row * READ_SIZE,
+    };
+    g_array_append_val(trace, r);
+
+    // batch job continues its sweep
+    for (int j = 0; j < SWEEP_READS_PER_STEP; j++) {
+      struct read r = {
+        .viewer = false,
+        .x = (sweep % cols) * READ_SIZE,
+        .y = (sweep / cols % rows) * READ_SIZE,
+      };
+      g_array_append_val(trace, r);
+      sweep++;
+    }
+  }
+  return trace;
+}
+
+static void replay(const char *path, GArray *trace, size_t cache_size,
+                   enum openslide_cache_policy policy,
+                   struct result *result) {
+  g_autoptr(openslide_t) viewer = openslide_open(path);
+  g_autoptr(openslide_t) batch = openslide_open(path);
+  if (!viewer || !batch) {
+    common_fail("Couldn't open %s", path);
+  }
+  openslide_cache_t *cache =
+    openslide_cache_create_with_policy(cache_size, policy);
+  openslide_set_cache(viewer, cache);
+  openslide_set_cache(batch, cache);
+
+  g_autofree uint32_t *buf = g_malloc(READ_SIZE * READ_SIZE * 4);
+  for (guint i = 0; i < trace->len; i++) {
+    struct read *r = &g_array_index(trace, struct read, i);
+    openslide_read_region(r->viewer ? viewer : batch, buf, r->x, r->y, 0,
+                          READ_SIZE, READ_SIZE);
+  }
+  result->viewer.struct_size = sizeof(result->viewer);
+  result->total.struct_size = sizeof(result->total);
+  openslide_get_cache_usage_stats(viewer, &result->viewer);
+  openslide_cache_get_stats(cache, &result->total);
+
+  const char *error = openslide_get_error(viewer);
+  if (!error) {
+    error = openslide_get_error(batch);
+  }
+  if (error) {
+    common_fail("%s", error);
+  }
+  openslide_cache_release(cache);
+}
+
+int main(int argc, char **argv) {
+  common_fix_argv(&argc, &argv);
+  if (argc != 4) {
+    printf("Usage: %s <file> <cache-MiB> <steps>\n", argv[0]);
+    return 2;
+  }
+  const char *path = argv[1];
+  size_t cache_size = (size_t) atoi(argv[2]) << 20;
+  int steps = atoi(argv[3]);
+  if (steps < 1) {
+    printf("Invalid step count\n");
+    return 1;
+  }
+
+  int64_t w, h;
+  g_autoptr(openslide_t) osr = openslide_open(path);
+  if (!osr) {
+    common_fail("Unrecognized file");
+  }
+  openslide_get_level0_dimensions(osr, &w, &h);
+  if (w < 0) {
+    common_fail("%s", openslide_get_error(osr));
+  }
+  g_autoptr(GArray) trace = make_trace(w, h, steps);
+
+  printf("%-8s %12s %12s %12s\n", "Policy", "Viewer hits", "All hits",
+         "Evictions");
+  for (unsigned i = 0; i < G_N_ELEMENTS(policies); i++) {
+    struct result result;
+    replay(path, trace, cache_size, policies[i].policy, &result);
+    uint64_t viewer_lookups = result.viewer.hits + result.viewer.misses;
+    uint64_t total_lookups = result.total.hits + result.total.misses;
+    printf("%-8s %11.1f%% %11.1f%% %12"PRIu64"\n", policies[i].name,
+           100.0 * result.viewer.hits / MAX(viewer_lookups, 1),
+           100.0 * result.total.hits / MAX(total_lookups, 1),
+           result.total.evictions);
+  }
+  return 0;
+}
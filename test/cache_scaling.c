@@ -0,0 +1,129 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide project
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Open several handles to a slide, share one cache between them, warm the
+   cache, and then measure cache-hit read throughput with an increasing
+   number of threads.  Reads are small so that time is dominated by cache
+   lookups rather than pixel copying. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <glib.h>
+#include <openslide.h>
+#include "openslide-common.h"
+
+#define HANDLES 4
+#define REGION_SIZE 2048
+#define READ_SIZE 32
+#define READS_PER_THREAD 200000
+#define CACHE_SIZE (1024 * 1024 * 512)
+
+struct state {
+  openslide_t *osr[HANDLES];
+  int64_t x;
+  int64_t y;
+};
+
+static void *thread_func(void *data) {
+  struct state *state = data;
+  uint32_t buf[READ_SIZE * READ_SIZE];
+  GRand *rand = g_rand_new();
+
+  for (int i = 0; i < READS_PER_THREAD; i++) {
+    openslide_t *osr = state->osr[g_rand_int_range(rand, 0, HANDLES)];
+    int64_t x = state->x + g_rand_int_range(rand, 0, REGION_SIZE - READ_SIZE);
+    int64_t y = state->y + g_rand_int_range(rand, 0, REGION_SIZE - READ_SIZE);
+    openslide_read_region(osr, buf, x, y, 0, READ_SIZE, READ_SIZE);
+  }
+
+  g_rand_free(rand);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  struct state state;
+
+  common_fix_argv(&argc, &argv);
+  if (argc != 3) {
+    printf("Usage: %s <file> <max-threads>\n", argv[0]);
+    return 2;
+  }
+
+  int max_threads = atoi(argv[2]);
+  if (max_threads < 1) {
+    printf("Invalid thread count\n");
+    return 1;
+  }
+
+  // open handles sharing one cache
+  openslide_cache_t *cache = openslide_cache_create(CACHE_SIZE);
+  for (int i = 0; i < HANDLES; i++) {
+    state.osr[i] = openslide_open(argv[1]);
+    if (!state.osr[i]) {
+      common_fail("Unrecognized file");
+    }
+    const char *error = openslide_get_error(state.osr[i]);
+    if (error) {
+      common_fail("%s", error);
+    }
+    openslide_set_cache(state.osr[i], cache);
+  }
+  openslide_cache_release(cache);
+
+  // warm the cache with a region near the center of the slide
+  int64_t w, h;
+  openslide_get_level0_dimensions(state.osr[0], &w, &h);
+  state.x = MAX(w / 2 - REGION_SIZE / 2, 0);
+  state.y = MAX(h / 2 - REGION_SIZE / 2, 0);
+  g_autofree uint32_t *warm = g_malloc(REGION_SIZE * REGION_SIZE * 4);
+  for (int i = 0; i < HANDLES; i++) {
+    openslide_read_region(state.osr[i], warm, state.x, state.y, 0,
+                          REGION_SIZE, REGION_SIZE);
+  }
+
+  // run with increasing thread counts
+  for (int threads = 1; threads <= max_threads; threads *= 2) {
+    g_autofree GThread **thread_list = g_new(GThread *, threads);
+    g_autoptr(GTimer) timer = g_timer_new();
+    for (int i = 0; i < threads; i++) {
+      thread_list[i] = g_thread_new("reader", thread_func, &state);
+    }
+    for (int i = 0; i < threads; i++) {
+      g_thread_join(thread_list[i]);
+    }
+    double seconds = g_timer_elapsed(timer, NULL);
+    int64_t reads = (int64_t) threads * READS_PER_THREAD;
+    printf("%3d threads: %"PRId64" reads in %g seconds -> %g reads/sec\n",
+           threads, reads, seconds, reads / seconds);
+  }
+
+  // report errors
+  for (int i = 0; i < HANDLES; i++) {
+    const char *error = openslide_get_error(state.osr[i]);
+    if (error) {
+      printf("%s\n", error);
+    }
+    openslide_close(state.osr[i]);
+  }
+  return 0;
+}
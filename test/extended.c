@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <unistd.h>
 #include <inttypes.h>
 
@@ -35,8 +36,17 @@
 #include "openslide-common.h"
 #include "config.h"
 
+#ifdef HAVE_LIBCURL
+#include <gio/gio.h>
+#endif
+
 #define MAX_LEAK_FD 128
 
+// formats which don't need other files
+static const char *const single_file_vendors[] = {
+  "aperio", "generic-tiff", "leica", "philips", "ventana", NULL
+};
+
 static void test_image_fetch(openslide_t *osr,
 			     int64_t x, int64_t y,
 			     int64_t w, int64_t h) {
@@ -198,6 +208,442 @@ static void check_shared_cache(const char *slide) {
   }
 }
 
+// test cache statistics
+static void check_cache_stats(const char *slide) {
+  g_autoptr(openslide_t) osr = openslide_open(slide);
+  g_assert(osr);
+  openslide_cache_t *cache = openslide_cache_create(64 << 20);
+  openslide_set_cache(osr, cache);
+
+  openslide_cache_stats_t stats = {.struct_size = sizeof(stats)};
+  openslide_cache_get_stats(cache, &stats);
+  g_assert(stats.hits == 0 && stats.misses == 0 && stats.coalesced == 0);
+
+  g_autofree uint32_t *buf = g_malloc(4 * 200 * 200);
+  openslide_read_region(osr, buf, 0, 0, 0, 200, 200);
+  openslide_cache_get_stats(cache, &stats);
+  g_assert(stats.misses > 0);
+
+  openslide_read_region(osr, buf, 0, 0, 0, 200, 200);
+  openslide_cache_get_stats(cache, &stats);
+  g_assert(stats.hits > 0);
+  g_assert(stats.insertions > 0);
+  g_assert(stats.bytes > 0 && stats.bytes <= stats.peak_bytes);
+  g_assert(stats.capacity == 64 << 20);
+  g_assert(openslide_get_error(osr) == NULL);
+
+  // the only handle using the cache accounts for all of it
+  openslide_cache_stats_t osr_stats = {.struct_size = sizeof(osr_stats)};
+  openslide_get_cache_usage_stats(osr, &osr_stats);
+  g_assert(osr_stats.hits == stats.hits);
+  g_assert(osr_stats.misses == stats.misses);
+  g_assert(osr_stats.bytes == stats.bytes);
+  g_assert(osr_stats.entries == stats.entries);
+
+  // fields beyond struct_size are left alone
+  openslide_cache_stats_t partial = {
+    .struct_size = offsetof(openslide_cache_stats_t, misses),
+    .misses = UINT64_MAX,
+  };
+  openslide_cache_get_stats(cache, &partial);
+  g_assert(partial.hits == stats.hits);
+  g_assert(partial.misses == UINT64_MAX);
+
+  openslide_cache_release(cache);
+}
+
+static void check_file_stats(const char *slide) {
+  openslide_file_stats_t before = {.struct_size = sizeof(before)};
+  openslide_get_file_stats(&before);
+  g_assert(before.limit > 0);
+
+  openslide_t *osr1 = openslide_open(slide);
+  openslide_t *osr2 = openslide_open(slide);
+  g_assert(osr1 && osr2);
+  g_autofree uint32_t *buf = g_malloc(4 * 200 * 200);
+  openslide_read_region(osr1, buf, 0, 0, 0, 200, 200);
+  openslide_read_region(osr2, buf, 0, 0, 0, 200, 200);
+  g_assert(openslide_get_error(osr1) == NULL);
+  g_assert(openslide_get_error(osr2) == NULL);
+
+  openslide_file_stats_t stats = {.struct_size = sizeof(stats)};
+  openslide_get_file_stats(&stats);
+  g_assert(stats.open <= stats.peak_open);
+  g_assert(stats.opens >= before.opens);
+  g_assert(stats.opens - before.opens >= stats.open - before.open);
+  g_assert(stats.limit == before.limit);
+
+  // closing the handles returns their files to the pool and closes them
+  openslide_close(osr1);
+  openslide_close(osr2);
+  openslide_get_file_stats(&stats);
+  g_assert(stats.open == before.open);
+}
+
+static void check_io_stats(const char *slide) {
+  g_autoptr(openslide_t) osr = openslide_open(slide);
+  g_assert(osr);
+
+  // opening reads the slide's metadata
+  openslide_io_stats_t stats = {.struct_size = sizeof(stats)};
+  openslide_get_io_stats(osr, &stats);
+  g_assert(stats.opens > 0);
+  g_assert(stats.reads > 0);
+  g_assert(stats.bytes_read > 0);
+
+  g_autofree uint32_t *buf = g_malloc(4 * 200 * 200);
+  openslide_read_region(osr, buf, 0, 0, 0, 200, 200);
+  g_assert(openslide_get_error(osr) == NULL);
+  openslide_io_stats_t after = {.struct_size = sizeof(after)};
+  openslide_get_io_stats(osr, &after);
+  g_assert(after.reads >= stats.reads);
+  g_assert(after.bytes_read >= stats.bytes_read);
+  g_assert(after.seek_distance >= stats.seek_distance);
+}
+
+static void check_read_regions(const char *slide) {
+  g_autoptr(openslide_t) osr = openslide_open(slide);
+  g_assert(osr);
+
+  const int size = 100;
+  openslide_region_request_t reqs[] = {
+    {.x = 300, .y = 300, .level = 0, .w = size, .h = size},
+    {.x = 0, .y = 0, .level = 0, .w = size, .h = size},
+    {.x = 0, .y = 0, .level = 0, .w = -1, .h = size},
+    {.x = 50, .y = 50, .level = 0, .w = size, .h = size},
+  };
+  const int count = G_N_ELEMENTS(reqs);
+  for (int i = 0; i < count; i++) {
+    reqs[i].dest = g_malloc(4 * size * size);
+  }
+  g_assert(openslide_read_regions(osr, reqs, count, 0) == 1);
+  g_assert(reqs[2].error != NULL);
+  g_assert(openslide_get_error(osr) == NULL);
+
+  // results match individual reads
+  g_autofree uint32_t *buf = g_malloc(4 * size * size);
+  for (int i = 0; i < count; i++) {
+    if (reqs[i].error) {
+      continue;
+    }
+    openslide_read_region(osr, buf, reqs[i].x, reqs[i].y, reqs[i].level,
+                          reqs[i].w, reqs[i].h);
+    g_assert(!memcmp(buf, reqs[i].dest, 4 * size * size));
+  }
+  g_assert(openslide_get_error(osr) == NULL);
+
+  openslide_free_region_errors(reqs, count);
+  g_assert(reqs[2].error == NULL);
+  for (int i = 0; i < count; i++) {
+    g_free(reqs[i].dest);
+  }
+}
+
+static void check_read_tile(const char *slide) {
+  openslide_t *osr = openslide_open(slide);
+  g_assert(osr);
+
+  openslide_tile_t *tile = openslide_read_tile(osr, 0, 0, 0);
+  g_assert(openslide_get_error(osr) == NULL);
+  if (!tile) {
+    // format doesn't have native tiles
+    openslide_close(osr);
+    return;
+  }
+  int64_t tw, th;
+  openslide_tile_get_dimensions(tile, &tw, &th);
+  int64_t stride = openslide_tile_get_stride(tile);
+  g_assert(tw > 0 && th > 0 && stride >= tw * 4);
+
+  // out-of-range tiles aren't errors
+  g_assert(openslide_read_tile(osr, 0, -1, 0) == NULL);
+  g_assert(openslide_read_tile(osr, openslide_get_level_count(osr), 0, 0) ==
+           NULL);
+  g_assert(openslide_get_error(osr) == NULL);
+
+  // tile matches the corresponding region
+  int64_t w, h;
+  openslide_get_level_dimensions(osr, 0, &w, &h);
+  w = MIN(w, tw);
+  h = MIN(h, th);
+  g_autofree uint32_t *buf = g_malloc(4 * w * h);
+  openslide_read_region(osr, buf, 0, 0, 0, w, h);
+  g_assert(openslide_get_error(osr) == NULL);
+
+  // tile survives the handle
+  openslide_close(osr);
+  const uint32_t *data = openslide_tile_get_data(tile);
+  for (int64_t y = 0; y < h; y++) {
+    g_assert(!memcmp(buf + y * w, (const uint8_t *) data + y * stride,
+                     4 * w));
+  }
+  openslide_tile_release(tile);
+}
+
+static void check_read_raw_tile(const char *slide) {
+  g_autoptr(openslide_t) osr = openslide_open(slide);
+  g_assert(osr);
+
+  enum openslide_tile_codec codec;
+  int64_t size;
+  uint8_t *data = openslide_read_raw_tile(osr, 0, 0, 0, &codec, &size);
+  g_assert(openslide_get_error(osr) == NULL);
+  if (!data) {
+    // not supported for this slide
+    return;
+  }
+  switch (codec) {
+  case OPENSLIDE_TILE_CODEC_JPEG:
+    // SOI
+    g_assert(size >= 4);
+    g_assert(data[0] == 0xFF && data[1] == 0xD8);
+    break;
+  case OPENSLIDE_TILE_CODEC_JPEG2000:
+    // SOC
+    g_assert(size >= 2);
+    g_assert(data[0] == 0xFF && data[1] == 0x4F);
+    break;
+  default:
+    g_assert_not_reached();
+  }
+  openslide_free_raw_tile(data);
+
+  g_assert(openslide_read_raw_tile(osr, 0, 0, -1, &codec, &size) == NULL);
+  g_assert(openslide_get_error(osr) == NULL);
+}
+
+static void check_same_region(openslide_t *expected_osr, openslide_t *osr,
+                              int64_t x, int64_t y, int32_t level,
+                              int64_t w, int64_t h) {
+  g_autofree uint32_t *expected = g_new(uint32_t, w * h);
+  g_autofree uint32_t *actual = g_new(uint32_t, w * h);
+  openslide_read_region(expected_osr, expected, x, y, level, w, h);
+  openslide_read_region(osr, actual, x, y, level, w, h);
+  g_assert(openslide_get_error(expected_osr) == NULL);
+  const char *err = openslide_get_error(osr);
+  if (err) {
+    common_fail("Read failed: %s", err);
+  }
+  g_assert(!memcmp(expected, actual, w * h * 4));
+}
+
+// compare a slide opened some other way against one opened from a path
+static void check_same_slide(openslide_t *expected_osr, openslide_t *osr) {
+  const char *err = openslide_get_error(osr);
+  if (err) {
+    common_fail("Open failed: %s", err);
+  }
+  int32_t levels = openslide_get_level_count(expected_osr);
+  g_assert(openslide_get_level_count(osr) == levels);
+  for (int32_t level = 0; level < levels; level++) {
+    int64_t w, h, ww, hh;
+    openslide_get_level_dimensions(expected_osr, level, &w, &h);
+    openslide_get_level_dimensions(osr, level, &ww, &hh);
+    g_assert(w == ww && h == hh);
+  }
+
+  int64_t w, h;
+  openslide_get_level0_dimensions(expected_osr, &w, &h);
+  check_same_region(expected_osr, osr, w / 2, h / 2, 0, 500, 500);
+  check_same_region(expected_osr, osr, 0, 0, levels - 1, 500, 500);
+}
+
+static void check_open_from_memory(const char *slide) {
+  const char *vendor = openslide_detect_vendor(slide);
+  if (!vendor || !g_strv_contains(single_file_vendors, vendor)) {
+    return;
+  }
+  g_autoptr(GMappedFile) file = g_mapped_file_new(slide, false, NULL);
+  g_assert(file);
+
+  g_autoptr(openslide_t) expected = openslide_open(slide);
+  g_assert(expected);
+  g_autoptr(openslide_t) osr =
+    openslide_open_from_memory(g_mapped_file_get_contents(file),
+                               g_mapped_file_get_length(file),
+                               slide, NULL, NULL);
+  if (!osr) {
+    common_fail("Couldn't open %s from memory", slide);
+  }
+  check_same_slide(expected, osr);
+}
+
+#ifndef _WIN32
+static bool resolve_sibling(void *ctx, const char *name, int *fd,
+                            const void **data G_GNUC_UNUSED,
+                            int64_t *size G_GNUC_UNUSED) {
+  const char *dirname = ctx;
+  g_autofree char *path = g_build_filename(dirname, name, NULL);
+  *fd = open(path, O_RDONLY | O_CLOEXEC);
+  return *fd != -1;
+}
+
+static void check_open_from_fd(const char *slide) {
+  const char *vendor = openslide_detect_vendor(slide);
+  // these list directories or open databases
+  if (!vendor || g_str_equal(vendor, "dicom") ||
+      g_str_equal(vendor, "sakura")) {
+    return;
+  }
+
+  g_autoptr(openslide_t) expected = openslide_open(slide);
+  g_assert(expected);
+  int fd = open(slide, O_RDONLY | O_CLOEXEC);
+  g_assert(fd != -1);
+  g_autofree char *dirname = g_path_get_dirname(slide);
+  g_autoptr(openslide_t) osr =
+    openslide_open_from_fd(fd, slide, resolve_sibling, dirname);
+  // we keep ownership of the descriptor
+  close(fd);
+  if (!osr) {
+    common_fail("Couldn't open %s from a file descriptor", slide);
+  }
+  check_same_slide(expected, osr);
+}
+#else
+static void check_open_from_fd(const char *slide G_GNUC_UNUSED) {}
+#endif
+
+#ifdef HAVE_LIBCURL
+struct http_server {
+  GSocketListener *listener;
+  GCancellable *cancellable;
+  GMappedFile *file;
+  GThread *thread;
+};
+
+static void http_respond(GSocketConnection *conn, GMappedFile *file) {
+  GInputStream *in = g_io_stream_get_input_stream(G_IO_STREAM(conn));
+  GOutputStream *out = g_io_stream_get_output_stream(G_IO_STREAM(conn));
+  g_autoptr(GDataInputStream) data = g_data_input_stream_new(in);
+  g_data_input_stream_set_newline_type(data,
+                                       G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+
+  g_autofree char *request =
+    g_data_input_stream_read_line(data, NULL, NULL, NULL);
+  if (!request) {
+    return;
+  }
+  int64_t size = g_mapped_file_get_length(file);
+  int64_t start = 0;
+  int64_t end = size - 1;
+  bool partial = false;
+  while (true) {
+    g_autofree char *line =
+      g_data_input_stream_read_line(data, NULL, NULL, NULL);
+    if (!line || !*line) {
+      break;
+    }
+    if (g_ascii_strncasecmp(line, "Range: bytes=", 13) == 0) {
+      char *endptr;
+      start = g_ascii_strtoll(line + 13, &endptr, 10);
+      g_assert(*endptr == '-');
+      end = MIN(g_ascii_strtoll(endptr + 1, NULL, 10), size - 1);
+      partial = true;
+    }
+  }
+
+  bool head = g_str_has_prefix(request, "HEAD ");
+  g_assert(head || g_str_has_prefix(request, "GET "));
+  g_autoptr(GString) headers = g_string_new(NULL);
+  if (partial) {
+    g_string_append_printf(headers,
+                           "HTTP/1.1 206 Partial Content\r\n"
+                           "Content-Range: bytes %"PRId64"-%"PRId64
+                           "/%"PRId64"\r\n", start, end, size);
+  } else {
+    g_string_append(headers, "HTTP/1.1 200 OK\r\n");
+  }
+  g_string_append_printf(headers,
+                         "Content-Length: %"PRId64"\r\n"
+                         "Accept-Ranges: bytes\r\n"
+                         "Connection: close\r\n\r\n", end - start + 1);
+  g_output_stream_write_all(out, headers->str, headers->len,
+                            NULL, NULL, NULL);
+  if (!head) {
+    g_output_stream_write_all(out, g_mapped_file_get_contents(file) + start,
+                              end - start + 1, NULL, NULL, NULL);
+  }
+}
+
+static void *http_server_thread(void *data) {
+  struct http_server *server = data;
+  while (true) {
+    g_autoptr(GSocketConnection) conn =
+      g_socket_listener_accept(server->listener, NULL,
+                               server->cancellable, NULL);
+    if (!conn) {
+      // cancelled
+      return NULL;
+    }
+    http_respond(conn, server->file);
+  }
+}
+
+// serve the slide from 127.0.0.1, returning its URL
+static char *http_server_start(struct http_server *server,
+                               const char *slide) {
+  GError *tmp_err = NULL;
+  server->file = g_mapped_file_new(slide, false, &tmp_err);
+  if (!server->file) {
+    common_fail("Couldn't map %s: %s", slide, tmp_err->message);
+  }
+  server->listener = g_socket_listener_new();
+  server->cancellable = g_cancellable_new();
+  g_autoptr(GInetAddress) inet =
+    g_inet_address_new_loopback(G_SOCKET_FAMILY_IPV4);
+  g_autoptr(GSocketAddress) addr = g_inet_socket_address_new(inet, 0);
+  g_autoptr(GSocketAddress) effective = NULL;
+  if (!g_socket_listener_add_address(server->listener, addr,
+                                     G_SOCKET_TYPE_STREAM,
+                                     G_SOCKET_PROTOCOL_TCP, NULL,
+                                     &effective, &tmp_err)) {
+    common_fail("Couldn't listen: %s", tmp_err->message);
+  }
+  server->thread = g_thread_new("http-server", http_server_thread, server);
+
+  g_autofree char *basename = g_path_get_basename(slide);
+  return g_strdup_printf("http://127.0.0.1:%u/%s",
+                         g_inet_socket_address_get_port(
+                           G_INET_SOCKET_ADDRESS(effective)),
+                         basename);
+}
+
+static void http_server_stop(struct http_server *server) {
+  g_cancellable_cancel(server->cancellable);
+  g_thread_join(server->thread);
+  g_object_unref(server->cancellable);
+  g_object_unref(server->listener);
+  g_mapped_file_unref(server->file);
+}
+
+
+static void check_http(const char *slide) {
+  // only single-file formats can be read over HTTP
+  const char *vendor = openslide_detect_vendor(slide);
+  if (!vendor || !g_strv_contains(single_file_vendors, vendor)) {
+    return;
+  }
+
+  struct http_server server = {0};
+  g_autofree char *url = http_server_start(&server, slide);
+
+  g_autoptr(openslide_t) local = openslide_open(slide);
+  g_assert(local && openslide_get_error(local) == NULL);
+  g_assert(g_str_equal(openslide_detect_vendor(url), vendor));
+  openslide_t *remote = openslide_open(url);
+  if (!remote) {
+    common_fail("Couldn't open %s", url);
+  }
+  check_same_slide(local, remote);
+
+  openslide_close(remote);
+  http_server_stop(&server);
+}
+#else
+static void check_http(const char *slide G_GNUC_UNUSED) {}
+#endif
+
 int main(int argc, char **argv) {
   common_fix_argv(&argc, &argv);
   if (argc != 2) {
@@ -305,6 +751,15 @@ int main(int argc, char **argv) {
   check_cloexec_leaks(path, argv[0], bounds_xx, bounds_yy);
 
   check_shared_cache(path);
+  check_cache_stats(path);
+  check_file_stats(path);
+  check_io_stats(path);
+  check_read_regions(path);
+  check_read_tile(path);
+  check_read_raw_tile(path);
+  check_open_from_memory(path);
+  check_open_from_fd(path);
+  check_http(path);
 
   return 0;
 }
@@ -0,0 +1,283 @@
+/*
+ *  OpenSlide, a library for reading whole slide image files
+ *
+ *  Copyright (c) 2026 OpenSlide project
+ *  All rights reserved.
+ *
+ *  OpenSlide is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, version 2.1.
+ *
+ *  OpenSlide is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with OpenSlide. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Generate tiled JPEG TIFFs with increasing tile counts, then report how
+   long each takes to open and to read its first region, how much the
+   process RSS grows, and how many bytes are read.  Every tile shares the
+   same JPEG data, so file size is dominated by the TileOffsets and
+   TileByteCounts arrays. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <jpeglib.h>
+#include <openslide.h>
+#include "openslide-common.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#define TILE_SIZE 256
+#define MIN_TILES 1000
+#define DEFAULT_MAX_TILES 1000000
+#define JPEG_BUF_SIZE (1 << 20)
+
+struct jpeg_dest {
+  struct jpeg_destination_mgr pub;
+  JOCTET buf[JPEG_BUF_SIZE];
+};
+
+static void init_destination(j_compress_ptr cinfo) {
+  struct jpeg_dest *dest = (struct jpeg_dest *) cinfo->dest;
+  dest->pub.next_output_byte = dest->buf;
+  dest->pub.free_in_buffer = sizeof(dest->buf);
+}
+
+static boolean empty_output_buffer(j_compress_ptr cinfo G_GNUC_UNUSED) {
+  common_fail("JPEG tile too large");
+}
+
+static void term_destination(j_compress_ptr cinfo G_GNUC_UNUSED) {}
+
+// one RGB tile with a gradient, so it isn't trivially compressible
+static GByteArray *encode_tile(void) {
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  g_autofree struct jpeg_dest *dest = g_new0(struct jpeg_dest, 1);
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  dest->pub.init_destination = init_destination;
+  dest->pub.empty_output_buffer = empty_output_buffer;
+  dest->pub.term_destination = term_destination;
+  cinfo.dest = &dest->pub;
+
+  cinfo.image_width = TILE_SIZE;
+  cinfo.image_height = TILE_SIZE;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  // the TIFF says RGB, so don't convert to YCbCr
+  jpeg_set_colorspace(&cinfo, JCS_RGB);
+  jpeg_start_compress(&cinfo, true);
+  uint8_t row[TILE_SIZE * 3];
+  while (cinfo.next_scanline < cinfo.image_height) {
+    for (int x = 0; x < TILE_SIZE; x++) {
+      row[x * 3] = x;
+      row[x * 3 + 1] = cinfo.next_scanline;
+      row[x * 3 + 2] = 128;
+    }
+    JSAMPROW rows[] = {row};
+    jpeg_write_scanlines(&cinfo, rows, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+
+  GByteArray *data = g_byte_array_new();
+  g_byte_array_append(data, dest->buf,
+                      sizeof(dest->buf) - dest->pub.free_in_buffer);
+  jpeg_destroy_compress(&cinfo);
+  return data;
+}
+
+static void put16(GByteArray *out, uint16_t val) {
+  val = GUINT16_TO_LE(val);
+  g_byte_array_append(out, (const uint8_t *) &val, sizeof(val));
+}
+
+static void put32(GByteArray *out, uint32_t val) {
+  val = GUINT32_TO_LE(val);
+  g_byte_array_append(out, (const uint8_t *) &val, sizeof(val));
+}
+
+static void put_entry(GByteArray *out, uint16_t tag, uint16_t type,
+                      uint32_t count, uint32_t value) {
+  put16(out, tag);
+  put16(out, type);
+  put32(out, count);
+  if (type == 3 && count == 1) {
+    // SHORT, left-justified
+    put16(out, value);
+    put16(out, 0);
+  } else {
+    put32(out, value);
+  }
+}
+
+// append a tiled directory; values of one-element arrays are inline
+static void put_directory(GByteArray *out, uint32_t across, uint32_t down,
+                          bool reduced, uint32_t offsets, uint32_t lengths,
+                          uint32_t bps_offset, bool last) {
+  uint32_t count = across * down;
+  put16(out, 12);
+  put_entry(out, 254, 4, 1, reduced);             // NewSubfileType
+  put_entry(out, 256, 4, 1, across * TILE_SIZE);  // ImageWidth
+  put_entry(out, 257, 4, 1, down * TILE_SIZE);    // ImageLength
+  put_entry(out, 258, 3, 3, bps_offset);          // BitsPerSample
+  put_entry(out, 259, 3, 1, 7);                   // Compression: JPEG
+  put_entry(out, 262, 3, 1, 2);                   // Photometric: RGB
+  put_entry(out, 277, 3, 1, 3);                   // SamplesPerPixel
+  put_entry(out, 284, 3, 1, 1);                   // PlanarConfig
+  put_entry(out, 322, 4, 1, TILE_SIZE);           // TileWidth
+  put_entry(out, 323, 4, 1, TILE_SIZE);           // TileLength
+  put_entry(out, 324, 4, count, offsets);         // TileOffsets
+  put_entry(out, 325, 4, count, lengths);         // TileByteCounts
+  // the next directory immediately follows
+  put32(out, last ? 0 : out->len + 4);
+}
+
+// every tile points at the same JPEG data
+static char *write_tiff(const char *dir, GByteArray *tile, uint32_t tiles) {
+  g_autoptr(GByteArray) out = g_byte_array_new();
+  uint32_t across = 1;
+  while ((uint64_t) across * across < tiles) {
+    across++;
+  }
+  uint32_t down = (tiles + across - 1) / across;
+
+  // header; first directory offset filled in below
+  put16(out, 0x4949);
+  put16(out, 42);
+  put32(out, 0);
+  uint32_t bps_offset = out->len;
+  put16(out, 8);
+  put16(out, 8);
+  put16(out, 8);
+  uint32_t tile_offset = out->len;
+  g_byte_array_append(out, tile->data, tile->len);
+  if (out->len % 2) {
+    g_byte_array_append(out, (const uint8_t *) "", 1);
+  }
+
+  // level 0 arrays
+  uint32_t offsets = out->len;
+  for (uint32_t i = 0; i < across * down; i++) {
+    put32(out, tile_offset);
+  }
+  uint32_t lengths = out->len;
+  for (uint32_t i = 0; i < across * down; i++) {
+    put32(out, tile->len);
+  }
+
+  // level 0, then a one-tile level so the quickhash is cheap
+  uint32_t first_dir = GUINT32_TO_LE(out->len);
+  memcpy(out->data + 4, &first_dir, sizeof(first_dir));
+  put_directory(out, across, down, false, offsets, lengths, bps_offset,
+                false);
+  put_directory(out, 1, 1, true, tile_offset, tile->len, bps_offset, true);
+
+  g_autofree char *name = g_strdup_printf("tiles-%"PRIu32".tiff", tiles);
+  char *path = g_build_filename(dir, name, NULL);
+  g_autoptr(GError) err = NULL;
+  if (!g_file_set_contents(path, (const char *) out->data, out->len, &err)) {
+    common_fail("Couldn't write %s: %s", path, err->message);
+  }
+  return path;
+}
+
+// in KiB, or -1 if unknown
+static int64_t get_rss(void) {
+#ifdef __linux__
+  g_autofree char *statm = NULL;
+  if (g_file_get_contents("/proc/self/statm", &statm, NULL, NULL)) {
+    long pages;
+    if (sscanf(statm, "%*d %ld", &pages) == 1) {
+      return pages * (sysconf(_SC_PAGESIZE) / 1024);
+    }
+  }
+#endif
+  return -1;
+}
+
+int main(int argc, char **argv) {
+  common_fix_argv(&argc, &argv);
+  if (argc > 2) {
+    printf("Usage: %s [max-tiles]\n", argv[0]);
+    return 2;
+  }
+  int64_t max_tiles = argc > 1 ? atoll(argv[1]) : DEFAULT_MAX_TILES;
+  if (max_tiles < MIN_TILES || max_tiles > 100000000) {
+    printf("Invalid tile count\n");
+    return 1;
+  }
+
+  g_autoptr(GError) err = NULL;
+  g_autofree char *dir = g_dir_make_tmp("openslide-open-latency-XXXXXX",
+                                        &err);
+  if (!dir) {
+    common_fail("Couldn't create temporary directory: %s", err->message);
+  }
+  g_autoptr(GByteArray) tile = encode_tile();
+  g_autofree uint32_t *buf = g_malloc(TILE_SIZE * TILE_SIZE * 4);
+
+  printf("%10s %10s %10s %10s %12s %12s\n", "tiles", "open ms", "read ms",
+         "RSS KiB", "open bytes", "file bytes");
+  for (int64_t tiles = MIN_TILES; tiles <= max_tiles; tiles *= 10) {
+    g_autofree char *path = write_tiff(dir, tile, tiles);
+    GStatBuf st;
+    if (g_stat(path, &st)) {
+      common_fail("Couldn't stat %s", path);
+    }
+
+    int64_t rss_before = get_rss();
+    g_autoptr(GTimer) timer = g_timer_new();
+    openslide_t *osr = openslide_open(path);
+    double open_ms = g_timer_elapsed(timer, NULL) * 1000;
+    if (!osr) {
+      common_fail("Unrecognized file: %s", path);
+    }
+    const char *error = openslide_get_error(osr);
+    if (error) {
+      common_fail("%s", error);
+    }
+    int64_t rss_after = get_rss();
+    openslide_io_stats_t io = {.struct_size = sizeof(io)};
+    openslide_get_io_stats(osr, &io);
+
+    // first tile from the middle of level 0
+    int64_t w, h;
+    openslide_get_level0_dimensions(osr, &w, &h);
+    g_timer_start(timer);
+    openslide_read_region(osr, buf, w / 2, h / 2, 0, TILE_SIZE, TILE_SIZE);
+    double read_ms = g_timer_elapsed(timer, NULL) * 1000;
+    error = openslide_get_error(osr);
+    if (error) {
+      common_fail("%s", error);
+    }
+    openslide_close(osr);
+
+    if (rss_before >= 0) {
+      printf("%10"PRId64" %10.1f %10.1f %10"PRId64" %12"PRIu64" %12"PRId64"\n",
+             tiles, open_ms, read_ms, rss_after - rss_before,
+             io.bytes_read, (int64_t) st.st_size);
+    } else {
+      printf("%10"PRId64" %10.1f %10.1f %10s %12"PRIu64" %12"PRId64"\n",
+             tiles, open_ms, read_ms, "n/a",
+             io.bytes_read, (int64_t) st.st_size);
+    }
+    g_unlink(path);
+  }
+  g_rmdir(dir);
+  return 0;
+}
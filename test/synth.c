@@ -24,11 +24,67 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 #include <glib.h>
 #include <openslide.h>
 
 #include "openslide-common.h"
 
+// synthetic slide tiles are one row of 16x16 ARGB images, ending with a
+// missing tile
+#define TILE_PIXELS 16
+#define TILE_BYTES (4 * TILE_PIXELS * TILE_PIXELS)
+// small enough for a single shard
+#define POLICY_CACHE_TILES 4
+
+static void read_synthetic_tile(openslide_t *osr, uint32_t *buf, int64_t col) {
+  openslide_read_region(osr, buf, col * TILE_PIXELS, 0, 0,
+                        TILE_PIXELS, TILE_PIXELS);
+}
+
+// Read tile 0 twice, scan every other tile once, then read tile 0 again.
+// Return true if the last read was a cache hit.  Use a fresh handle with
+// serial decoding, so nothing else inserts tiles in the meantime.
+static bool working_set_survives_scan(enum openslide_cache_policy policy) {
+  g_autoptr(openslide_t) osr = openslide_open("");
+  g_assert(osr && openslide_get_error(osr) == NULL);
+  openslide_set_decode_threads(osr, 1);
+  openslide_cache_t *cache =
+    openslide_cache_create_with_policy(POLICY_CACHE_TILES * TILE_BYTES,
+                                       policy);
+  g_assert(cache);
+  openslide_set_cache(osr, cache);
+
+  int64_t w, h;
+  openslide_get_level0_dimensions(osr, &w, &h);
+  int64_t tiles = w / TILE_PIXELS;
+  g_assert(tiles > POLICY_CACHE_TILES);
+
+  uint32_t buf[TILE_PIXELS * TILE_PIXELS];
+  read_synthetic_tile(osr, buf, 0);
+  read_synthetic_tile(osr, buf, 0);
+  for (int64_t col = 1; col < tiles; col++) {
+    read_synthetic_tile(osr, buf, col);
+  }
+  openslide_cache_stats_t before = {.struct_size = sizeof(before)};
+  openslide_cache_get_stats(cache, &before);
+  read_synthetic_tile(osr, buf, 0);
+  openslide_cache_stats_t after = {.struct_size = sizeof(after)};
+  openslide_cache_get_stats(cache, &after);
+
+  openslide_cache_release(cache);
+  g_assert(openslide_get_error(osr) == NULL);
+  return after.hits > before.hits;
+}
+
+static void *read_missing_tile(void *data) {
+  openslide_t *osr = data;
+  int64_t w, h;
+  openslide_get_level0_dimensions(osr, &w, &h);
+  return openslide_read_tile(osr, 0, w / TILE_PIXELS - 1, 0);
+}
+
 int main(int argc, char **argv) {
   if (argc < 2 || !g_str_equal(argv[1], "child")) {
     putenv("OPENSLIDE_DEBUG=synthetic");
@@ -62,6 +118,14 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  // prefetch, then cancel the hint, which may or may not have completed
+  int prefetch_id = openslide_give_prefetch_hint(osr, 0, 0, 0, 1000, 100);
+  if (prefetch_id < 0) {
+    fprintf(stderr, "Prefetch hint failed\n");
+    return 1;
+  }
+  openslide_cancel_prefetch_hint(osr, prefetch_id);
+
   // read region
   g_autofree void *buf = g_malloc(4 * 1000 * 100);
   openslide_read_region(osr, buf, 0, 0, 0, 1000, 100);
@@ -71,6 +135,71 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  // read again with a cold cache and parallel decoding
+  openslide_cache_t *cache = openslide_cache_create(64 << 20);
+  openslide_set_cache(osr, cache);
+  openslide_cache_release(cache);
+  openslide_set_decode_threads(osr, 4);
+  g_autofree void *buf2 = g_malloc(4 * 1000 * 100);
+  openslide_read_region(osr, buf2, 0, 0, 0, 1000, 100);
+  err = openslide_get_error(osr);
+  if (err != NULL) {
+    fprintf(stderr, "Reading region with parallel decode: %s\n", err);
+    return 1;
+  }
+  if (memcmp(buf, buf2, 4 * 1000 * 100)) {
+    fprintf(stderr, "Parallel decode produced different pixels\n");
+    return 1;
+  }
+
+  // native tiles
+  openslide_tile_t *tile = openslide_read_tile(osr, 0, 0, 0);
+  if (!tile) {
+    fprintf(stderr, "Couldn't read native tile\n");
+    return 1;
+  }
+  for (int row = 0; row < TILE_PIXELS; row++) {
+    if (memcmp(openslide_tile_get_data(tile) + row * TILE_PIXELS,
+               (uint32_t *) buf + row * 1000,
+               TILE_PIXELS * 4)) {
+      fprintf(stderr, "Native tile differs from region\n");
+      return 1;
+    }
+  }
+  openslide_tile_release(tile);
+
+  // a tile that can't be read must not leave readers on other threads
+  // waiting for it
+  if (read_missing_tile(osr)) {
+    fprintf(stderr, "Read missing tile\n");
+    return 1;
+  }
+  GThread *thread = g_thread_new("read-missing-tile", read_missing_tile, osr);
+  if (g_thread_join(thread)) {
+    fprintf(stderr, "Read missing tile from second thread\n");
+    return 1;
+  }
+  err = openslide_get_error(osr);
+  if (err != NULL) {
+    fprintf(stderr, "Reading missing tile: %s\n", err);
+    return 1;
+  }
+
+  // eviction policies
+  if (working_set_survives_scan(OPENSLIDE_CACHE_POLICY_LRU)) {
+    fprintf(stderr, "LRU cache kept a tile through a scan\n");
+    return 1;
+  }
+  if (!working_set_survives_scan(OPENSLIDE_CACHE_POLICY_S3FIFO)) {
+    fprintf(stderr, "S3-FIFO cache evicted a reused tile during a scan\n");
+    return 1;
+  }
+  if (openslide_cache_create_with_policy(TILE_BYTES,
+                                         (enum openslide_cache_policy) -1)) {
+    fprintf(stderr, "Created cache with invalid policy\n");
+    return 1;
+  }
+
   // report tests
   printf("Tested:\n");
   for (const char *const *prop = openslide_get_property_names(osr);